@@ -0,0 +1,169 @@
+/*
+ * basenc.c — block encode/decode framework for base64 and base32
+ *
+ * Input is read in blocks of IN_BLOCK bytes (a multiple of 3, 5 and 24,
+ * so every block but the last encodes without padding). The codec's
+ * kernel encodes the block in one call; wrapping then copies whole rows
+ * into the output buffer with a newline after each, and the block is
+ * written with one fwrite.
+ *
+ * Decoding hands each clean run to the codec's kernel, which stops at
+ * the first group holding a newline, '=' or garbage. Those characters are
+ * dealt with here one at a time, after which the kernel resumes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "basenc.h"
+
+#define IN_BLOCK (15 * 65536)
+
+/* Pack k values of c->bits bits each into bytes; returns bytes written. */
+static size_t put_bits(const BaseCodec *c, const unsigned char *vals, size_t k,
+                       unsigned char *out)
+{
+    uint64_t acc = 0;
+    int nbits = 0;
+    size_t o = 0;
+    for (size_t i = 0; i < k; i++) {
+        acc = (acc << c->bits) | vals[i];
+        nbits += c->bits;
+        if (nbits >= 8) {
+            nbits -= 8;
+            out[o++] = (unsigned char)(acc >> nbits);
+        }
+    }
+    return o;
+}
+
+static int io_error(const BaseCodec *c, FILE *in)
+{
+    if (ferror(in)) fprintf(stderr, "%s: read error\n", c->name);
+    else            fprintf(stderr, "%s: write error\n", c->name);
+    return 1;
+}
+
+int basenc_encode(FILE *in, FILE *out, const BaseCodec *c, int wrap)
+{
+    size_t enc_cap  = IN_BLOCK / c->in_group * c->out_group + c->out_group;
+    size_t wrap_cap = wrap > 0 ? enc_cap + enc_cap / (size_t)wrap + 1 : 0;
+    unsigned char *ibuf = malloc(IN_BLOCK);
+    char *ebuf = malloc(enc_cap);
+    char *wbuf = wrap > 0 ? malloc(wrap_cap) : NULL;
+    if (!ibuf || !ebuf || (wrap > 0 && !wbuf)) {
+        fprintf(stderr, "%s: out of memory\n", c->name);
+        free(ibuf); free(ebuf); free(wbuf);
+        return 1;
+    }
+
+    int    ret = 0;
+    size_t col = 0;       /* characters on the current output row */
+    bool   any = false;
+    size_t n;
+    while ((n = fread(ibuf, 1, IN_BLOCK, in)) > 0) {
+        size_t m = c->encode(ibuf, n, ebuf);
+        any = true;
+        const char *src = ebuf;
+        size_t len = m;
+        if (wrap > 0) {
+            size_t o = 0;
+            for (size_t i = 0; i < m; ) {
+                size_t take = (size_t)wrap - col;
+                if (take > m - i) take = m - i;
+                memcpy(wbuf + o, ebuf + i, take);
+                o   += take;
+                i   += take;
+                col += take;
+                if (col == (size_t)wrap) {
+                    wbuf[o++] = '\n';
+                    col = 0;
+                }
+            }
+            src = wbuf;
+            len = o;
+        } else {
+            col += m;
+        }
+        if (fwrite(src, 1, len, out) != len) { ret = io_error(c, in); break; }
+        if (n < IN_BLOCK) break;
+    }
+    if (ret == 0 && ferror(in)) ret = io_error(c, in);
+    if (ret == 0 && any && (wrap == 0 || col > 0) && putc('\n', out) == EOF)
+        ret = io_error(c, in);
+
+    free(ibuf);
+    free(ebuf);
+    free(wbuf);
+    return ret;
+}
+
+int basenc_decode(FILE *in, FILE *out, const BaseCodec *c, bool ignore_garbage)
+{
+    unsigned char *ibuf = malloc(IN_BLOCK);
+    unsigned char *obuf = malloc(IN_BLOCK + BASENC_DECODE_SLACK);
+    if (!ibuf || !obuf) {
+        fprintf(stderr, "%s: out of memory\n", c->name);
+        free(ibuf); free(obuf);
+        return 1;
+    }
+
+    unsigned char vals[8];   /* values of a group split by a newline or '=' */
+    size_t k = 0;
+    int    ret = 0;
+    size_t n;
+    while (ret == 0 && (n = fread(ibuf, 1, IN_BLOCK, in)) > 0) {
+        size_t i = 0, o = 0;
+        while (i < n) {
+            if (k == 0) {
+                size_t used;
+                o += c->decode(ibuf + i, n - i, obuf + o, &used);
+                i += used;
+                if (i == n) break;
+            }
+            unsigned char ch = ibuf[i++];
+            unsigned char v  = c->dtab[ch];
+            if (v != 0xFF) {
+                vals[k++] = v;
+                if (k == c->out_group) {
+                    o += put_bits(c, vals, k, obuf + o);
+                    k = 0;
+                }
+            } else if (ch == '\n' || ch == '\r' || ch == ' ' || ch == '\t') {
+                continue;
+            } else if (ch == '=') {
+                /* Padding ends the group; a following group may start afresh */
+                size_t m = put_bits(c, vals, k, obuf + o);
+                if (k > 0 && m == 0 && !ignore_garbage) {
+                    fprintf(stderr, "%s: invalid input\n", c->name);
+                    ret = 1;
+                    break;
+                }
+                o += m;
+                k = 0;
+            } else if (!ignore_garbage) {
+                fprintf(stderr, "%s: invalid input\n", c->name);
+                ret = 1;
+                break;
+            }
+        }
+        if (o > 0 && fwrite(obuf, 1, o, out) != o) ret = io_error(c, in);
+    }
+    if (ret == 0 && ferror(in)) ret = io_error(c, in);
+
+    /* Unpadded final group */
+    if (ret == 0 && k > 0) {
+        size_t m = put_bits(c, vals, k, obuf);
+        if (m == 0 && !ignore_garbage) {
+            fprintf(stderr, "%s: invalid input (truncated stream)\n", c->name);
+            ret = 1;
+        } else if (m > 0 && fwrite(obuf, 1, m, out) != m) {
+            ret = io_error(c, in);
+        }
+    }
+
+    free(ibuf);
+    free(obuf);
+    return ret;
+}
@@ -0,0 +1,195 @@
+/*
+ * crc.c — CRC-32 (polynomial 0x04C11DB7) in both bit orders
+ *
+ * Scalar: slice-by-16. Sixteen 256-entry tables let one step fold sixteen
+ * input bytes into the register with sixteen independent lookups instead
+ * of a sixteen-long dependent chain.
+ *
+ * x86-64 with PCLMULQDQ: the input is folded 64 bytes at a time into four
+ * 128-bit accumulators with carry-less multiplies by x^N mod P, the four
+ * are folded into one, and the final 16 bytes that remain stand for the
+ * whole prefix: running the tables over them (from a zero register) and
+ * then over the tail gives the CRC of everything. That avoids a Barrett
+ * reduction step.
+ *
+ * MSB-first data is byte-reversed into 128-bit big-endian registers, so
+ * register bit i is the coefficient of x^i and the fold constants are
+ * plain x^N mod P. For LSB-first data register bit i is x^(127-i); a
+ * product of two reflected values comes out one place short, which the
+ * constants absorb by being brev32(x^(N-1) mod P) in the upper half of
+ * the qword.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define CRC_X86 1
+#endif
+
+#define POLY_MSB 0x04C11DB7u
+#define POLY_LSB 0xEDB88320u    /* POLY_MSB bit-reversed */
+
+static uint32_t tab_msb[16][256];
+static uint32_t tab_lsb[16][256];
+static int      ready = 0;
+static int      have_clmul = 0;
+
+static void crc_init(void)
+{
+    for (uint32_t b = 0; b < 256; b++) {
+        uint32_t m = b << 24, l = b;
+        for (int k = 0; k < 8; k++) {
+            m = (m & 0x80000000u) ? (m << 1) ^ POLY_MSB : m << 1;
+            l = (l & 1) ? (l >> 1) ^ POLY_LSB : l >> 1;
+        }
+        tab_msb[0][b] = m;
+        tab_lsb[0][b] = l;
+    }
+    for (int t = 1; t < 16; t++) {
+        for (int b = 0; b < 256; b++) {
+            uint32_t m = tab_msb[t - 1][b], l = tab_lsb[t - 1][b];
+            tab_msb[t][b] = (m << 8) ^ tab_msb[0][m >> 24];
+            tab_lsb[t][b] = (l >> 8) ^ tab_lsb[0][l & 0xFF];
+        }
+    }
+#ifdef CRC_X86
+    __builtin_cpu_init();
+    have_clmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+    ready = 1;
+}
+
+static uint32_t msb_tables(uint32_t crc, const uint8_t *p, size_t n)
+{
+    for (; n >= 16; n -= 16, p += 16) {
+        uint32_t w = crc ^ ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+                            (uint32_t)p[2] << 8 | p[3]);
+        crc = tab_msb[15][w >> 24]         ^ tab_msb[14][(w >> 16) & 0xFF] ^
+              tab_msb[13][(w >> 8) & 0xFF] ^ tab_msb[12][w & 0xFF] ^
+              tab_msb[11][p[4]]  ^ tab_msb[10][p[5]]  ^ tab_msb[9][p[6]]  ^ tab_msb[8][p[7]]  ^
+              tab_msb[7][p[8]]   ^ tab_msb[6][p[9]]   ^ tab_msb[5][p[10]] ^ tab_msb[4][p[11]] ^
+              tab_msb[3][p[12]]  ^ tab_msb[2][p[13]]  ^ tab_msb[1][p[14]] ^ tab_msb[0][p[15]];
+    }
+    for (; n > 0; n--, p++)
+        crc = (crc << 8) ^ tab_msb[0][(crc >> 24) ^ *p];
+    return crc;
+}
+
+static uint32_t lsb_tables(uint32_t crc, const uint8_t *p, size_t n)
+{
+    for (; n >= 16; n -= 16, p += 16) {
+        uint32_t w = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                            (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        crc = tab_lsb[15][w & 0xFF]         ^ tab_lsb[14][(w >> 8) & 0xFF] ^
+              tab_lsb[13][(w >> 16) & 0xFF] ^ tab_lsb[12][w >> 24] ^
+              tab_lsb[11][p[4]]  ^ tab_lsb[10][p[5]]  ^ tab_lsb[9][p[6]]  ^ tab_lsb[8][p[7]]  ^
+              tab_lsb[7][p[8]]   ^ tab_lsb[6][p[9]]   ^ tab_lsb[5][p[10]] ^ tab_lsb[4][p[11]] ^
+              tab_lsb[3][p[12]]  ^ tab_lsb[2][p[13]]  ^ tab_lsb[1][p[14]] ^ tab_lsb[0][p[15]];
+    }
+    for (; n > 0; n--, p++)
+        crc = (crc >> 8) ^ tab_lsb[0][(crc ^ *p) & 0xFF];
+    return crc;
+}
+
+#ifdef CRC_X86
+
+#define FOLD_MIN 256    /* below this the tables are as fast */
+
+/* x*k where k holds the multipliers for the x.hi and x.lo halves */
+__attribute__((target("pclmul,sse4.1")))
+static __m128i fold(__m128i x, __m128i k)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11),
+                         _mm_clmulepi64_si128(x, k, 0x00));
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t msb_fold(uint32_t crc, const uint8_t *p, size_t n)
+{
+    const __m128i rev  = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i k512 = _mm_set_epi64x(0x8833794c, 0xe6228b11);  /* x^576, x^512 */
+    const __m128i k128 = _mm_set_epi64x(0xc5b9cd4c, 0xe8a45605);  /* x^192, x^128 */
+#define LOAD_BE(q) _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(q)), rev)
+
+    __m128i x0 = _mm_xor_si128(LOAD_BE(p), _mm_set_epi32((int)crc, 0, 0, 0));
+    __m128i x1 = LOAD_BE(p + 16), x2 = LOAD_BE(p + 32), x3 = LOAD_BE(p + 48);
+    for (p += 64, n -= 64; n >= 64; p += 64, n -= 64) {
+        x0 = _mm_xor_si128(fold(x0, k512), LOAD_BE(p));
+        x1 = _mm_xor_si128(fold(x1, k512), LOAD_BE(p + 16));
+        x2 = _mm_xor_si128(fold(x2, k512), LOAD_BE(p + 32));
+        x3 = _mm_xor_si128(fold(x3, k512), LOAD_BE(p + 48));
+    }
+    x0 = _mm_xor_si128(fold(x0, k128), x1);
+    x0 = _mm_xor_si128(fold(x0, k128), x2);
+    x0 = _mm_xor_si128(fold(x0, k128), x3);
+    for (; n >= 16; p += 16, n -= 16)
+        x0 = _mm_xor_si128(fold(x0, k128), LOAD_BE(p));
+#undef LOAD_BE
+
+    uint8_t rest[16];
+    _mm_storeu_si128((__m128i *)rest, _mm_shuffle_epi8(x0, rev));
+    return msb_tables(msb_tables(0, rest, 16), p, n);
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t lsb_fold(uint32_t crc, const uint8_t *p, size_t n)
+{
+    /* hi: brev32(x^(D-1)), lo: brev32(x^(D+63)), each << 32 */
+    const __m128i k512 = _mm_set_epi64x((long long)0xcad38e8f00000000ULL,
+                                        (long long)0x653d982200000000ULL);
+    const __m128i k128 = _mm_set_epi64x((long long)0x9ba54c6f00000000ULL,
+                                        (long long)0x65673b4600000000ULL);
+#define LOAD_LE(q) _mm_loadu_si128((const __m128i *)(q))
+
+    __m128i x0 = _mm_xor_si128(LOAD_LE(p), _mm_cvtsi32_si128((int)crc));
+    __m128i x1 = LOAD_LE(p + 16), x2 = LOAD_LE(p + 32), x3 = LOAD_LE(p + 48);
+    for (p += 64, n -= 64; n >= 64; p += 64, n -= 64) {
+        x0 = _mm_xor_si128(fold(x0, k512), LOAD_LE(p));
+        x1 = _mm_xor_si128(fold(x1, k512), LOAD_LE(p + 16));
+        x2 = _mm_xor_si128(fold(x2, k512), LOAD_LE(p + 32));
+        x3 = _mm_xor_si128(fold(x3, k512), LOAD_LE(p + 48));
+    }
+    x0 = _mm_xor_si128(fold(x0, k128), x1);
+    x0 = _mm_xor_si128(fold(x0, k128), x2);
+    x0 = _mm_xor_si128(fold(x0, k128), x3);
+    for (; n >= 16; p += 16, n -= 16)
+        x0 = _mm_xor_si128(fold(x0, k128), LOAD_LE(p));
+#undef LOAD_LE
+
+    uint8_t rest[16];
+    _mm_storeu_si128((__m128i *)rest, x0);
+    return lsb_tables(lsb_tables(0, rest, 16), p, n);
+}
+
+#endif /* CRC_X86 */
+
+uint32_t crc_posix_update(uint32_t crc, const void *buf, size_t n)
+{
+    if (!ready) crc_init();
+#ifdef CRC_X86
+    if (have_clmul && n >= FOLD_MIN) return msb_fold(crc, buf, n);
+#endif
+    return msb_tables(crc, buf, n);
+}
+
+uint32_t crc_posix_final(uint32_t crc, uint64_t len)
+{
+    uint8_t lb[8];
+    size_t k = 0;
+    for (; len != 0; len >>= 8) lb[k++] = (uint8_t)len;
+    return ~crc_posix_update(crc, lb, k);
+}
+
+uint32_t crc32b_update(uint32_t crc, const void *buf, size_t n)
+{
+    if (!ready) crc_init();
+    crc = ~crc;
+#ifdef CRC_X86
+    if (have_clmul && n >= FOLD_MIN) return ~lsb_fold(crc, buf, n);
+#endif
+    return ~lsb_tables(crc, buf, n);
+}
@@ -0,0 +1,1474 @@
+/*
+ * digest.c — MD5, SHA-1, SHA-2 and BLAKE2 for the checksum tools
+ *
+ * The streaming layer (buffering, padding, length encoding, output byte
+ * order) is common to all algorithms; only the block function differs.
+ * Block functions take a run of whole blocks so SIMD kernels can keep
+ * their state in registers across blocks.
+ *
+ * The scalar kernels are the reference. On x86-64 digest_cpu_init()
+ * replaces them once with:
+ *   SHA-1, SHA-224/256   SHA-NI round instructions (sha1rnds4, sha256rnds2)
+ *   SHA-384/512          AVX2 message schedule for four blocks at a time,
+ *                        rounds in scalar registers
+ *   BLAKE2b              AVX2 (one row per register) or SSE4.1 (two
+ *                        registers per row)
+ *   BLAKE2bp, BLAKE2sp   AVX2 with one leaf per lane: four BLAKE2b or
+ *                        eight BLAKE2s leaves per compression
+ * and, for digest_many() on CPUs without SHA-NI, SHA-256 over eight
+ * messages in the eight 32-bit lanes of AVX2 registers. BLAKE2s itself
+ * is scalar; its speed comes from the BLAKE2sp lanes.
+ * MD5 is a serial chain of dependent adds and has no useful SIMD form for
+ * a single stream; it stays scalar.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "digest.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define DIGEST_X86 1
+#endif
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t load_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+           (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static uint64_t load_le64(const uint8_t *p)
+{
+    return (uint64_t)load_le32(p) | (uint64_t)load_le32(p + 4) << 32;
+}
+
+static uint64_t load_be64(const uint8_t *p)
+{
+    return (uint64_t)load_be32(p) << 32 | load_be32(p + 4);
+}
+
+/* ------------------------------------------------------------------ */
+/* MD5 (RFC 1321)                                                      */
+/* ------------------------------------------------------------------ */
+
+static const uint32_t MD5_T[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t MD5_S[4][4] = {
+    { 7, 12, 17, 22 }, { 5, 9, 14, 20 }, { 4, 11, 16, 23 }, { 6, 10, 15, 21 }
+};
+
+#define MD5_F(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define MD5_G(b, c, d) ((c) ^ ((d) & ((b) ^ (c))))
+#define MD5_H(b, c, d) ((b) ^ (c) ^ (d))
+#define MD5_I(b, c, d) ((c) ^ ((b) | ~(d)))
+
+#define MD5_STEP(f, i, g, s) do {                          \
+        uint32_t t_ = a + f(b, c, d) + x[g] + MD5_T[i];    \
+        a = d; d = c; c = b;                               \
+        b += ROL32(t_, s);                                 \
+    } while (0)
+
+static void md5_blocks(uint32_t *h, const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += 64) {
+        uint32_t x[16];
+        for (int i = 0; i < 16; i++) x[i] = load_le32(p + 4 * i);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 16; i++)
+            MD5_STEP(MD5_F, i, i, MD5_S[0][i & 3]);
+        for (int i = 16; i < 32; i++)
+            MD5_STEP(MD5_G, i, (5 * i + 1) & 15, MD5_S[1][i & 3]);
+        for (int i = 32; i < 48; i++)
+            MD5_STEP(MD5_H, i, (3 * i + 5) & 15, MD5_S[2][i & 3]);
+        for (int i = 48; i < 64; i++)
+            MD5_STEP(MD5_I, i, (7 * i) & 15, MD5_S[3][i & 3]);
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* SHA-1 (FIPS 180-4)                                                  */
+/* ------------------------------------------------------------------ */
+
+static void sha1_blocks_scalar(uint32_t *h, const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) w[i] = load_be32(p + 4 * i);
+        for (int i = 16; i < 80; i++)
+            w[i] = ROL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if      (i < 20) { f = d ^ (b & (c ^ d));         k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                 k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (d & (b | c));   k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                 k = 0xCA62C1D6; }
+            uint32_t t = ROL32(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = ROL32(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* SHA-224 / SHA-256                                                   */
+/* ------------------------------------------------------------------ */
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void sha256_blocks_scalar(uint32_t *h, const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) w[i] = load_be32(p + 4 * i);
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = ROR32(w[i-15], 7) ^ ROR32(w[i-15], 18) ^ (w[i-15] >> 3);
+            uint32_t s1 = ROR32(w[i-2], 17) ^ ROR32(w[i-2], 19) ^ (w[i-2] >> 10);
+            w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t S1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
+            uint32_t ch = g ^ (e & (f ^ g));
+            uint32_t t1 = hh + S1 + ch + K256[i] + w[i];
+            uint32_t S0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
+            uint32_t mj = (a & b) | (c & (a | b));
+            hh = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + S0 + mj;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* SHA-384 / SHA-512                                                   */
+/* ------------------------------------------------------------------ */
+
+static const uint64_t K512[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+#define SHA512_ROUND(wk) do {                                           \
+        uint64_t S1 = ROR64(e, 14) ^ ROR64(e, 18) ^ ROR64(e, 41);       \
+        uint64_t ch = g ^ (e & (f ^ g));                                \
+        uint64_t t1 = hh + S1 + ch + (wk);                              \
+        uint64_t S0 = ROR64(a, 28) ^ ROR64(a, 34) ^ ROR64(a, 39);       \
+        uint64_t mj = (a & b) | (c & (a | b));                          \
+        hh = g; g = f; f = e; e = d + t1;                               \
+        d = c; c = b; b = a; a = t1 + S0 + mj;                          \
+    } while (0)
+
+static void sha512_blocks_scalar(uint64_t *h, const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p += 128) {
+        uint64_t w[80];
+        for (int i = 0; i < 16; i++) w[i] = load_be64(p + 8 * i);
+        for (int i = 16; i < 80; i++) {
+            uint64_t s0 = ROR64(w[i-15], 1) ^ ROR64(w[i-15], 8) ^ (w[i-15] >> 7);
+            uint64_t s1 = ROR64(w[i-2], 19) ^ ROR64(w[i-2], 61) ^ (w[i-2] >> 6);
+            w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+
+        uint64_t a = h[0], b = h[1], c = h[2], d = h[3];
+        uint64_t e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 80; i++)
+            SHA512_ROUND(K512[i] + w[i]);
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* BLAKE2b (RFC 7693)                                                  */
+/* ------------------------------------------------------------------ */
+
+static const uint64_t B2B_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+static const uint8_t B2B_SIGMA[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+};
+
+#define B2B_G(r, i, a, b, c, d) do {                    \
+        a = a + b + m[B2B_SIGMA[r][2*(i)]];             \
+        d = ROR64(d ^ a, 32);                           \
+        c = c + d;                                      \
+        b = ROR64(b ^ c, 24);                           \
+        a = a + b + m[B2B_SIGMA[r][2*(i)+1]];           \
+        d = ROR64(d ^ a, 16);                           \
+        c = c + d;                                      \
+        b = ROR64(b ^ c, 63);                           \
+    } while (0)
+
+/* One block; t is the byte count including this block, f0/f1 the
+   last-block and last-node flags. */
+static void blake2b_compress_scalar(uint64_t *h, const uint8_t *p, uint64_t t,
+                                    uint64_t f0, uint64_t f1)
+{
+    uint64_t m[16], v[16];
+    for (int i = 0; i < 16; i++) m[i] = load_le64(p + 8 * i);
+    for (int i = 0; i < 8; i++) {
+        v[i]     = h[i];
+        v[i + 8] = B2B_IV[i];
+    }
+    v[12] ^= t;
+    v[14] ^= f0;
+    v[15] ^= f1;
+
+    for (int r = 0; r < 12; r++) {
+        B2B_G(r, 0, v[0], v[4], v[ 8], v[12]);
+        B2B_G(r, 1, v[1], v[5], v[ 9], v[13]);
+        B2B_G(r, 2, v[2], v[6], v[10], v[14]);
+        B2B_G(r, 3, v[3], v[7], v[11], v[15]);
+        B2B_G(r, 4, v[0], v[5], v[10], v[15]);
+        B2B_G(r, 5, v[1], v[6], v[11], v[12]);
+        B2B_G(r, 6, v[2], v[7], v[ 8], v[13]);
+        B2B_G(r, 7, v[3], v[4], v[ 9], v[14]);
+    }
+    for (int i = 0; i < 8; i++) h[i] ^= v[i] ^ v[i + 8];
+}
+
+/* ------------------------------------------------------------------ */
+/* BLAKE2s (RFC 7693)                                                  */
+/* ------------------------------------------------------------------ */
+
+/* SHA-256's IV; the message schedule is the first ten rows of B2B_SIGMA */
+static const uint32_t B2S_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+#define B2S_G(r, i, a, b, c, d) do {                    \
+        a = a + b + m[B2B_SIGMA[r][2*(i)]];             \
+        d = ROR32(d ^ a, 16);                           \
+        c = c + d;                                      \
+        b = ROR32(b ^ c, 12);                           \
+        a = a + b + m[B2B_SIGMA[r][2*(i)+1]];           \
+        d = ROR32(d ^ a, 8);                            \
+        c = c + d;                                      \
+        b = ROR32(b ^ c, 7);                            \
+    } while (0)
+
+static void blake2s_compress(uint32_t *h, const uint8_t *p, uint64_t t,
+                             uint32_t f0, uint32_t f1)
+{
+    uint32_t m[16], v[16];
+    for (int i = 0; i < 16; i++) m[i] = load_le32(p + 4 * i);
+    for (int i = 0; i < 8; i++) {
+        v[i]     = h[i];
+        v[i + 8] = B2S_IV[i];
+    }
+    v[12] ^= (uint32_t)t;
+    v[13] ^= (uint32_t)(t >> 32);
+    v[14] ^= f0;
+    v[15] ^= f1;
+
+    for (int r = 0; r < 10; r++) {
+        B2S_G(r, 0, v[0], v[4], v[ 8], v[12]);
+        B2S_G(r, 1, v[1], v[5], v[ 9], v[13]);
+        B2S_G(r, 2, v[2], v[6], v[10], v[14]);
+        B2S_G(r, 3, v[3], v[7], v[11], v[15]);
+        B2S_G(r, 4, v[0], v[5], v[10], v[15]);
+        B2S_G(r, 5, v[1], v[6], v[11], v[12]);
+        B2S_G(r, 6, v[2], v[7], v[ 8], v[13]);
+        B2S_G(r, 7, v[3], v[4], v[ 9], v[14]);
+    }
+    for (int i = 0; i < 8; i++) h[i] ^= v[i] ^ v[i + 8];
+}
+
+/* ------------------------------------------------------------------ */
+/* x86-64 kernels                                                      */
+/* ------------------------------------------------------------------ */
+
+#ifdef DIGEST_X86
+
+/*
+ * SHA-256 with SHA-NI. The state lives in two registers as ABEF and CDGH;
+ * each quad-round below does four rounds, finishes the schedule word four
+ * ahead (msg2) and starts the one eight ahead (msg1). Registers rotate
+ * cur = M[i%4], prev = M[(i+3)%4], next = M[(i+1)%4].
+ */
+#define SHA256_QR(i, cur, prev, next) do {                                  \
+        if ((i) < 4)                                                        \
+            cur = _mm_shuffle_epi8(_mm_loadu_si128(                         \
+                      (const __m128i *)(p + 16 * (i))), bswap);             \
+        __m128i m_ = _mm_add_epi32(cur,                                     \
+                      _mm_loadu_si128((const __m128i *)&K256[4 * (i)]));    \
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, m_);                       \
+        if ((i) >= 3 && (i) <= 14) {                                        \
+            next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));      \
+            next = _mm_sha256msg2_epu32(next, cur);                         \
+        }                                                                   \
+        m_ = _mm_shuffle_epi32(m_, 0x0E);                                   \
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, m_);                       \
+        if ((i) >= 1 && (i) <= 12)                                          \
+            prev = _mm_sha256msg1_epu32(prev, cur);                         \
+    } while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t *h, const uint8_t *p, size_t n)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                         0x0405060700010203ULL);
+    __m128i dcba = _mm_loadu_si128((const __m128i *)&h[0]);
+    __m128i hgfe = _mm_loadu_si128((const __m128i *)&h[4]);
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (; n > 0; n--, p += 64) {
+        __m128i abef_save = abef, cdgh_save = cdgh;
+        __m128i m0, m1, m2, m3;
+        m0 = m1 = m2 = m3 = _mm_setzero_si128();
+
+        SHA256_QR( 0, m0, m3, m1);
+        SHA256_QR( 1, m1, m0, m2);
+        SHA256_QR( 2, m2, m1, m3);
+        SHA256_QR( 3, m3, m2, m0);
+        SHA256_QR( 4, m0, m3, m1);
+        SHA256_QR( 5, m1, m0, m2);
+        SHA256_QR( 6, m2, m1, m3);
+        SHA256_QR( 7, m3, m2, m0);
+        SHA256_QR( 8, m0, m3, m1);
+        SHA256_QR( 9, m1, m0, m2);
+        SHA256_QR(10, m2, m1, m3);
+        SHA256_QR(11, m3, m2, m0);
+        SHA256_QR(12, m0, m3, m1);
+        SHA256_QR(13, m1, m0, m2);
+        SHA256_QR(14, m2, m1, m3);
+        SHA256_QR(15, m3, m2, m0);
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i *)&h[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i *)&h[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/*
+ * SHA-1 with SHA-NI. Step j does rounds 4j..4j+3: sha1nexte derives E
+ * from the previous ABCD and adds the message, alternating between two
+ * E registers. The schedule for step j+4 is built over steps j+1..j+3
+ * with msg1, a xor and msg2; n1..n3 are M[(j+1)%4]..M[(j+3)%4].
+ */
+#define SHA1_STEP(j, cur, n1, n2, n3, ex, ey) do {                         \
+        if ((j) < 4)                                                        \
+            cur = _mm_shuffle_epi8(_mm_loadu_si128(                         \
+                      (const __m128i *)(p + 16 * (j))), bswap);             \
+        if ((j) == 0) ex = _mm_add_epi32(ex, cur);                          \
+        else          ex = _mm_sha1nexte_epu32(ex, cur);                    \
+        ey = abcd;                                                          \
+        if ((j) >= 3 && (j) <= 18) n1 = _mm_sha1msg2_epu32(n1, cur);        \
+        abcd = _mm_sha1rnds4_epu32(abcd, ex, (j) / 5);                      \
+        if ((j) >= 1 && (j) <= 16) n3 = _mm_sha1msg1_epu32(n3, cur);        \
+        if ((j) >= 2 && (j) <= 17) n2 = _mm_xor_si128(n2, cur);             \
+    } while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_blocks_shani(uint32_t *h, const uint8_t *p, size_t n)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL,
+                                         0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0x1B);
+    __m128i e0   = _mm_set_epi32((int)h[4], 0, 0, 0);
+
+    for (; n > 0; n--, p += 64) {
+        __m128i abcd_save = abcd, e0_save = e0;
+        __m128i e1 = _mm_setzero_si128();
+        __m128i m0, m1, m2, m3;
+        m0 = m1 = m2 = m3 = _mm_setzero_si128();
+
+        SHA1_STEP( 0, m0, m1, m2, m3, e0, e1);
+        SHA1_STEP( 1, m1, m2, m3, m0, e1, e0);
+        SHA1_STEP( 2, m2, m3, m0, m1, e0, e1);
+        SHA1_STEP( 3, m3, m0, m1, m2, e1, e0);
+        SHA1_STEP( 4, m0, m1, m2, m3, e0, e1);
+        SHA1_STEP( 5, m1, m2, m3, m0, e1, e0);
+        SHA1_STEP( 6, m2, m3, m0, m1, e0, e1);
+        SHA1_STEP( 7, m3, m0, m1, m2, e1, e0);
+        SHA1_STEP( 8, m0, m1, m2, m3, e0, e1);
+        SHA1_STEP( 9, m1, m2, m3, m0, e1, e0);
+        SHA1_STEP(10, m2, m3, m0, m1, e0, e1);
+        SHA1_STEP(11, m3, m0, m1, m2, e1, e0);
+        SHA1_STEP(12, m0, m1, m2, m3, e0, e1);
+        SHA1_STEP(13, m1, m2, m3, m0, e1, e0);
+        SHA1_STEP(14, m2, m3, m0, m1, e0, e1);
+        SHA1_STEP(15, m3, m0, m1, m2, e1, e0);
+        SHA1_STEP(16, m0, m1, m2, m3, e0, e1);
+        SHA1_STEP(17, m1, m2, m3, m0, e1, e0);
+        SHA1_STEP(18, m2, m3, m0, m1, e0, e1);
+        SHA1_STEP(19, m3, m0, m1, m2, e1, e0);
+
+        e0   = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i *)h, _mm_shuffle_epi32(abcd, 0x1B));
+    h[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+/*
+ * SHA-512 with an AVX2 message schedule: four consecutive blocks sit in
+ * the four 64-bit lanes, so W[16..79] for all of them costs one vector
+ * pass. W+K is stored and the rounds then run per block in scalar
+ * registers. Fewer than four remaining blocks go to the scalar kernel.
+ */
+__attribute__((target("avx2,bmi2")))
+static __m256i sha512_ror4(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n));
+}
+
+__attribute__((target("avx2,bmi2")))
+static void sha512_blocks_avx2(uint64_t *h, const uint8_t *p, size_t n)
+{
+    uint64_t wk[80][4] __attribute__((aligned(32)));
+
+    for (; n >= 4; n -= 4, p += 512) {
+        __m256i w[80];
+        for (int i = 0; i < 16; i++)
+            w[i] = _mm256_set_epi64x((int64_t)load_be64(p + 384 + 8 * i),
+                                     (int64_t)load_be64(p + 256 + 8 * i),
+                                     (int64_t)load_be64(p + 128 + 8 * i),
+                                     (int64_t)load_be64(p + 8 * i));
+        for (int i = 16; i < 80; i++) {
+            __m256i a = w[i - 15], b = w[i - 2];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha512_ror4(a, 1),
+                             sha512_ror4(a, 8)), _mm256_srli_epi64(a, 7));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha512_ror4(b, 19),
+                             sha512_ror4(b, 61)), _mm256_srli_epi64(b, 6));
+            w[i] = _mm256_add_epi64(_mm256_add_epi64(w[i - 16], s0),
+                                    _mm256_add_epi64(w[i - 7], s1));
+        }
+        for (int i = 0; i < 80; i++)
+            _mm256_store_si256((__m256i *)wk[i],
+                _mm256_add_epi64(w[i], _mm256_set1_epi64x((int64_t)K512[i])));
+
+        for (int blk = 0; blk < 4; blk++) {
+            uint64_t a = h[0], b = h[1], c = h[2], d = h[3];
+            uint64_t e = h[4], f = h[5], g = h[6], hh = h[7];
+            for (int i = 0; i < 80; i++)
+                SHA512_ROUND(wk[i][blk]);
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+            h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+        }
+    }
+    if (n > 0) sha512_blocks_scalar(h, p, n);
+}
+
+/*
+ * BLAKE2b, AVX2: each row of the 4x4 state is one register and G runs on
+ * all four columns at once. The diagonal step rotates rows 1..3 by one,
+ * two and three lanes so the diagonals line up as columns.
+ */
+#define B2B_MSG4(r, a, b, c, d)                                             \
+    _mm256_set_epi64x((int64_t)m[B2B_SIGMA[r][d]], (int64_t)m[B2B_SIGMA[r][c]], \
+                      (int64_t)m[B2B_SIGMA[r][b]], (int64_t)m[B2B_SIGMA[r][a]])
+
+#define B2B_G4(x, rot_d, rot_b) do {                                     \
+        ra = _mm256_add_epi64(_mm256_add_epi64(ra, rb), x);                 \
+        rd = rot_d(_mm256_xor_si256(rd, ra));                               \
+        rc = _mm256_add_epi64(rc, rd);                                      \
+        rb = rot_b(_mm256_xor_si256(rb, rc));                               \
+    } while (0)
+
+#define B2B_ROR32_4(x) _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define B2B_ROR24_4(x) _mm256_shuffle_epi8(x, r24)
+#define B2B_ROR16_4(x) _mm256_shuffle_epi8(x, r16)
+#define B2B_ROR63_4(x) _mm256_xor_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x))
+
+__attribute__((target("avx2")))
+static void blake2b_compress_avx2(uint64_t *h, const uint8_t *p, uint64_t t,
+                                  uint64_t f0, uint64_t f1)
+{
+    const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                         3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                         2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    uint64_t m[16];
+    memcpy(m, p, sizeof m);     /* x86 is little-endian */
+
+    __m256i ra = _mm256_loadu_si256((const __m256i *)&h[0]);
+    __m256i rb = _mm256_loadu_si256((const __m256i *)&h[4]);
+    __m256i rc = _mm256_loadu_si256((const __m256i *)&B2B_IV[0]);
+    __m256i rd = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&B2B_IV[4]),
+                                  _mm256_set_epi64x((int64_t)f1, (int64_t)f0, 0, (int64_t)t));
+    const __m256i a0 = ra, b0 = rb;
+
+    for (int r = 0; r < 12; r++) {
+        B2B_G4(B2B_MSG4(r, 0, 2, 4, 6), B2B_ROR32_4, B2B_ROR24_4);
+        B2B_G4(B2B_MSG4(r, 1, 3, 5, 7), B2B_ROR16_4, B2B_ROR63_4);
+        rb = _mm256_permute4x64_epi64(rb, _MM_SHUFFLE(0, 3, 2, 1));
+        rc = _mm256_permute4x64_epi64(rc, _MM_SHUFFLE(1, 0, 3, 2));
+        rd = _mm256_permute4x64_epi64(rd, _MM_SHUFFLE(2, 1, 0, 3));
+        B2B_G4(B2B_MSG4(r, 8, 10, 12, 14), B2B_ROR32_4, B2B_ROR24_4);
+        B2B_G4(B2B_MSG4(r, 9, 11, 13, 15), B2B_ROR16_4, B2B_ROR63_4);
+        rb = _mm256_permute4x64_epi64(rb, _MM_SHUFFLE(2, 1, 0, 3));
+        rc = _mm256_permute4x64_epi64(rc, _MM_SHUFFLE(1, 0, 3, 2));
+        rd = _mm256_permute4x64_epi64(rd, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+
+    _mm256_storeu_si256((__m256i *)&h[0], _mm256_xor_si256(a0, _mm256_xor_si256(ra, rc)));
+    _mm256_storeu_si256((__m256i *)&h[4], _mm256_xor_si256(b0, _mm256_xor_si256(rb, rd)));
+}
+
+/*
+ * BLAKE2b, SSE4.1: each row is split across a low and a high register
+ * (lanes 0-1 and 2-3); diagonalising uses alignr across the pair.
+ */
+#define B2B_MSG2(r, a, b) \
+    _mm_set_epi64x((int64_t)m[B2B_SIGMA[r][b]], (int64_t)m[B2B_SIGMA[r][a]])
+
+#define B2B_ROR32_2(x) _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define B2B_ROR24_2(x) _mm_shuffle_epi8(x, r24)
+#define B2B_ROR16_2(x) _mm_shuffle_epi8(x, r16)
+#define B2B_ROR63_2(x) _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x))
+
+#define B2B_G2(xl, xh, rot_d, rot_b) do {                                   \
+        al = _mm_add_epi64(_mm_add_epi64(al, bl), xl);                      \
+        ah = _mm_add_epi64(_mm_add_epi64(ah, bh), xh);                      \
+        dl = rot_d(_mm_xor_si128(dl, al));                                  \
+        dh = rot_d(_mm_xor_si128(dh, ah));                                  \
+        cl = _mm_add_epi64(cl, dl);                                         \
+        ch = _mm_add_epi64(ch, dh);                                         \
+        bl = rot_b(_mm_xor_si128(bl, cl));                                  \
+        bh = rot_b(_mm_xor_si128(bh, ch));                                  \
+    } while (0)
+
+__attribute__((target("sse4.1")))
+static void blake2b_compress_sse41(uint64_t *h, const uint8_t *p, uint64_t t,
+                                   uint64_t f0, uint64_t f1)
+{
+    const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    uint64_t m[16];
+    memcpy(m, p, sizeof m);
+
+    __m128i al = _mm_loadu_si128((const __m128i *)&h[0]);
+    __m128i ah = _mm_loadu_si128((const __m128i *)&h[2]);
+    __m128i bl = _mm_loadu_si128((const __m128i *)&h[4]);
+    __m128i bh = _mm_loadu_si128((const __m128i *)&h[6]);
+    __m128i cl = _mm_loadu_si128((const __m128i *)&B2B_IV[0]);
+    __m128i ch = _mm_loadu_si128((const __m128i *)&B2B_IV[2]);
+    __m128i dl = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&B2B_IV[4]),
+                               _mm_set_epi64x(0, (int64_t)t));
+    __m128i dh = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&B2B_IV[6]),
+                               _mm_set_epi64x((int64_t)f1, (int64_t)f0));
+    __m128i t0, t1;
+
+    for (int r = 0; r < 12; r++) {
+        B2B_G2(B2B_MSG2(r, 0, 2), B2B_MSG2(r, 4, 6), B2B_ROR32_2, B2B_ROR24_2);
+        B2B_G2(B2B_MSG2(r, 1, 3), B2B_MSG2(r, 5, 7), B2B_ROR16_2, B2B_ROR63_2);
+
+        /* diagonalise: b <<< 1 lane, c <<< 2, d <<< 3 */
+        t0 = _mm_alignr_epi8(bh, bl, 8);
+        t1 = _mm_alignr_epi8(bl, bh, 8);
+        bl = t0; bh = t1;
+        t0 = cl; cl = ch; ch = t0;
+        t0 = _mm_alignr_epi8(dh, dl, 8);
+        t1 = _mm_alignr_epi8(dl, dh, 8);
+        dl = t1; dh = t0;
+
+        B2B_G2(B2B_MSG2(r, 8, 10), B2B_MSG2(r, 12, 14), B2B_ROR32_2, B2B_ROR24_2);
+        B2B_G2(B2B_MSG2(r, 9, 11), B2B_MSG2(r, 13, 15), B2B_ROR16_2, B2B_ROR63_2);
+
+        /* undo */
+        t0 = _mm_alignr_epi8(bl, bh, 8);
+        t1 = _mm_alignr_epi8(bh, bl, 8);
+        bl = t0; bh = t1;
+        t0 = cl; cl = ch; ch = t0;
+        t0 = _mm_alignr_epi8(dl, dh, 8);
+        t1 = _mm_alignr_epi8(dh, dl, 8);
+        dl = t1; dh = t0;
+    }
+
+    _mm_storeu_si128((__m128i *)&h[0], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&h[0]),
+                                                     _mm_xor_si128(al, cl)));
+    _mm_storeu_si128((__m128i *)&h[2], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&h[2]),
+                                                     _mm_xor_si128(ah, ch)));
+    _mm_storeu_si128((__m128i *)&h[4], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&h[4]),
+                                                     _mm_xor_si128(bl, dl)));
+    _mm_storeu_si128((__m128i *)&h[6], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&h[6]),
+                                                     _mm_xor_si128(bh, dh)));
+}
+
+/*
+ * SHA-256, eight independent messages at once: lane l of every AVX2
+ * register belongs to message l, so the 64 rounds run on eight blocks for
+ * roughly the cost of one. st[i][l] is state word i of lane l. The
+ * message words come from an 8x8 transpose of each lane's block.
+ */
+#define X8_ROR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+/* Words k..k+7 of eight blocks, transposed so w[i] holds word k+i of
+   every block; off is the byte offset of word k */
+__attribute__((target("avx2")))
+static void x8_transpose(__m256i *w, const uint8_t *const blk[8], size_t off)
+{
+    __m256i r[8], t[8], u[8];
+    for (int l = 0; l < 8; l++)
+        r[l] = _mm256_loadu_si256((const __m256i *)(blk[l] + off));
+    for (int l = 0; l < 8; l += 2) {
+        t[l]     = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+        t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+    }
+    for (int l = 0; l < 8; l += 4) {
+        u[l]     = _mm256_unpacklo_epi64(t[l], t[l + 2]);
+        u[l + 1] = _mm256_unpackhi_epi64(t[l], t[l + 2]);
+        u[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+        u[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+    }
+    for (int k = 0; k < 4; k++) {
+        w[k]     = _mm256_permute2x128_si256(u[k], u[k + 4], 0x20);
+        w[k + 4] = _mm256_permute2x128_si256(u[k], u[k + 4], 0x31);
+    }
+}
+
+__attribute__((target("avx2")))
+static void sha256_x8_load(__m256i *w, const uint8_t *const blk[8], int half)
+{
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    x8_transpose(w, blk, 32 * (size_t)half);
+    for (int k = 0; k < 8; k++) w[k] = _mm256_shuffle_epi8(w[k], bswap);
+}
+
+__attribute__((target("avx2")))
+static void sha256_x8_block(uint32_t st[8][8], const uint8_t *const blk[8])
+{
+    __m256i w[16];
+    sha256_x8_load(w, blk, 0);
+    sha256_x8_load(w + 8, blk, 1);
+
+    __m256i a = _mm256_loadu_si256((const __m256i *)st[0]);
+    __m256i b = _mm256_loadu_si256((const __m256i *)st[1]);
+    __m256i c = _mm256_loadu_si256((const __m256i *)st[2]);
+    __m256i d = _mm256_loadu_si256((const __m256i *)st[3]);
+    __m256i e = _mm256_loadu_si256((const __m256i *)st[4]);
+    __m256i f = _mm256_loadu_si256((const __m256i *)st[5]);
+    __m256i g = _mm256_loadu_si256((const __m256i *)st[6]);
+    __m256i h = _mm256_loadu_si256((const __m256i *)st[7]);
+
+    for (int i = 0; i < 64; i++) {
+        if (i >= 16) {
+            __m256i x = w[(i - 15) & 15], y = w[(i - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(X8_ROR(x, 7), X8_ROR(x, 18)),
+                                          _mm256_srli_epi32(x, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(X8_ROR(y, 17), X8_ROR(y, 19)),
+                                          _mm256_srli_epi32(y, 10));
+            w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0),
+                                         _mm256_add_epi32(w[(i - 7) & 15], s1));
+        }
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(X8_ROR(e, 6), X8_ROR(e, 11)), X8_ROR(e, 25));
+        __m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1),
+                         _mm256_add_epi32(ch, _mm256_add_epi32(w[i & 15],
+                             _mm256_set1_epi32((int)K256[i]))));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(X8_ROR(a, 2), X8_ROR(a, 13)), X8_ROR(a, 22));
+        __m256i mj = _mm256_or_si256(_mm256_and_si256(a, b),
+                                     _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        h = g; g = f; f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a;
+        a = _mm256_add_epi32(t1, _mm256_add_epi32(S0, mj));
+    }
+
+    __m256i *s = (__m256i *)st;
+    _mm256_storeu_si256(s + 0, _mm256_add_epi32(a, _mm256_loadu_si256(s + 0)));
+    _mm256_storeu_si256(s + 1, _mm256_add_epi32(b, _mm256_loadu_si256(s + 1)));
+    _mm256_storeu_si256(s + 2, _mm256_add_epi32(c, _mm256_loadu_si256(s + 2)));
+    _mm256_storeu_si256(s + 3, _mm256_add_epi32(d, _mm256_loadu_si256(s + 3)));
+    _mm256_storeu_si256(s + 4, _mm256_add_epi32(e, _mm256_loadu_si256(s + 4)));
+    _mm256_storeu_si256(s + 5, _mm256_add_epi32(f, _mm256_loadu_si256(s + 5)));
+    _mm256_storeu_si256(s + 6, _mm256_add_epi32(g, _mm256_loadu_si256(s + 6)));
+    _mm256_storeu_si256(s + 7, _mm256_add_epi32(h, _mm256_loadu_si256(s + 7)));
+}
+
+/*
+ * BLAKE2bp leaves, all four at once: lane l of every register is leaf l
+ * and v[i] holds state word i of each, so G runs down the columns and
+ * diagonals with no lane shuffles. The message words come from a 4x4
+ * transpose of the leaves' blocks. h is word-major (h[word][leaf]); n
+ * stripes of four 128-byte blocks, none of them a last block.
+ */
+#define TREE_G(add, rot_d1, rot_b1, rot_d2, rot_b2, a, b, c, d, x, y) do {   \
+        v[a] = add(add(v[a], v[b]), mm[x]);                                 \
+        v[d] = rot_d1(_mm256_xor_si256(v[d], v[a]));                        \
+        v[c] = add(v[c], v[d]);                                             \
+        v[b] = rot_b1(_mm256_xor_si256(v[b], v[c]));                        \
+        v[a] = add(add(v[a], v[b]), mm[y]);                                 \
+        v[d] = rot_d2(_mm256_xor_si256(v[d], v[a]));                        \
+        v[c] = add(v[c], v[d]);                                             \
+        v[b] = rot_b2(_mm256_xor_si256(v[b], v[c]));                        \
+    } while (0)
+
+#define TREE_ROUND(G, s) do {                                               \
+        G(0, 4,  8, 12, (s)[0],  (s)[1]);                                   \
+        G(1, 5,  9, 13, (s)[2],  (s)[3]);                                   \
+        G(2, 6, 10, 14, (s)[4],  (s)[5]);                                   \
+        G(3, 7, 11, 15, (s)[6],  (s)[7]);                                   \
+        G(0, 5, 10, 15, (s)[8],  (s)[9]);                                   \
+        G(1, 6, 11, 12, (s)[10], (s)[11]);                                  \
+        G(2, 7,  8, 13, (s)[12], (s)[13]);                                  \
+        G(3, 4,  9, 14, (s)[14], (s)[15]);                                  \
+    } while (0)
+
+#define BP_G(a, b, c, d, x, y) \
+    TREE_G(_mm256_add_epi64, B2B_ROR32_4, B2B_ROR24_4, B2B_ROR16_4, B2B_ROR63_4, a, b, c, d, x, y)
+
+__attribute__((target("avx2")))
+static void blake2bp_x4(uint64_t h[8][4], const uint8_t *p, size_t n, uint64_t t)
+{
+    const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                         3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                         2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    __m256i hv[8], mm[16], v[16];
+    for (int i = 0; i < 8; i++) hv[i] = _mm256_loadu_si256((const __m256i *)h[i]);
+
+    for (; n > 0; n--, p += 512) {
+        for (int j = 0; j < 16; j += 4) {
+            __m256i r0 = _mm256_loadu_si256((const __m256i *)(p + 0 * 128 + 8 * j));
+            __m256i r1 = _mm256_loadu_si256((const __m256i *)(p + 1 * 128 + 8 * j));
+            __m256i r2 = _mm256_loadu_si256((const __m256i *)(p + 2 * 128 + 8 * j));
+            __m256i r3 = _mm256_loadu_si256((const __m256i *)(p + 3 * 128 + 8 * j));
+            __m256i t0 = _mm256_unpacklo_epi64(r0, r1), t1 = _mm256_unpackhi_epi64(r0, r1);
+            __m256i t2 = _mm256_unpacklo_epi64(r2, r3), t3 = _mm256_unpackhi_epi64(r2, r3);
+            mm[j]     = _mm256_permute2x128_si256(t0, t2, 0x20);
+            mm[j + 1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+            mm[j + 2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+            mm[j + 3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+        }
+        t += 128;
+        for (int i = 0; i < 8; i++) {
+            v[i]     = hv[i];
+            v[i + 8] = _mm256_set1_epi64x((int64_t)B2B_IV[i]);
+        }
+        v[12] = _mm256_set1_epi64x((int64_t)(B2B_IV[4] ^ t));
+
+        for (int r = 0; r < 12; r++) TREE_ROUND(BP_G, B2B_SIGMA[r]);
+        for (int i = 0; i < 8; i++)
+            hv[i] = _mm256_xor_si256(hv[i], _mm256_xor_si256(v[i], v[i + 8]));
+    }
+    for (int i = 0; i < 8; i++) _mm256_storeu_si256((__m256i *)h[i], hv[i]);
+}
+
+/*
+ * BLAKE2sp leaves, all eight at once in the 32-bit lanes; the same
+ * layout as blake2bp_x4 with eight 64-byte blocks per stripe.
+ */
+#define B2S_ROR16_8(x) _mm256_shuffle_epi8(x, r16)
+#define B2S_ROR8_8(x)  _mm256_shuffle_epi8(x, r8)
+#define B2S_ROR12_8(x) X8_ROR(x, 12)
+#define B2S_ROR7_8(x)  X8_ROR(x, 7)
+#define SP_G(a, b, c, d, x, y) \
+    TREE_G(_mm256_add_epi32, B2S_ROR16_8, B2S_ROR12_8, B2S_ROR8_8, B2S_ROR7_8, a, b, c, d, x, y)
+
+__attribute__((target("avx2")))
+static void blake2sp_x8(uint32_t h[8][8], const uint8_t *p, size_t n, uint64_t t)
+{
+    const __m256i r16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                         2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i r8  = _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+                                         1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+    __m256i hv[8], mm[16], v[16];
+    for (int i = 0; i < 8; i++) hv[i] = _mm256_loadu_si256((const __m256i *)h[i]);
+
+    for (; n > 0; n--, p += 512) {
+        const uint8_t *blk[8];
+        for (int l = 0; l < 8; l++) blk[l] = p + 64 * l;
+        x8_transpose(mm, blk, 0);
+        x8_transpose(mm + 8, blk, 32);
+        t += 64;
+        for (int i = 0; i < 8; i++) {
+            v[i]     = hv[i];
+            v[i + 8] = _mm256_set1_epi32((int)B2S_IV[i]);
+        }
+        v[12] = _mm256_set1_epi32((int)(B2S_IV[4] ^ (uint32_t)t));
+        v[13] = _mm256_set1_epi32((int)(B2S_IV[5] ^ (uint32_t)(t >> 32)));
+
+        for (int r = 0; r < 10; r++) TREE_ROUND(SP_G, B2B_SIGMA[r]);
+        for (int i = 0; i < 8; i++)
+            hv[i] = _mm256_xor_si256(hv[i], _mm256_xor_si256(v[i], v[i + 8]));
+    }
+    for (int i = 0; i < 8; i++) _mm256_storeu_si256((__m256i *)h[i], hv[i]);
+}
+
+#endif /* DIGEST_X86 */
+
+/* ------------------------------------------------------------------ */
+/* Dispatch                                                            */
+/* ------------------------------------------------------------------ */
+
+typedef void (*blocks32_fn)(uint32_t *h, const uint8_t *p, size_t n);
+typedef void (*blocks64_fn)(uint64_t *h, const uint8_t *p, size_t n);
+typedef void (*b2b_fn)(uint64_t *h, const uint8_t *p, uint64_t t,
+                       uint64_t f0, uint64_t f1);
+
+static blocks32_fn sha1_blocks    = sha1_blocks_scalar;
+static blocks32_fn sha256_blocks  = sha256_blocks_scalar;
+static blocks64_fn sha512_blocks  = sha512_blocks_scalar;
+static b2b_fn      blake2b_compress = blake2b_compress_scalar;
+
+/* Eight-lane SHA-256 for digest_many; NULL when the CPU has no kernel */
+typedef void (*x8_fn)(uint32_t st[8][8], const uint8_t *const blk[8]);
+static x8_fn       sha256_x8 = NULL;
+
+/* All-leaf tree kernels; NULL = one leaf at a time */
+typedef void (*bp_fn)(uint64_t h[8][4], const uint8_t *p, size_t n, uint64_t t);
+typedef void (*sp_fn)(uint32_t h[8][8], const uint8_t *p, size_t n, uint64_t t);
+static bp_fn       blake2bp_leaves = NULL;
+static sp_fn       blake2sp_leaves = NULL;
+
+void digest_cpu_init(void)
+{
+    static int done = 0;
+    if (done) return;
+    done = 1;
+#ifdef DIGEST_X86
+    bool shani = false;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        /* SHA-NI is CPUID leaf 7 EBX bit 29; older compilers'
+           __builtin_cpu_supports() does not know it */
+        unsigned a, b, c, d;
+        if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 29))) {
+            sha1_blocks   = sha1_blocks_shani;
+            sha256_blocks = sha256_blocks_shani;
+            shani = true;
+        }
+        blake2b_compress = blake2b_compress_sse41;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        /* One SHA-NI stream outruns eight AVX2 lanes, so the multi-buffer
+           kernel is only for CPUs without it */
+        if (!shani) sha256_x8 = sha256_x8_block;
+        blake2b_compress = blake2b_compress_avx2;
+        blake2bp_leaves  = blake2bp_x4;
+        blake2sp_leaves  = blake2sp_x8;
+        if (__builtin_cpu_supports("bmi2"))
+            sha512_blocks = sha512_blocks_avx2;
+    }
+#endif
+}
+
+/* ------------------------------------------------------------------ */
+/* Streaming                                                           */
+/* ------------------------------------------------------------------ */
+
+size_t digest_default_size(DigestAlgo algo)
+{
+    switch (algo) {
+    case DIGEST_MD5:    return 16;
+    case DIGEST_SHA1:   return 20;
+    case DIGEST_SHA224: return 28;
+    case DIGEST_SHA256: return 32;
+    case DIGEST_SHA384: return 48;
+    case DIGEST_BLAKE2S:
+    case DIGEST_BLAKE2SP: return 32;
+    default:            return 64;
+    }
+}
+
+const char *digest_tag(DigestAlgo algo)
+{
+    switch (algo) {
+    case DIGEST_MD5:    return "MD5";
+    case DIGEST_SHA1:   return "SHA1";
+    case DIGEST_SHA224: return "SHA224";
+    case DIGEST_SHA256: return "SHA256";
+    case DIGEST_SHA384: return "SHA384";
+    case DIGEST_SHA512: return "SHA512";
+    case DIGEST_BLAKE2S:  return "BLAKE2s";
+    case DIGEST_BLAKE2BP: return "BLAKE2bp";
+    case DIGEST_BLAKE2SP: return "BLAKE2sp";
+    default:            return "BLAKE2b";
+    }
+}
+
+int digest_leaves(DigestAlgo algo)
+{
+    return algo == DIGEST_BLAKE2BP ? 4 : algo == DIGEST_BLAKE2SP ? 8 : 1;
+}
+
+size_t digest_stripe(DigestAlgo algo)
+{
+    return digest_leaves(algo) > 1 ? DIGEST_MAX_STRIPE : 0;
+}
+
+int digest_tree_vector(DigestAlgo algo)
+{
+    digest_cpu_init();
+    return (algo == DIGEST_BLAKE2BP && blake2bp_leaves) ||
+           (algo == DIGEST_BLAKE2SP && blake2sp_leaves);
+}
+
+/* ------------------------------------------------------------------ */
+/* BLAKE2 nodes                                                        */
+/* ------------------------------------------------------------------ */
+
+/* BLAKE2b and BLAKE2bp work in 64-bit words, BLAKE2s and BLAKE2sp in 32 */
+static bool b2_wide(DigestAlgo algo)
+{
+    return algo == DIGEST_BLAKE2B || algo == DIGEST_BLAKE2BP;
+}
+
+/* IV xor the parameter block; plain hashing is fanout 1, depth 1 */
+static void b2_node(DigestAlgo algo, DigestWords *h, size_t size, size_t keylen,
+                    int fanout, int depth, uint32_t offset, int node_depth, size_t inner)
+{
+    uint32_t p0 = (uint32_t)size | (uint32_t)keylen << 8 |
+                  (uint32_t)fanout << 16 | (uint32_t)depth << 24;
+    if (b2_wide(algo)) {
+        memcpy(h->w64, B2B_IV, sizeof B2B_IV);
+        h->w64[0] ^= p0;
+        h->w64[1] ^= offset;
+        h->w64[2] ^= (uint64_t)node_depth | (uint64_t)inner << 8;
+    } else {
+        memcpy(h->w32, B2S_IV, sizeof B2S_IV);
+        h->w32[0] ^= p0;
+        h->w32[2] ^= offset;
+        h->w32[3] ^= (uint32_t)node_depth << 16 | (uint32_t)inner << 24;
+    }
+}
+
+/* t counts bytes up to and including this block */
+static void b2_compress(DigestAlgo algo, DigestWords *h, const uint8_t *p, uint64_t t,
+                        bool last, bool last_node)
+{
+    if (b2_wide(algo))
+        blake2b_compress(h->w64, p, t, last ? ~(uint64_t)0 : 0, last_node ? ~(uint64_t)0 : 0);
+    else
+        blake2s_compress(h->w32, p, t, last ? ~0u : 0, last_node ? ~0u : 0);
+}
+
+static void b2_output(DigestAlgo algo, const DigestWords *h, uint8_t *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = b2_wide(algo) ? (uint8_t)(h->w64[i / 8] >> (8 * (i % 8)))
+                               : (uint8_t)(h->w32[i / 4] >> (8 * (i % 4)));
+}
+
+static void leaf_get(const DigestCtx *c, int l, DigestWords *h)
+{
+    for (int i = 0; i < 8; i++) {
+        if (b2_wide(c->algo)) h->w64[i] = c->leaf.w64[i][l];
+        else                  h->w32[i] = c->leaf.w32[i][l];
+    }
+}
+
+static void leaf_put(DigestCtx *c, int l, const DigestWords *h)
+{
+    for (int i = 0; i < 8; i++) {
+        if (b2_wide(c->algo)) c->leaf.w64[i][l] = h->w64[i];
+        else                  c->leaf.w32[i][l] = h->w32[i];
+    }
+}
+
+/* One leaf: its held-back block, then its block of each stripe but the
+   last, which becomes the new held-back block */
+static void leaf_feed(DigestCtx *c, int l, const uint8_t *p, size_t n)
+{
+    size_t bs = c->block;
+    uint64_t t = c->total;
+    DigestWords h;
+
+    leaf_get(c, l, &h);
+    if (c->has_pend) {
+        t += bs;
+        b2_compress(c->algo, &h, c->pend + l * bs, t, false, false);
+    }
+    for (size_t k = 0; k + 1 < n; k++) {
+        t += bs;
+        b2_compress(c->algo, &h, p + k * DIGEST_MAX_STRIPE + l * bs, t, false, false);
+    }
+    leaf_put(c, l, &h);
+    memcpy(c->pend + l * bs, p + (n - 1) * DIGEST_MAX_STRIPE + l * bs, bs);
+}
+
+void digest_tree_feed(DigestCtx *c, const uint8_t *p, size_t n, int first, int count)
+{
+    if (n == 0) return;
+    if (count == digest_leaves(c->algo)) {
+        uint64_t t = c->total;
+        if (c->algo == DIGEST_BLAKE2BP && blake2bp_leaves) {
+            if (c->has_pend) blake2bp_leaves(c->leaf.w64, c->pend, 1, t);
+            blake2bp_leaves(c->leaf.w64, p, n - 1, t + (c->has_pend ? 128 : 0));
+            memcpy(c->pend, p + (n - 1) * DIGEST_MAX_STRIPE, DIGEST_MAX_STRIPE);
+            return;
+        }
+        if (c->algo == DIGEST_BLAKE2SP && blake2sp_leaves) {
+            if (c->has_pend) blake2sp_leaves(c->leaf.w32, c->pend, 1, t);
+            blake2sp_leaves(c->leaf.w32, p, n - 1, t + (c->has_pend ? 64 : 0));
+            memcpy(c->pend, p + (n - 1) * DIGEST_MAX_STRIPE, DIGEST_MAX_STRIPE);
+            return;
+        }
+    }
+    for (int l = first; l < first + count; l++) leaf_feed(c, l, p, n);
+}
+
+void digest_tree_done(DigestCtx *c, size_t n)
+{
+    if (n == 0) return;
+    c->total += (n - 1 + (c->has_pend ? 1 : 0)) * c->block;
+    c->has_pend = 1;
+}
+
+static void tree_update(DigestCtx *c, const uint8_t *p, size_t len)
+{
+    int leaves = digest_leaves(c->algo);
+    if (c->buflen > 0) {
+        size_t take = DIGEST_MAX_STRIPE - c->buflen;
+        if (take > len) take = len;
+        memcpy(c->buf + c->buflen, p, take);
+        c->buflen += take;
+        p += take;
+        len -= take;
+        if (c->buflen < DIGEST_MAX_STRIPE) return;
+        digest_tree_feed(c, c->buf, 1, 0, leaves);
+        digest_tree_done(c, 1);
+        c->buflen = 0;
+    }
+    size_t n = len / DIGEST_MAX_STRIPE;
+    digest_tree_feed(c, p, n, 0, leaves);
+    digest_tree_done(c, n);
+    p   += n * DIGEST_MAX_STRIPE;
+    len -= n * DIGEST_MAX_STRIPE;
+    memcpy(c->buf, p, len);
+    c->buflen = len;
+}
+
+/*
+ * Each leaf ends with its share of the buffered partial stripe, or with
+ * its held-back block when that share is empty; the last leaf carries
+ * the last-node flag. The root hashes the leaf digests in leaf order.
+ */
+static void tree_final(DigestCtx *c, uint8_t *out)
+{
+    int leaves = digest_leaves(c->algo);
+    size_t bs = c->block;
+    size_t inner = digest_default_size(c->algo);
+    uint8_t mid[DIGEST_MAX_STRIPE / 2];
+    DigestWords h;
+
+    for (int l = 0; l < leaves; l++) {
+        size_t off = l * bs;
+        size_t have = c->buflen > off ? c->buflen - off : 0;
+        if (have > bs) have = bs;
+        uint8_t last[DIGEST_MAX_BLOCK] = { 0 };
+        memcpy(last, c->buf + off, have);
+        const uint8_t *fin = last;
+        uint64_t t = c->total;
+
+        leaf_get(c, l, &h);
+        if (c->has_pend) {
+            if (have > 0) {
+                t += bs;
+                b2_compress(c->algo, &h, c->pend + off, t, false, false);
+            } else {
+                fin  = c->pend + off;
+                have = bs;
+            }
+        }
+        b2_compress(c->algo, &h, fin, t + have, true, l == leaves - 1);
+        b2_output(c->algo, &h, mid + l * inner, inner);
+    }
+
+    b2_node(c->algo, &h, c->size, c->keylen, leaves, 2, 0, 1, inner);
+    size_t total = leaves * inner;
+    for (size_t off = 0; off < total; off += bs)
+        b2_compress(c->algo, &h, mid + off, off + bs, off + bs == total, off + bs == total);
+    b2_output(c->algo, &h, out, c->size);
+}
+
+
+void digest_init(DigestCtx *c, DigestAlgo algo, size_t size)
+{
+    digest_init_key(c, algo, size, NULL, 0);
+}
+
+void digest_init_key(DigestCtx *c, DigestAlgo algo, size_t size,
+                     const uint8_t *key, size_t keylen)
+{
+    static const uint32_t iv_md5[4] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+    };
+    static const uint32_t iv_sha1[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+    static const uint32_t iv_sha224[8] = {
+        0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+        0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+    };
+    static const uint32_t iv_sha256[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    static const uint64_t iv_sha384[8] = {
+        0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL,
+        0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+        0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+        0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL
+    };
+
+    digest_cpu_init();
+    memset(c, 0, sizeof *c);
+    c->algo  = algo;
+    c->size  = size ? size : digest_default_size(algo);
+    c->block = (algo == DIGEST_SHA384 || algo == DIGEST_SHA512 ||
+                algo == DIGEST_BLAKE2B || algo == DIGEST_BLAKE2BP) ? 128 : 64;
+    c->keylen = keylen;
+
+    switch (algo) {
+    case DIGEST_MD5:    memcpy(c->h.w32, iv_md5, sizeof iv_md5);       break;
+    case DIGEST_SHA1:   memcpy(c->h.w32, iv_sha1, sizeof iv_sha1);     break;
+    case DIGEST_SHA224: memcpy(c->h.w32, iv_sha224, sizeof iv_sha224); break;
+    case DIGEST_SHA256: memcpy(c->h.w32, iv_sha256, sizeof iv_sha256); break;
+    case DIGEST_SHA384: memcpy(c->h.w64, iv_sha384, sizeof iv_sha384); break;
+    case DIGEST_SHA512: memcpy(c->h.w64, B2B_IV, sizeof B2B_IV);       break; /* same words */
+    case DIGEST_BLAKE2B:
+    case DIGEST_BLAKE2S:
+        b2_node(algo, &c->h, c->size, keylen, 1, 1, 0, 0, 0);
+        break;
+    case DIGEST_BLAKE2BP:
+    case DIGEST_BLAKE2SP:
+        /* Leaves carry the final digest length in their parameter block
+           but output a full inner digest */
+        for (int l = 0; l < digest_leaves(algo); l++) {
+            DigestWords h;
+            b2_node(algo, &h, c->size, keylen, digest_leaves(algo), 2, (uint32_t)l, 0,
+                    digest_default_size(algo));
+            leaf_put(c, l, &h);
+        }
+        break;
+    }
+
+    /* A key is hashed as a first block of its own, in every leaf of a tree */
+    if (keylen > 0) {
+        if (digest_leaves(algo) > 1) {
+            for (int l = 0; l < digest_leaves(algo); l++)
+                memcpy(c->pend + l * c->block, key, keylen);
+            c->has_pend = 1;
+        } else {
+            memcpy(c->buf, key, keylen);
+            c->buflen = c->block;
+        }
+    }
+}
+
+static void run_blocks(DigestCtx *c, const uint8_t *p, size_t n)
+{
+    switch (c->algo) {
+    case DIGEST_MD5:    md5_blocks(c->h.w32, p, n);    break;
+    case DIGEST_SHA1:   sha1_blocks(c->h.w32, p, n);   break;
+    case DIGEST_SHA224:
+    case DIGEST_SHA256: sha256_blocks(c->h.w32, p, n); break;
+    case DIGEST_SHA384:
+    case DIGEST_SHA512: sha512_blocks(c->h.w64, p, n); break;
+    case DIGEST_BLAKE2B:
+    case DIGEST_BLAKE2S:
+        /* The counter is part of every compression, so one at a time */
+        for (; n > 0; n--, p += c->block) {
+            c->total += c->block;
+            b2_compress(c->algo, &c->h, p, c->total, false, false);
+        }
+        return;
+    default:
+        return;
+    }
+    c->total += (uint64_t)n * c->block;
+}
+
+void digest_update(DigestCtx *c, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    if (digest_leaves(c->algo) > 1) {
+        tree_update(c, p, len);
+        return;
+    }
+    /* BLAKE2 must keep the final block back until digest_final sets the
+       last-block flag, so it only compresses when more input follows. */
+    size_t keep = (c->algo == DIGEST_BLAKE2B || c->algo == DIGEST_BLAKE2S) ? 1 : 0;
+
+    if (c->buflen > 0) {
+        size_t take = c->block - c->buflen;
+        if (take > len) take = len;
+        memcpy(c->buf + c->buflen, p, take);
+        c->buflen += take;
+        p += take;
+        len -= take;
+        if (c->buflen < c->block || len < keep) return;
+        run_blocks(c, c->buf, 1);
+        c->buflen = 0;
+    }
+    if (len >= keep) {
+        size_t n = (len - keep) / c->block;
+        if (n > 0) {
+            run_blocks(c, p, n);
+            p   += n * c->block;
+            len -= n * c->block;
+        }
+    }
+    memcpy(c->buf, p, len);
+    c->buflen = len;
+}
+
+void digest_final(DigestCtx *c, uint8_t *out)
+{
+    uint8_t full[DIGEST_MAX_SIZE];
+
+    if (digest_leaves(c->algo) > 1) {
+        tree_final(c, out);
+        return;
+    }
+    if (c->algo == DIGEST_BLAKE2B || c->algo == DIGEST_BLAKE2S) {
+        memset(c->buf + c->buflen, 0, c->block - c->buflen);
+        b2_compress(c->algo, &c->h, c->buf, c->total + c->buflen, true, false);
+        b2_output(c->algo, &c->h, out, c->size);
+        return;
+    }
+
+    /* Merkle–Damgård padding: 0x80, zeros, then the bit length in the
+       last 8 (or 16) bytes of the block */
+    uint64_t bits = (c->total + c->buflen) << 3;
+    size_t   lenbytes = c->block == 128 ? 16 : 8;
+    c->buf[c->buflen++] = 0x80;
+    if (c->buflen > c->block - lenbytes) {
+        memset(c->buf + c->buflen, 0, c->block - c->buflen);
+        run_blocks(c, c->buf, 1);
+        c->buflen = 0;
+    }
+    memset(c->buf + c->buflen, 0, c->block - c->buflen);
+    for (int i = 0; i < 8; i++) {
+        uint8_t b = (uint8_t)(bits >> (8 * i));
+        if (c->algo == DIGEST_MD5) c->buf[c->block - 8 + i] = b;
+        else                       c->buf[c->block - 1 - i] = b;
+    }
+    run_blocks(c, c->buf, 1);
+
+    if (c->algo == DIGEST_MD5) {
+        for (int i = 0; i < 16; i++) full[i] = (uint8_t)(c->h.w32[i / 4] >> (8 * (i % 4)));
+    } else if (c->block == 64) {
+        for (size_t i = 0; i < c->size; i++)
+            full[i] = (uint8_t)(c->h.w32[i / 4] >> (24 - 8 * (i % 4)));
+    } else {
+        for (size_t i = 0; i < c->size; i++)
+            full[i] = (uint8_t)(c->h.w64[i / 8] >> (56 - 8 * (i % 8)));
+    }
+    memcpy(out, full, c->size);
+}
+
+int digest_stream(FILE *f, DigestCtx *c, uint8_t *out)
+{
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof buf, f)) > 0)
+        digest_update(c, buf, n);
+    if (ferror(f)) return -1;
+    digest_final(c, out);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Many small messages                                                 */
+/* ------------------------------------------------------------------ */
+
+int digest_lanes(DigestAlgo algo)
+{
+    digest_cpu_init();
+    if ((algo == DIGEST_SHA256 || algo == DIGEST_SHA224) && sha256_x8) return 8;
+    return 1;
+}
+
+/* One message being fed through a lane: its whole blocks in place, then
+   one or two padded tail blocks built here. */
+typedef struct {
+    const uint8_t *p;
+    size_t   nblk;          /* whole blocks in the message */
+    size_t   total;         /* nblk + tail blocks */
+    size_t   pos;           /* next block to compress */
+    size_t   msg;           /* index into the caller's arrays */
+    uint8_t  tail[128];
+} Lane;
+
+static void lane_start(Lane *ln, const uint8_t *p, size_t len, size_t msg)
+{
+    size_t rest = len % 64;
+    size_t ntail = rest < 56 ? 1 : 2;
+    uint64_t bits = (uint64_t)len << 3;
+
+    ln->p     = p;
+    ln->nblk  = len / 64;
+    ln->total = ln->nblk + ntail;
+    ln->pos   = 0;
+    ln->msg   = msg;
+    memset(ln->tail, 0, sizeof ln->tail);
+    memcpy(ln->tail, p + ln->nblk * 64, rest);
+    ln->tail[rest] = 0x80;
+    for (int i = 0; i < 8; i++)
+        ln->tail[ntail * 64 - 1 - i] = (uint8_t)(bits >> (8 * i));
+}
+
+static const uint8_t *lane_block(const Lane *ln)
+{
+    return ln->pos < ln->nblk ? ln->p + ln->pos * 64
+                              : ln->tail + (ln->pos - ln->nblk) * 64;
+}
+
+static void put_be32s(uint8_t *out, const uint32_t *h, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        out[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+void digest_many(DigestAlgo algo, size_t n, const uint8_t *const *msg,
+                 const size_t *len, uint8_t *out)
+{
+    size_t size = digest_default_size(algo);
+    DigestCtx c;
+
+    if (digest_lanes(algo) < 8 || n < 2) {
+        for (size_t i = 0; i < n; i++) {
+            digest_init(&c, algo, 0);
+            digest_update(&c, msg[i], len[i]);
+            digest_final(&c, out + i * size);
+        }
+        return;
+    }
+
+    static const uint8_t idle_block[64];
+    uint32_t st[8][8];
+    uint32_t iv[8];
+    Lane lanes[8];
+    bool busy[8];
+    const uint8_t *blk[8];
+    size_t next = 0;
+    int active = 0;
+
+    digest_init(&c, algo, 0);
+    memcpy(iv, c.h.w32, sizeof iv);
+
+    for (int l = 0; l < 8; l++) {
+        busy[l] = next < n;
+        if (busy[l]) {
+            lane_start(&lanes[l], msg[next], len[next], next);
+            next++;
+            active++;
+        }
+        for (int i = 0; i < 8; i++) st[i][l] = iv[i];
+    }
+
+    /* Once the queue is empty and a single message is left, the one-stream
+       kernel finishes it sooner than eight lanes carrying seven idle ones. */
+    while (active > 1 || (active == 1 && next < n)) {
+        for (int l = 0; l < 8; l++)
+            blk[l] = busy[l] ? lane_block(&lanes[l]) : idle_block;
+        sha256_x8(st, blk);
+
+        for (int l = 0; l < 8; l++) {
+            Lane *ln = &lanes[l];
+            if (!busy[l] || ++ln->pos < ln->total) continue;
+            uint32_t h[8];
+            for (int i = 0; i < 8; i++) {
+                h[i] = st[i][l];
+                st[i][l] = iv[i];
+            }
+            put_be32s(out + ln->msg * size, h, size);
+            if (next < n) {
+                lane_start(ln, msg[next], len[next], next);
+                next++;
+            } else {
+                busy[l] = false;
+                active--;
+            }
+        }
+    }
+
+    for (int l = 0; l < 8; l++) {
+        if (!busy[l]) continue;
+        Lane *ln = &lanes[l];
+        uint32_t h[8];
+        for (int i = 0; i < 8; i++) h[i] = st[i][l];
+        if (ln->pos < ln->nblk) {
+            sha256_blocks(h, ln->p + ln->pos * 64, ln->nblk - ln->pos);
+            ln->pos = ln->nblk;
+        }
+        sha256_blocks(h, ln->tail + (ln->pos - ln->nblk) * 64, ln->total - ln->pos);
+        put_be32s(out + ln->msg * size, h, size);
+    }
+}
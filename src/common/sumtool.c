@@ -0,0 +1,792 @@
+/*
+ * sumtool.c — shared driver for md5sum, sha1sum, sha224sum, sha256sum,
+ * sha384sum, sha512sum and b2sum
+ *
+ * Output is the GNU format "HEX  NAME", or "TAG (NAME) = HEX" with --tag.
+ * -c reads either format back; BLAKE2b lines without -l take their digest
+ * length from the hex string or the "BLAKE2b-BITS" tag. Check files may
+ * have lines of any length.
+ *
+ * Files to hash (arguments, or the entries of a check file) become jobs.
+ * --parallel hashes a batch of jobs on a thread pool and then reports the
+ * batch in order, so output matches a serial run line for line; serial
+ * runs use batches of one and report each file as soon as it is done.
+ *
+ * Where the digest library has a multi-buffer kernel (SHA-224/256 on CPUs
+ * with AVX2 but no SHA-NI), files under 64 KB are read whole and hashed
+ * sixteen at a time with digest_many(); serial runs then use batches of
+ * 256 so there are small files to group.
+ *
+ * b2sum also selects BLAKE2s and the BLAKE2bp/BLAKE2sp tree modes (-a,
+ * --tree) and keyed hashing (--key, --key-file). A tree-mode file larger
+ * than one read chunk has its leaves spread over threads when there are
+ * CPUs for every leaf, or when the CPU has no SIMD kernel that runs all
+ * the leaves in one thread anyway.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <ctype.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+#include "sumtool.h"
+#include "threads.h"
+
+#define BATCH_SIZE  4096
+#define SMALL_FILE  (64 * 1024)   /* files below this go to the multi-buffer kernel */
+#define GROUP       16            /* small files per digest_many() call */
+#define SERIAL_MB_BATCH 256       /* serial batch when small files are grouped */
+#define TREE_CHUNK  (8 * 1024 * 1024)   /* read size when leaves run on threads */
+
+typedef struct {
+    const char *prog;
+    DigestAlgo  algo;
+    size_t      size;       /* digest bytes from -l; 0 = algorithm default */
+    bool        text_mode;
+    bool        tag;
+    bool        quiet;
+    bool        status;
+    int         nthreads;
+    int         leaf_threads;   /* threads for the leaves of one tree-mode file */
+    uint8_t     key[DIGEST_MAX_SIZE];
+    size_t      keylen;
+} SumOpts;
+
+typedef struct {
+    char         *line;     /* -c: owned copy of the check line */
+    const char   *name;     /* file to hash; NULL for a malformed check line */
+    const char   *expected; /* -c: lower-case hex digest to compare with */
+    unsigned long lineno;   /* -c: line in the check file */
+    size_t        size;     /* digest bytes */
+    uint8_t       digest[DIGEST_MAX_SIZE];
+    int           err;      /* errno of a failed open or read, else 0 */
+} Job;
+
+typedef struct {
+    unsigned long bad_lines, unreadable, mismatched, good;
+} CheckStats;
+
+static void to_hex(const uint8_t *d, size_t n, char *s)
+{
+    for (size_t i = 0; i < n; i++) {
+        s[i * 2]     = "0123456789abcdef"[d[i] >> 4];
+        s[i * 2 + 1] = "0123456789abcdef"[d[i] & 15];
+    }
+    s[n * 2] = '\0';
+}
+
+/* Hash the rest of f into j, after `have` bytes already read into pre */
+static int tree_stream(const SumOpts *o, DigestCtx *c, FILE *f, uint8_t *out);
+
+static void finish_job(const SumOpts *o, Job *j, FILE *f, const uint8_t *pre, size_t have)
+{
+    DigestCtx c;
+    digest_init_key(&c, o->algo, j->size, o->key, o->keylen);
+    digest_update(&c, pre, have);
+    errno = 0;
+    int rc = o->leaf_threads > 1 ? tree_stream(o, &c, f, j->digest)
+                                 : digest_stream(f, &c, j->digest);
+    if (rc != 0) j->err = errno ? errno : EIO;
+    if (f != stdin) fclose(f);
+}
+
+static void print_sum(const SumOpts *o, const char *path, const uint8_t *d, size_t size)
+{
+    char hex[2 * DIGEST_MAX_SIZE + 1];
+    to_hex(d, size, hex);
+    if (!o->tag)
+        printf("%s  %s\n", hex, path);
+    else if (size != digest_default_size(o->algo))
+        printf("%s-%d (%s) = %s\n", digest_tag(o->algo), (int)size * 8, path, hex);
+    else
+        printf("%s (%s) = %s\n", digest_tag(o->algo), path, hex);
+}
+
+/*
+ * Small files for the multi-buffer kernel: each is read whole into a
+ * slot and hashed with GROUP-1 others in one digest_many() call.
+ */
+typedef struct {
+    Job     *job[GROUP];
+    size_t   len[GROUP];
+    uint8_t *data;          /* GROUP slots of SMALL_FILE bytes */
+    int      n;
+} Group;
+
+static void flush_group(const SumOpts *o, Group *g)
+{
+    const uint8_t *msg[GROUP];
+    uint8_t out[GROUP * DIGEST_MAX_SIZE];
+    size_t size = digest_default_size(o->algo);
+
+    for (int i = 0; i < g->n; i++) msg[i] = g->data + (size_t)i * SMALL_FILE;
+    digest_many(o->algo, (size_t)g->n, msg, g->len, out);
+    for (int i = 0; i < g->n; i++) memcpy(g->job[i]->digest, out + i * size, size);
+    g->n = 0;
+}
+
+/* Hash one job. With a group, a file shorter than SMALL_FILE is queued
+   for flush_group() instead; anything longer streams as usual. */
+static void run_job(const SumOpts *o, Job *j, Group *g)
+{
+    FILE *f = strcmp(j->name, "-") == 0 ? stdin
+            : fopen(j->name, o->text_mode ? "r" : "rb");
+    if (!f) {
+        j->err = errno;
+        return;
+    }
+    if (!g || f == stdin || j->size != digest_default_size(o->algo)) {
+        finish_job(o, j, f, NULL, 0);
+        return;
+    }
+
+    uint8_t *slot = g->data + (size_t)g->n * SMALL_FILE;
+    errno = 0;
+    size_t got = fread(slot, 1, SMALL_FILE, f);
+    if (got == SMALL_FILE) {
+        finish_job(o, j, f, slot, got);
+        return;
+    }
+    if (ferror(f)) j->err = errno ? errno : EIO;
+    fclose(f);
+    if (j->err) return;
+
+    g->job[g->n] = j;
+    g->len[g->n] = got;
+    if (++g->n == GROUP) flush_group(o, g);
+}
+
+/* ------------------------------------------------------------------ */
+/* Thread pool                                                         */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    const SumOpts *o;
+    Job           *jobs;
+    long           njobs;
+    volatile long  next;    /* next job to claim — __sync_fetch_and_add */
+} Pool;
+
+/* Workers claim one file at a time so a few huge files cannot leave the
+ * other threads idle. Standard input is left for the main thread. When
+ * the algorithm has a multi-buffer kernel each worker batches its small
+ * files into a Group. */
+static void hash_worker(void *arg)
+{
+    Pool *p = (Pool *)arg;
+    Group grp, *g = NULL;
+    if (digest_lanes(p->o->algo) > 1) {
+        grp.n = 0;
+        grp.data = malloc((size_t)GROUP * SMALL_FILE);
+        if (grp.data) g = &grp;
+    }
+
+    for (;;) {
+        long i = __sync_fetch_and_add(&p->next, 1);
+        if (i >= p->njobs) break;
+        Job *j = &p->jobs[i];
+        if (j->name && strcmp(j->name, "-") != 0) run_job(p->o, j, g);
+    }
+
+    if (g) {
+        if (g->n > 0) flush_group(p->o, g);
+        free(g->data);
+    }
+}
+
+static void run_pool(Pool *p, int nthreads)
+{
+    run_threads(hash_worker, p, nthreads > p->njobs ? (int)p->njobs : nthreads);
+}
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int n = (int)si.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    if (n > THREADS_MAX) n = THREADS_MAX;
+    return n;
+}
+
+/*
+ * One tree-mode file on several threads: each chunk of whole stripes is
+ * fed to every thread's share of the leaves at once. Shares are claimed
+ * from a counter, so a thread that cannot be started leaves its share
+ * to the others.
+ */
+typedef struct {
+    DigestCtx     *c;
+    const uint8_t *p;
+    size_t         n;
+    int            nshares;
+    volatile long  next;    /* next share to claim */
+} LeafWork;
+
+static void leaf_worker(void *arg)
+{
+    LeafWork *w = (LeafWork *)arg;
+    int leaves = digest_leaves(w->c->algo);
+    long t;
+    while ((t = __sync_fetch_and_add(&w->next, 1)) < w->nshares) {
+        int first = (int)(t * leaves / w->nshares);
+        int count = (int)((t + 1) * leaves / w->nshares) - first;
+        digest_tree_feed(w->c, w->p, w->n, first, count);
+    }
+}
+
+static void feed_leaves(DigestCtx *c, const uint8_t *p, size_t n, int nthreads)
+{
+    LeafWork w = { c, p, n, nthreads, 0 };
+    run_threads(leaf_worker, &w, nthreads);
+    digest_tree_done(c, n);
+}
+
+/* Like digest_stream(), but full chunks go through feed_leaves(); a file
+   that fits in one chunk is hashed on this thread alone. */
+static int tree_stream(const SumOpts *o, DigestCtx *c, FILE *f, uint8_t *out)
+{
+    uint8_t *buf = malloc(TREE_CHUNK);
+    if (!buf) return digest_stream(f, c, out);
+
+    size_t stripe = digest_stripe(c->algo);
+    size_t got;
+    while ((got = fread(buf, 1, TREE_CHUNK, f)) > 0) {
+        size_t n = 0;
+        if (got == TREE_CHUNK && c->buflen == 0) {
+            n = got / stripe;
+            feed_leaves(c, buf, n, o->leaf_threads);
+        }
+        digest_update(c, buf + n * stripe, got - n * stripe);
+    }
+    bool err = ferror(f) != 0;
+    free(buf);
+    if (err) return -1;
+    digest_final(c, out);
+    return 0;
+}
+
+/* Hash every job of a batch, standard input last and on this thread */
+static void hash_batch(const SumOpts *o, Job *jobs, int n)
+{
+    Pool p = { o, jobs, n, 0 };
+    run_pool(&p, o->nthreads);
+    for (int i = 0; i < n; i++) {
+        if (jobs[i].name && strcmp(jobs[i].name, "-") == 0) run_job(o, &jobs[i], NULL);
+    }
+}
+
+static void free_batch(Job *jobs, int n)
+{
+    for (int i = 0; i < n; i++) free(jobs[i].line);
+}
+
+/* ------------------------------------------------------------------ */
+/* Hash mode                                                           */
+/* ------------------------------------------------------------------ */
+
+static int report_sums(const SumOpts *o, const Job *jobs, int n)
+{
+    int ret = 0;
+    for (int i = 0; i < n; i++) {
+        const Job *j = &jobs[i];
+        if (j->err) {
+            fprintf(stderr, "%s: %s: %s\n", o->prog, j->name, strerror(j->err));
+            ret = 1;
+        } else {
+            print_sum(o, j->name, j->digest, j->size);
+        }
+    }
+    return ret;
+}
+
+static int sum_files(const SumOpts *o, char **names, int count, Job *jobs, int batch)
+{
+    size_t size = o->size ? o->size : digest_default_size(o->algo);
+    int ret = 0;
+    for (int i = 0; i < count; ) {
+        int n = 0;
+        for (; n < batch && i < count; n++, i++) {
+            memset(&jobs[n], 0, sizeof(Job));
+            jobs[n].name = names[i];
+            jobs[n].size = size;
+        }
+        hash_batch(o, jobs, n);
+        ret |= report_sums(o, jobs, n);
+    }
+    return ret;
+}
+
+/* ------------------------------------------------------------------ */
+/* Check mode                                                          */
+/* ------------------------------------------------------------------ */
+
+/* Read a line of any length into *buf without its newline or a trailing
+   CR. Returns false at end of file. */
+static bool read_line(FILE *f, char **buf, size_t *cap)
+{
+    size_t len = 0;
+    for (;;) {
+        if (*cap - len < 2) {
+            size_t ncap = *cap ? *cap * 2 : 256;
+            char *nb = realloc(*buf, ncap);
+            if (!nb) return false;
+            *buf = nb;
+            *cap = ncap;
+        }
+        if (!fgets(*buf + len, (int)(*cap - len), f)) {
+            if (len == 0) return false;
+            break;
+        }
+        len += strlen(*buf + len);
+        if ((*buf)[len - 1] == '\n') break;
+    }
+    while (len > 0 && ((*buf)[len - 1] == '\n' || (*buf)[len - 1] == '\r'))
+        len--;
+    (*buf)[len] = '\0';
+    return true;
+}
+
+/* Lower-case a run of hex digits in place; returns its length, or 0 if
+   it is not hex up to end. */
+static size_t hex_run(char *s, const char *end)
+{
+    size_t n = 0;
+    for (; s + n < end; n++) {
+        if (!isxdigit((unsigned char)s[n])) return 0;
+        s[n] = (char)tolower((unsigned char)s[n]);
+    }
+    return n;
+}
+
+/* The BLAKE2 family takes -l and keys */
+static bool is_blake2(DigestAlgo algo)
+{
+    return algo == DIGEST_BLAKE2B  || algo == DIGEST_BLAKE2S ||
+           algo == DIGEST_BLAKE2BP || algo == DIGEST_BLAKE2SP;
+}
+
+/* Is a hex string of n characters a valid digest for this tool? */
+static bool size_ok(const SumOpts *o, size_t n)
+{
+    if (n == 0 || n % 2 != 0) return false;
+    if (o->size)                   return n == o->size * 2;
+    if (is_blake2(o->algo))        return n <= 2 * digest_default_size(o->algo);
+    return n == digest_default_size(o->algo) * 2;
+}
+
+/*
+ * Split a check line into expected hex digest and file name; accepts
+ * "HEX  NAME", "HEX *NAME" and "TAG (NAME) = HEX". The line is modified
+ * in place. Returns false if it is not a well-formed line for this tool.
+ */
+static bool parse_line(const SumOpts *o, char *line, char **hex, size_t *size, char **name)
+{
+    const char *tag = digest_tag(o->algo);
+    size_t tl = strlen(tag);
+
+    if (strncmp(line, tag, tl) == 0 && (line[tl] == ' ' || line[tl] == '-')) {
+        char *p = line + tl;
+        size_t bits = 0;
+        if (*p == '-') {
+            if (!is_blake2(o->algo)) return false;
+            char *e;
+            bits = strtoul(p + 1, &e, 10);
+            if (e == p + 1 || bits == 0 || bits % 8 != 0) return false;
+            p = e;
+        }
+        if (strncmp(p, " (", 2) != 0) return false;
+        char *nm = p + 2;
+        char *close = NULL;
+        for (char *q = strstr(nm, ") = "); q; q = strstr(q + 1, ") = "))
+            close = q;          /* the name itself may contain ") = " */
+        if (!close) return false;
+        *close = '\0';
+        char *h = close + 4;
+        size_t n = hex_run(h, h + strlen(h));
+        if (!size_ok(o, n)) return false;
+        if (bits ? n != bits / 4
+                 : (is_blake2(o->algo) && n != 2 * digest_default_size(o->algo) && !o->size))
+            return false;
+        *hex  = h;
+        *size = n / 2;
+        *name = nm;
+        return true;
+    }
+
+    char *sp = strchr(line, ' ');
+    if (!sp || (sp[1] != ' ' && sp[1] != '*') || sp[2] == '\0') return false;
+    size_t n = hex_run(line, sp);
+    if (!size_ok(o, n)) return false;
+    *sp   = '\0';
+    *hex  = line;
+    *size = n / 2;
+    *name = sp + 2;
+    return true;
+}
+
+static void report_checks(const SumOpts *o, const char *listfile,
+                          const Job *jobs, int n, CheckStats *st)
+{
+    for (int i = 0; i < n; i++) {
+        const Job *j = &jobs[i];
+        if (!j->name) {
+            st->bad_lines++;
+            if (!o->status)
+                fprintf(stderr, "%s: %s: %lu: improperly formatted %s checksum line\n",
+                        o->prog, listfile, j->lineno, digest_tag(o->algo));
+            continue;
+        }
+        if (j->err) {
+            st->unreadable++;
+            if (!o->status) {
+                fprintf(stderr, "%s: %s: %s\n", o->prog, j->name, strerror(j->err));
+                printf("%s: FAILED open or read\n", j->name);
+            }
+            continue;
+        }
+
+        char got[2 * DIGEST_MAX_SIZE + 1];
+        to_hex(j->digest, j->size, got);
+        if (strcmp(got, j->expected) == 0) {
+            st->good++;
+            if (!o->status && !o->quiet) printf("%s: OK\n", j->name);
+        } else {
+            st->mismatched++;
+            if (!o->status) printf("%s: FAILED\n", j->name);
+        }
+    }
+}
+
+static int check_file(const SumOpts *o, const char *listfile, Job *jobs, int batch)
+{
+    FILE *cf = strcmp(listfile, "-") == 0 ? stdin : fopen(listfile, "r");
+    if (!cf) {
+        fprintf(stderr, "%s: %s: %s\n", o->prog, listfile, strerror(errno));
+        return 1;
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    unsigned long lineno = 0;
+    CheckStats st = { 0, 0, 0, 0 };
+    bool nomem = false;
+    int n = 0;
+
+    while (read_line(cf, &line, &cap)) {
+        lineno++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        Job *j = &jobs[n];
+        memset(j, 0, sizeof(Job));
+        j->lineno = lineno;
+        j->line = strdup(p);
+        if (!j->line) { nomem = true; break; }
+        char *expected, *name;
+        if (parse_line(o, j->line, &expected, &j->size, &name)) {
+            j->expected = expected;
+            j->name = name;
+        }
+        if (++n == batch) {
+            hash_batch(o, jobs, n);
+            report_checks(o, listfile, jobs, n, &st);
+            free_batch(jobs, n);
+            n = 0;
+        }
+    }
+    hash_batch(o, jobs, n);
+    report_checks(o, listfile, jobs, n, &st);
+    free_batch(jobs, n);
+
+    bool read_err = ferror(cf) != 0;
+    if (cf != stdin) fclose(cf);
+    free(line);
+
+    if (nomem) {
+        fprintf(stderr, "%s: out of memory\n", o->prog);
+        return 1;
+    }
+    if (read_err) {
+        fprintf(stderr, "%s: %s: read error\n", o->prog, listfile);
+        return 1;
+    }
+    if (st.good + st.unreadable + st.mismatched == 0) {
+        fprintf(stderr, "%s: %s: no properly formatted %s checksum lines found\n",
+                o->prog, listfile, digest_tag(o->algo));
+        return 1;
+    }
+    if (!o->status) {
+        if (st.bad_lines)
+            fprintf(stderr, "%s: WARNING: %lu line(s) improperly formatted\n",
+                    o->prog, st.bad_lines);
+        if (st.unreadable)
+            fprintf(stderr, "%s: WARNING: %lu listed file(s) could not be read\n",
+                    o->prog, st.unreadable);
+        if (st.mismatched)
+            fprintf(stderr, "%s: WARNING: %lu computed checksum(s) did NOT match\n",
+                    o->prog, st.mismatched);
+    }
+    return (st.unreadable || st.mismatched) ? 1 : 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* main                                                                */
+/* ------------------------------------------------------------------ */
+
+static void usage(const char *prog, DigestAlgo algo, bool pick)
+{
+    printf("Usage: %s [OPTION]... [FILE]...\n", prog);
+    printf("Print or check %s checksums.\n", digest_tag(algo));
+    puts("");
+    puts("With no FILE, or when FILE is -, read standard input.");
+    puts("");
+    if (pick) {
+        puts("  -a, --algorithm=NAME  blake2b (default), blake2s, or the tree modes");
+        puts("                 blake2bp and blake2sp");
+    }
+    puts("  -b, --binary   read in binary mode (the default)");
+    puts("  -c, --check    read checksums from the FILEs and check them");
+    if (is_blake2(algo)) {
+        puts("      --key=HEX  keyed hash (MAC) with this key");
+        puts("      --key-file=FILE  keyed hash with the raw bytes of FILE as the key");
+        puts("  -l, --length=BITS  digest length in bits (multiple of 8, up to");
+        puts("                 512 for BLAKE2b/bp, 256 for BLAKE2s/sp)");
+    }
+    puts("      --tag      create a BSD-style checksum line");
+    puts("  -t, --text     read in text mode");
+    if (pick)
+        puts("      --tree     same as -a blake2bp");
+    puts("      --quiet    (with -c) don't print OK for each verified file");
+    puts("      --status   (with -c) don't output anything, status code shows success");
+    puts("      --parallel[=N]  hash files on N threads (default: all CPUs); output");
+    puts("                 stays in argument / check-file order");
+    puts("      --help     display this help and exit");
+    puts("      --version  output version information and exit");
+}
+
+static bool set_algo(SumOpts *o, const char *name)
+{
+    static const struct { const char *name; DigestAlgo algo; } names[] = {
+        { "blake2b",  DIGEST_BLAKE2B },  { "blake2s",  DIGEST_BLAKE2S },
+        { "blake2bp", DIGEST_BLAKE2BP }, { "blake2sp", DIGEST_BLAKE2SP },
+    };
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; i++) {
+        if (strcmp(name, names[i].name) == 0) {
+            o->algo = names[i].algo;
+            return true;
+        }
+    }
+    fprintf(stderr, "%s: invalid algorithm: '%s'\n", o->prog, name);
+    return false;
+}
+
+static bool set_key_hex(SumOpts *o, const char *hex)
+{
+    size_t n = strlen(hex);
+    if (n == 0 || n % 2 != 0 || n / 2 > DIGEST_MAX_SIZE) {
+        fprintf(stderr, "%s: invalid key: '%s'\n", o->prog, hex);
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!isxdigit((unsigned char)hex[i])) {
+            fprintf(stderr, "%s: invalid key: '%s'\n", o->prog, hex);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < n / 2; i++) {
+        char byte[3] = { hex[2 * i], hex[2 * i + 1], '\0' };
+        o->key[i] = (uint8_t)strtoul(byte, NULL, 16);
+    }
+    o->keylen = n / 2;
+    return true;
+}
+
+static bool set_key_file(SumOpts *o, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: %s: %s\n", o->prog, path, strerror(errno));
+        return false;
+    }
+    uint8_t tmp[DIGEST_MAX_SIZE + 1];
+    size_t n = fread(tmp, 1, sizeof tmp, f);
+    bool bad = ferror(f) != 0;
+    fclose(f);
+    if (bad || n == 0 || n > DIGEST_MAX_SIZE) {
+        fprintf(stderr, "%s: %s: key must be 1 to %d bytes\n", o->prog, path, DIGEST_MAX_SIZE);
+        return false;
+    }
+    memcpy(o->key, tmp, n);
+    o->keylen = n;
+    return true;
+}
+
+/* "--name=VALUE" or "--name VALUE"; *val is NULL if the value is missing */
+static bool long_opt(const char *a, const char *name, int argc, char **argv,
+                     int *argi, const char **val)
+{
+    size_t n = strlen(name);
+    if (strncmp(a, name, n) != 0) return false;
+    if (a[n] == '=') {
+        *val = a + n + 1;
+        return true;
+    }
+    if (a[n] != '\0') return false;
+    *val = ++*argi < argc ? argv[*argi] : NULL;
+    return true;
+}
+
+/* cksum mode prints --tag lines unless --untagged is given */
+static int sum_main(int argc, char **argv, const char *prog, DigestAlgo algo, bool cksum)
+{
+    SumOpts o = { prog, algo, 0, false, cksum, false, false, 1, 1, { 0 }, 0 };
+    bool check = false;
+    bool has_len = is_blake2(algo);
+    bool pick = algo == DIGEST_BLAKE2B && !cksum;   /* b2sum -a / --tree */
+    const char *length = NULL;
+    const char *val;
+
+    int argi;
+    for (argi = 1; argi < argc; argi++) {
+        const char *a = argv[argi];
+        if (strcmp(a, "--") == 0) { argi++; break; }
+        if (a[0] != '-' || a[1] == '\0') break;
+
+        if (a[1] == '-') {
+            if      (strcmp(a, "--help") == 0)    { usage(prog, algo, pick); return 0; }
+            else if (strcmp(a, "--version") == 0) { printf("%s 1.0 (Winix 1.0)\n", prog); return 0; }
+            else if (strcmp(a, "--check") == 0)   check = true;
+            else if (strcmp(a, "--binary") == 0)  o.text_mode = false;
+            else if (strcmp(a, "--text") == 0)    o.text_mode = true;
+            else if (strcmp(a, "--tag") == 0)     o.tag = true;
+            else if (cksum && strcmp(a, "--untagged") == 0) o.tag = false;
+            else if (strcmp(a, "--quiet") == 0)   o.quiet = true;
+            else if (strcmp(a, "--status") == 0)  o.status = true;
+            else if (strcmp(a, "--parallel") == 0) o.nthreads = cpu_count();
+            else if (strncmp(a, "--parallel=", 11) == 0) {
+                o.nthreads = atoi(a + 11);
+                if (o.nthreads < 1) o.nthreads = 1;
+                if (o.nthreads > THREADS_MAX) o.nthreads = THREADS_MAX;
+            }
+            else if (pick && strcmp(a, "--tree") == 0) o.algo = DIGEST_BLAKE2BP;
+            else if ((has_len && long_opt(a, "--length", argc, argv, &argi, &val)) ||
+                     (pick && long_opt(a, "--algorithm", argc, argv, &argi, &val)) ||
+                     (has_len && long_opt(a, "--key-file", argc, argv, &argi, &val)) ||
+                     (has_len && long_opt(a, "--key", argc, argv, &argi, &val))) {
+                if (!val) {
+                    fprintf(stderr, "%s: option '%.*s' requires an argument\n",
+                            prog, (int)strcspn(a, "="), a);
+                    return 1;
+                }
+                if      (strncmp(a, "--length", 8) == 0)    length = val;
+                else if (strncmp(a, "--algorithm", 11) == 0) { if (!set_algo(&o, val)) return 1; }
+                else if (strncmp(a, "--key-file", 10) == 0)  { if (!set_key_file(&o, val)) return 1; }
+                else if (!set_key_hex(&o, val))              return 1;
+            } else {
+                fprintf(stderr, "%s: unrecognized option '%s'\n", prog, a);
+                return 1;
+            }
+            continue;
+        }
+
+        /* Short flags (may be combined; -l and -a take the rest or the next word) */
+        for (const char *p = a + 1; *p; p++) {
+            if      (*p == 'c') check = true;
+            else if (*p == 'b') o.text_mode = false;
+            else if (*p == 't') o.text_mode = true;
+            else if ((*p == 'l' && has_len) || (*p == 'a' && pick)) {
+                val = p[1] ? p + 1 : (++argi < argc ? argv[argi] : NULL);
+                if (!val) {
+                    fprintf(stderr, "%s: option requires an argument -- '%c'\n", prog, *p);
+                    return 1;
+                }
+                if (*p == 'l')               length = val;
+                else if (!set_algo(&o, val)) return 1;
+                break;
+            } else {
+                fprintf(stderr, "%s: invalid option -- '%c'\n", prog, *p);
+                return 1;
+            }
+        }
+    }
+
+    /* Lengths and keys are checked against the algorithm finally chosen */
+    size_t max = digest_default_size(o.algo);
+    if (length) {
+        char *e;
+        long bits = strtol(length, &e, 10);
+        if (*length == '\0' || *e != '\0' || bits < 8 || bits > (long)max * 8 || bits % 8 != 0) {
+            fprintf(stderr, "%s: invalid length: '%s'\n", prog, length);
+            return 1;
+        }
+        o.size = (size_t)bits / 8;
+    }
+    if (o.keylen > max) {
+        fprintf(stderr, "%s: key is longer than %d bytes\n", prog, (int)max);
+        return 1;
+    }
+    algo = o.algo;
+
+    /* One tree-mode file at a time: a thread per leaf when every leaf gets
+       a CPU; with fewer CPUs the all-leaf SIMD kernel is faster */
+    if (digest_leaves(algo) > 1 && o.nthreads == 1) {
+        int cpus = cpu_count();
+        if (cpus >= digest_leaves(algo))    o.leaf_threads = digest_leaves(algo);
+        else if (!digest_tree_vector(algo)) o.leaf_threads = cpus;
+    }
+
+#ifdef _WIN32
+    if (!o.text_mode) _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    digest_cpu_init();
+
+    /* Serial runs report each file as soon as it is hashed, unless small
+       files are being grouped for the multi-buffer kernel */
+    int batch = o.nthreads > 1          ? BATCH_SIZE
+              : digest_lanes(algo) > 1  ? SERIAL_MB_BATCH
+              : 1;
+    Job *jobs = calloc((size_t)batch, sizeof(Job));
+    if (!jobs) {
+        fprintf(stderr, "%s: out of memory\n", prog);
+        return 1;
+    }
+
+    static char *stdin_name[] = { "-" };
+    char **names = argi < argc ? argv + argi : stdin_name;
+    int count    = argi < argc ? argc - argi : 1;
+    int ret = 0;
+    if (check) {
+        for (int i = 0; i < count; i++)
+            ret |= check_file(&o, names[i], jobs, batch);
+    } else {
+        ret = sum_files(&o, names, count, jobs, batch);
+    }
+    free(jobs);
+    return ret;
+}
+
+int sumtool_main(int argc, char **argv, const char *prog, DigestAlgo algo)
+{
+    return sum_main(argc, argv, prog, algo, false);
+}
+
+int sumtool_cksum(int argc, char **argv, DigestAlgo algo)
+{
+    return sum_main(argc, argv, "cksum", algo, true);
+}
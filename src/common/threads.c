@@ -0,0 +1,50 @@
+/*
+ * threads.c — run_threads() on CreateThread or pthreads
+ */
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "threads.h"
+
+typedef struct {
+    void (*fn)(void *);
+    void  *arg;
+} ThreadFn;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID a) { ThreadFn *t = (ThreadFn *)a; t->fn(t->arg); return 0; }
+#else
+static void *thread_entry(void *a) { ThreadFn *t = (ThreadFn *)a; t->fn(t->arg); return NULL; }
+#endif
+
+void run_threads(void (*fn)(void *), void *arg, int n)
+{
+    ThreadFn tf = { fn, arg };
+    if (n > THREADS_MAX) n = THREADS_MAX;
+    if (n <= 1) { fn(arg); return; }
+
+    n--;
+#ifdef _WIN32
+    HANDLE ths[THREADS_MAX];
+    int started = 0;
+    for (int t = 0; t < n; t++) {
+        ths[started] = CreateThread(NULL, 0, thread_entry, &tf, 0, NULL);
+        if (ths[started]) started++;
+    }
+    fn(arg);
+    if (started) WaitForMultipleObjects((DWORD)started, ths, TRUE, INFINITE);
+    for (int t = 0; t < started; t++) CloseHandle(ths[t]);
+#else
+    pthread_t ths[THREADS_MAX];
+    int started = 0;
+    for (int t = 0; t < n; t++) {
+        if (pthread_create(&ths[started], NULL, thread_entry, &tf) == 0) started++;
+    }
+    fn(arg);
+    for (int t = 0; t < started; t++) pthread_join(ths[t], NULL);
+#endif
+}
@@ -8,12 +8,21 @@
  *   --version / --help
  *
  * Exit: 0 = success, 1 = error
+ *
+ * Encoding and decoding run on the basenc block framework shared with
+ * base64; the kernels here handle whole 5-byte / 8-char groups.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <ctype.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+#include "basenc.h"
 
 #define VERSION "1.0"
 
@@ -24,93 +33,74 @@ static int g_decode  = 0;
 static int g_wrap    = 76;
 static int g_ignore  = 0;
 
-/* ── Encoding ────────────────────────────────────────────────── */
-
-static void encode(FILE *fp) {
-    unsigned char in[5];
-    char out[8];
-    int col = 0;
-    size_t n;
-
-    while ((n = fread(in, 1, 5, fp)) > 0) {
-        /* Pad to 5 bytes */
-        for (size_t i = n; i < 5; i++) in[i] = 0;
-
-        /* 5 bytes → 8 base32 chars */
-        out[0] = B32ALPHA[(in[0] >> 3) & 0x1F];
-        out[1] = B32ALPHA[((in[0] << 2) | (in[1] >> 6)) & 0x1F];
-        out[2] = B32ALPHA[(in[1] >> 1) & 0x1F];
-        out[3] = B32ALPHA[((in[1] << 4) | (in[2] >> 4)) & 0x1F];
-        out[4] = B32ALPHA[((in[2] << 1) | (in[3] >> 7)) & 0x1F];
-        out[5] = B32ALPHA[(in[3] >> 2) & 0x1F];
-        out[6] = B32ALPHA[((in[3] << 3) | (in[4] >> 5)) & 0x1F];
-        out[7] = B32ALPHA[in[4] & 0x1F];
-
-        /* Determine padding based on how many bytes were read */
-        int chars;
-        if      (n == 1) { chars = 2; }
-        else if (n == 2) { chars = 4; }
-        else if (n == 3) { chars = 5; }
-        else if (n == 4) { chars = 7; }
-        else             { chars = 8; }
-
-        for (int i = 0; i < chars; i++) {
-            putchar(out[i]);
-            if (g_wrap > 0 && ++col >= g_wrap) { putchar('\n'); col = 0; }
-        }
-        for (int i = chars; i < 8; i++) {
-            putchar('=');
-            if (g_wrap > 0 && ++col >= g_wrap) { putchar('\n'); col = 0; }
-        }
+/* ── Block kernels ───────────────────────────────────────────── */
+
+/* Character -> 5-bit value, 0xFF outside the alphabet (either case) */
+static unsigned char b32_decode[256];
+
+static void init_decode_table(void) {
+    memset(b32_decode, 0xFF, sizeof(b32_decode));
+    for (int i = 0; i < 32; i++) {
+        b32_decode[(unsigned char)B32ALPHA[i]] = (unsigned char)i;
+        b32_decode[tolower((unsigned char)B32ALPHA[i])] = (unsigned char)i;
     }
-    if (g_wrap == 0 || col > 0) putchar('\n');
 }
 
-/* ── Decoding ────────────────────────────────────────────────── */
+/* 5 bytes → 8 chars, as one 40-bit value */
+static void encode_group(const unsigned char *in, char *out) {
+    uint64_t v = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 24) |
+                 ((uint64_t)in[2] << 16) | ((uint64_t)in[3] << 8) | in[4];
+    for (int i = 7; i >= 0; i--) {
+        out[i] = B32ALPHA[v & 0x1F];
+        v >>= 5;
+    }
+}
 
-static int decode_char(int c) {
-    c = toupper(c);
-    if (c >= 'A' && c <= 'Z') return c - 'A';
-    if (c >= '2' && c <= '7') return c - '2' + 26;
-    return -1;
+static size_t encode_block(const unsigned char *in, size_t n, char *out) {
+    char *o = out;
+    size_t i = 0;
+    for (; i + 5 <= n; i += 5, o += 8)
+        encode_group(in + i, o);
+
+    if (i < n) {
+        /* Pad to 5 bytes; 1..4 bytes give 2, 4, 5 or 7 chars */
+        static const int chars[5] = { 0, 2, 4, 5, 7 };
+        unsigned char last[5] = { 0 };
+        memcpy(last, in + i, n - i);
+        encode_group(last, o);
+        memset(o + chars[n - i], '=', 8 - (size_t)chars[n - i]);
+        o += 8;
+    }
+    return (size_t)(o - out);
 }
 
-static int decode(FILE *fp) {
-    unsigned char buf[8];
-    int n = 0;
-    int c;
-
-    while ((c = fgetc(fp)) != EOF) {
-        if (c == '=' ) { buf[n++] = 0; if (n == 8) goto flush; continue; }
-        if (c == '\n' || c == '\r' || c == ' ') continue;
-        int v = decode_char(c);
-        if (v < 0) {
-            if (g_ignore) continue;
-            fprintf(stderr, "base32: invalid character '%c'\n", c); return 1;
-        }
-        buf[n++] = (unsigned char)v;
-        if (n == 8) {
-flush:
-            /* 8 base32 chars → 5 bytes */
-            unsigned char out[5];
-            out[0] = (buf[0] << 3) | (buf[1] >> 2);
-            out[1] = (buf[1] << 6) | (buf[2] << 1) | (buf[3] >> 4);
-            out[2] = (buf[3] << 4) | (buf[4] >> 1);
-            out[3] = (buf[4] << 7) | (buf[5] << 2) | (buf[6] >> 3);
-            out[4] = (buf[6] << 5) | buf[7];
-
-            /* Figure out how many output bytes (based on padding) */
-            /* We detect padding by checking which buf slots were '=' */
-            /* Simple: write all 5 and let the output be slightly over-read
-               — instead count non-padding input chars */
-            /* We already set padding slots to 0; determine count from n before flush */
-            fwrite(out, 1, 5, stdout);
-            n = 0;
+static size_t decode_block(const unsigned char *in, size_t n,
+                           unsigned char *out, size_t *used) {
+    unsigned char *o = out;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, o += 5) {
+        uint64_t v = 0;
+        unsigned bad = 0;
+        for (int j = 0; j < 8; j++) {
+            unsigned char d = b32_decode[in[i + j]];
+            bad |= d;
+            v = (v << 5) | (d & 0x1F);
         }
+        if (bad & 0x80) break;   /* newline, '=' or garbage in this group */
+        o[0] = (unsigned char)(v >> 32);
+        o[1] = (unsigned char)(v >> 24);
+        o[2] = (unsigned char)(v >> 16);
+        o[3] = (unsigned char)(v >> 8);
+        o[4] = (unsigned char)v;
     }
-    return 0;
+    *used = i;
+    return (size_t)(o - out);
 }
 
+static const BaseCodec codec = {
+    "base32", 5, 5, 8, b32_decode, encode_block, decode_block
+};
+
 int main(int argc, char *argv[]) {
     int argi = 1;
 
@@ -151,7 +141,14 @@ int main(int argc, char *argv[]) {
     FILE *fp = (argi < argc && strcmp(argv[argi], "-")) ? fopen(argv[argi], "rb") : stdin;
     if (!fp) { perror(argv[argi]); return 1; }
 
-    int ret = g_decode ? decode(fp) : (encode(fp), 0);
+#ifdef _WIN32
+    if (fp == stdin) _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    init_decode_table();
+    int ret = g_decode ? basenc_decode(fp, stdout, &codec, g_ignore != 0)
+                       : basenc_encode(fp, stdout, &codec, g_wrap);
     if (fp != stdin) fclose(fp);
     return ret;
 }
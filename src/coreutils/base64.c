@@ -14,18 +14,27 @@
  * Standard RFC 4648 base64 alphabet: A-Z a-z 0-9 + /
  * Padding: '=' character.
  *
- * Compile: C99, no dependencies beyond the C standard library.
+ * Data is processed in large blocks by the basenc framework. The block
+ * kernels here are scalar (12 bytes per step) with SSSE3 and AVX2
+ * variants chosen at runtime.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <errno.h>
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
 #endif
+#include "basenc.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define B64_X86 1
+#endif
 
 /* ------------------------------------------------------------------ */
 /* Base64 alphabet and tables                                           */
@@ -48,116 +57,232 @@ static void init_decode_table(void)
 }
 
 /* ------------------------------------------------------------------ */
-/* Encoding                                                             */
+/* Scalar kernels (reference, and for block tails)                      */
 /* ------------------------------------------------------------------ */
 
-static int do_encode(FILE *fin, int wrap)
+static void encode_group(const unsigned char *in, char *out)
 {
-    unsigned char in[3];
-    int col = 0;   /* current output column */
-
-    for (;;) {
-        /* Read up to 3 bytes */
-        int n = 0;
-        int c;
-        while (n < 3 && (c = fgetc(fin)) != EOF)
-            in[n++] = (unsigned char)c;
-
-        if (n == 0)
-            break;  /* EOF with nothing to flush */
-
-        /* Encode 3 (or fewer) bytes into 4 base64 chars */
-        unsigned char b0 = in[0];
-        unsigned char b1 = (n >= 2) ? in[1] : 0;
-        unsigned char b2 = (n >= 3) ? in[2] : 0;
-
-        char out[4];
-        out[0] = b64_chars[(b0 >> 2) & 0x3F];
-        out[1] = b64_chars[((b0 & 0x03) << 4) | ((b1 >> 4) & 0x0F)];
-        out[2] = (n >= 2) ? b64_chars[((b1 & 0x0F) << 2) | ((b2 >> 6) & 0x03)] : '=';
-        out[3] = (n >= 3) ? b64_chars[b2 & 0x3F] : '=';
-
-        for (int i = 0; i < 4; i++) {
-            if (wrap > 0 && col >= wrap) {
-                putchar('\n');
-                col = 0;
-            }
-            putchar(out[i]);
-            col++;
-        }
+    uint32_t v = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+    out[0] = b64_chars[v >> 18];
+    out[1] = b64_chars[(v >> 12) & 0x3F];
+    out[2] = b64_chars[(v >> 6) & 0x3F];
+    out[3] = b64_chars[v & 0x3F];
+}
+
+/* 12 input bytes (16 characters) per iteration, then single groups. */
+static size_t encode_scalar(const unsigned char *in, size_t n, char *out)
+{
+    char  *o = out;
+    size_t i = 0;
+    for (; i + 12 <= n; i += 12, o += 16) {
+        encode_group(in + i,     o);
+        encode_group(in + i + 3, o + 4);
+        encode_group(in + i + 6, o + 8);
+        encode_group(in + i + 9, o + 12);
+    }
+    for (; i + 3 <= n; i += 3, o += 4)
+        encode_group(in + i, o);
+
+    /* Encode 1 or 2 trailing bytes with '=' padding */
+    if (i < n) {
+        unsigned char b0 = in[i];
+        unsigned char b1 = (n - i == 2) ? in[i + 1] : 0;
+        o[0] = b64_chars[b0 >> 2];
+        o[1] = b64_chars[((b0 & 0x03) << 4) | (b1 >> 4)];
+        o[2] = (n - i == 2) ? b64_chars[(b1 & 0x0F) << 2] : '=';
+        o[3] = '=';
+        o += 4;
     }
+    return (size_t)(o - out);
+}
 
-    /* Final newline */
-    putchar('\n');
-    return 0;
+/* 16 characters (12 bytes) per iteration while every one is valid. */
+static size_t decode_scalar(const unsigned char *in, size_t n,
+                            unsigned char *out, size_t *used)
+{
+    unsigned char *o = out;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, o += 3) {
+        uint32_t a = b64_decode[in[i]],     b = b64_decode[in[i + 1]];
+        uint32_t c = b64_decode[in[i + 2]], d = b64_decode[in[i + 3]];
+        if ((a | b | c | d) & 0x80) break;   /* 0xFF marks a non-alphabet char */
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        o[0] = (unsigned char)(v >> 16);
+        o[1] = (unsigned char)(v >> 8);
+        o[2] = (unsigned char)v;
+    }
+    *used = i;
+    return (size_t)(o - out);
 }
 
+#ifdef B64_X86
 /* ------------------------------------------------------------------ */
-/* Decoding                                                             */
+/* SSSE3 / AVX2 kernels                                                 */
 /* ------------------------------------------------------------------ */
 
-static int do_decode(FILE *fin, bool ignore_garbage)
+/*
+ * Encoding: a byte shuffle puts each 3-byte group into a 32-bit lane as
+ * [b1 b0 b2 b1], two multiplies move the four 6-bit fields into separate
+ * bytes, and a 16-entry pshufb table turns each value into its ASCII
+ * offset. Decoding runs the same steps backwards; the character class is
+ * validated by ANDing lookups on the high and low nibbles.
+ */
+
+__attribute__((target("ssse3")))
+static inline __m128i enc_reshuffle_ssse3(__m128i in)
 {
-    /*
-     * Accumulate 4 base64 characters at a time, then emit 3 bytes.
-     * Whitespace is always silently skipped (standard behaviour).
-     * '=' signals padding and ends the stream.
-     */
-    unsigned char group[4];
-    int           gi        = 0;  /* index into group */
-    bool          seen_pad  = false;
-
-    int c;
-    while ((c = fgetc(fin)) != EOF) {
-        unsigned char uc = (unsigned char)c;
-
-        /* Always skip whitespace */
-        if (uc == ' ' || uc == '\t' || uc == '\n' || uc == '\r')
-            continue;
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                           4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
 
-        if (uc == '=') {
-            seen_pad = true;
-            /* Flush whatever we have collected */
-            break;
-        }
+__attribute__((target("ssse3")))
+static inline __m128i enc_translate_ssse3(__m128i in)
+{
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+                                      -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i idx = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    idx = _mm_sub_epi8(idx, _mm_cmpgt_epi8(in, _mm_set1_epi8(25)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, idx));
+}
 
-        unsigned char val = b64_decode[uc];
-        if (val == 0xFF) {
-            if (ignore_garbage)
-                continue;
-            fprintf(stderr, "base64: invalid input\n");
-            return 1;
-        }
+__attribute__((target("ssse3")))
+static size_t encode_ssse3(const unsigned char *in, size_t n, char *out)
+{
+    size_t i = 0, o = 0;
+    for (; i + 16 <= n; i += 12, o += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        v = enc_translate_ssse3(enc_reshuffle_ssse3(v));
+        _mm_storeu_si128((__m128i *)(out + o), v);
+    }
+    return o + encode_scalar(in + i, n - i, out + o);
+}
 
-        group[gi++] = val;
+__attribute__((target("avx2")))
+static size_t encode_avx2(const unsigned char *in, size_t n, char *out)
+{
+    const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                         10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i lut  = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                          65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    size_t i = 0, o = 0;
+    for (; i + 28 <= n; i += 24, o += 32) {
+        /* 12 bytes into each 128-bit lane */
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+            _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+        v = _mm256_shuffle_epi8(v, shuf);
+        __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+        __m256i idx = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        idx = _mm256_sub_epi8(idx, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, idx));
+        _mm256_storeu_si256((__m256i *)(out + o), v);
+    }
+    _mm256_zeroupper();
+    return o + encode_ssse3(in + i, n - i, out + o);
+}
 
-        if (gi == 4) {
-            /* Emit 3 bytes */
-            putchar((int)((group[0] << 2) | (group[1] >> 4)));
-            putchar((int)(((group[1] & 0x0F) << 4) | (group[2] >> 2)));
-            putchar((int)(((group[2] & 0x03) << 6) | group[3]));
-            gi = 0;
-        }
+__attribute__((target("ssse3")))
+static size_t decode_ssse3(const unsigned char *in, size_t n,
+                           unsigned char *out, size_t *used)
+{
+    const __m128i lut_lo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f  = _mm_set1_epi8(0x2F);
+    size_t i = 0, o = 0;
+    for (; i + 16 <= n; i += 16, o += 12) {
+        __m128i v  = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i hn = _mm_and_si128(_mm_srli_epi32(v, 4), mask_2f);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(v, mask_2f));
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hn);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())))
+            break;
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(v, mask_2f), hn));
+        v = _mm_add_epi8(v, roll);
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                              -1, -1, -1, -1));
+        _mm_storeu_si128((__m128i *)(out + o), v);
     }
+    size_t rest;
+    o += decode_scalar(in + i, n - i, out + o, &rest);
+    *used = i + rest;
+    return o;
+}
 
-    /* Handle partial group (with or without padding) */
-    if (gi == 1) {
-        /* Only 1 valid char — technically invalid; emit what we can */
-        if (!ignore_garbage) {
-            fprintf(stderr, "base64: invalid input (truncated stream)\n");
-            return 1;
-        }
-    } else if (gi == 2) {
-        /* 2 chars → 1 byte */
-        putchar((int)((group[0] << 2) | (group[1] >> 4)));
-    } else if (gi == 3) {
-        /* 3 chars → 2 bytes */
-        putchar((int)((group[0] << 2) | (group[1] >> 4)));
-        putchar((int)(((group[1] & 0x0F) << 4) | (group[2] >> 2)));
+__attribute__((target("avx2")))
+static size_t decode_avx2(const unsigned char *in, size_t n,
+                          unsigned char *out, size_t *used)
+{
+    const __m256i lut_lo   = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                              0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                              0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                              0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi   = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                              0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack     = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask_2f  = _mm256_set1_epi8(0x2F);
+    size_t i = 0, o = 0;
+    for (; i + 32 <= n; i += 32, o += 24) {
+        __m256i v  = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i hn = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_2f);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(v, mask_2f));
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hn);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(v, mask_2f), hn));
+        v = _mm256_add_epi8(v, roll);
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, pack);
+        /* 12 bytes at the bottom of each lane; close the gap */
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256((__m256i *)(out + o), v);
     }
+    size_t rest;
+    _mm256_zeroupper();   /* the SSSE3 tail is legacy-encoded */
+    o += decode_ssse3(in + i, n - i, out + o, &rest);
+    *used = i + rest;
+    return o;
+}
+#endif
 
-    (void)seen_pad;
-    return 0;
+static BaseCodec codec = {
+    "base64", 6, 3, 4, b64_decode, encode_scalar, decode_scalar
+};
+
+static void select_kernels(void)
+{
+#ifdef B64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        codec.encode = encode_avx2;
+        codec.decode = decode_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        codec.encode = encode_ssse3;
+        codec.decode = decode_ssse3;
+    }
+#endif
 }
 
 /* ------------------------------------------------------------------ */
@@ -295,21 +420,20 @@ int main(int argc, char *argv[])
         }
     }
 
-    /* Switch stdin to binary mode on Windows to avoid CRLF translation */
+    /* Binary on both ends: decoded output is raw bytes */
 #ifdef _WIN32
-    if (fin == stdin) {
-        _setmode(_fileno(stdin), 0x8000 /*_O_BINARY*/);
-    }
-    if (!decode) {
-        _setmode(_fileno(stdout), 0x8000 /*_O_BINARY*/);
-    }
+    if (fin == stdin)
+        _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
 #endif
 
+    select_kernels();
+
     int ret;
     if (decode)
-        ret = do_decode(fin, ignore_garbage);
+        ret = basenc_decode(fin, stdout, &codec, ignore_garbage);
     else
-        ret = do_encode(fin, wrap);
+        ret = basenc_encode(fin, stdout, &codec, wrap);
 
     if (close_fin) fclose(fin);
     return ret;
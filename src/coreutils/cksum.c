@@ -1,11 +1,22 @@
 /*
- * cksum — compute and print CRC-32 checksum and byte count
+ * cksum — compute and print a checksum and byte count
  *
- * Usage: cksum [FILE ...]
+ * Usage: cksum [-a ALGORITHM] [OPTION]... [FILE ...]
  *   With no FILE or FILE is -, reads stdin.
- *   Output: CRC32  BYTECOUNT  FILENAME
+ *   Default output: CRC  BYTECOUNT  FILENAME
  *
- * Uses the standard POSIX CRC-32 polynomial (IEEE 802.3).
+ *   -a, --algorithm=NAME
+ *       crc      POSIX CRC-32, MSB first, length appended (default)
+ *       crc32b   ISO-HDLC CRC-32 as used by gzip, zlib and PNG
+ *       sysv     sum -s: 16-bit byte sum, size in 512-byte blocks
+ *       bsd      sum -r: 16-bit rotating sum, size in 1 KB blocks
+ *       md5, sha1, sha224, sha256, sha384, sha512, blake2b
+ *                digest as "TAG (FILE) = HEX"; these also take the
+ *                md5sum-style options (-c, -l, --untagged, --parallel ...)
+ *   GNU's sm3 is not provided: the digest library has no SM3.
+ *
+ * The CRCs run on slice-by-16 tables or PCLMULQDQ folding (src/common/crc.c);
+ * the digests are handed to the shared checksum driver (src/common/sumtool.c).
  * --version / --help
  * Exit: 0 = success, 1 = error
  */
@@ -14,106 +25,207 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+#include "crc.h"
+#include "sumtool.h"
 
 #define VERSION "1.0"
-#define BUFSZ   65536
-
-/* ── CRC-32 table (IEEE 802.3 polynomial 0xEDB88320) ──────── */
-
-static uint32_t crc_table[256];
-static int      crc_init_done = 0;
-
-static void crc_init(void) {
-    for (uint32_t i = 0; i < 256; i++) {
-        uint32_t c = i;
-        for (int j = 0; j < 8; j++)
-            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
-        crc_table[i] = c;
-    }
-    crc_init_done = 1;
+#define BUFSZ   (1024 * 1024)
+
+typedef enum { ALG_CRC, ALG_CRC32B, ALG_SYSV, ALG_BSD, ALG_DIGEST } AlgKind;
+
+static const struct {
+    const char *name;
+    AlgKind     kind;
+    DigestAlgo  digest;
+} algos[] = {
+    { "crc",     ALG_CRC,    DIGEST_MD5 },
+    { "crc32b",  ALG_CRC32B, DIGEST_MD5 },
+    { "sysv",    ALG_SYSV,   DIGEST_MD5 },
+    { "bsd",     ALG_BSD,    DIGEST_MD5 },
+    { "md5",     ALG_DIGEST, DIGEST_MD5 },
+    { "sha1",    ALG_DIGEST, DIGEST_SHA1 },
+    { "sha224",  ALG_DIGEST, DIGEST_SHA224 },
+    { "sha256",  ALG_DIGEST, DIGEST_SHA256 },
+    { "sha384",  ALG_DIGEST, DIGEST_SHA384 },
+    { "sha512",  ALG_DIGEST, DIGEST_SHA512 },
+    { "blake2b", ALG_DIGEST, DIGEST_BLAKE2B },
+};
+#define NALGOS (sizeof(algos) / sizeof(algos[0]))
+
+static void usage(void) {
+    printf(
+        "usage: cksum [-a ALGORITHM] [OPTION]... [FILE ...]\n\n"
+        "Print a checksum and byte count of each FILE.\n"
+        "With no FILE or FILE is -, reads stdin.\n\n"
+        "  -a, --algorithm=NAME  crc (default), crc32b, sysv, bsd, md5, sha1,\n"
+        "                        sha224, sha256, sha384, sha512 or blake2b\n"
+        "                        (GNU's sm3 is not supported)\n\n"
+        "crc and crc32b print:   CRC  BYTES  FILENAME\n"
+        "sysv prints:            SUM  512-BYTE-BLOCKS  FILENAME\n"
+        "bsd prints:             SUM  1K-BLOCKS  FILENAME  (as sum -r)\n"
+        "The digests print:      TAG (FILENAME) = HEX\n"
+        "and also accept -c, -l (blake2b), --untagged, --quiet, --status and\n"
+        "--parallel[=N] as in md5sum.\n\n"
+        "      --version\n"
+        "      --help\n");
 }
 
-static uint32_t crc32_update(uint32_t crc, const unsigned char *buf, size_t n) {
-    for (size_t i = 0; i < n; i++)
-        crc = crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
-    return crc;
+static int find_algo(const char *name) {
+    for (size_t i = 0; i < NALGOS; i++)
+        if (!strcmp(algos[i].name, name)) return (int)i;
+    fprintf(stderr, "cksum: invalid argument '%s' for '--algorithm'\n", name);
+    fprintf(stderr, "Valid arguments are:");
+    for (size_t i = 0; i < NALGOS; i++) fprintf(stderr, " '%s'", algos[i].name);
+    fprintf(stderr, "\n");
+    return -1;
 }
 
-/*
- * POSIX cksum appends the byte count to the data before finalizing,
- * encoded as a sequence of bytes (length in binary, LSB first run
- * through the CRC).  This matches GNU coreutils behaviour.
- */
-static uint32_t finalize_crc(uint32_t crc, unsigned long long len) {
-    unsigned long long l = len;
-    while (l != 0) {
-        unsigned char c = (unsigned char)(l & 0xFF);
-        crc = crc_table[(crc ^ c) & 0xFF] ^ (crc >> 8);
-        l >>= 8;
+/* BSD sum: rotate the 16-bit checksum right one bit, then add the byte */
+static uint32_t bsd_update(uint32_t sum, const unsigned char *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        sum = (sum >> 1) + ((sum & 1) << 15) + p[i];
+        sum &= 0xffff;
     }
-    return ~crc;
+    return sum;
 }
 
-static int do_cksum(FILE *fp, const char *name) {
-    unsigned char *buf = (unsigned char *)malloc(BUFSZ);
-    if (!buf) { fprintf(stderr, "cksum: out of memory\n"); return 1; }
+/* System V sum: a plain 32-bit byte sum, folded to 16 bits at the end */
+static uint32_t sysv_update(uint32_t sum, const unsigned char *p, size_t n) {
+    for (size_t i = 0; i < n; i++) sum += p[i];
+    return sum;
+}
 
-    uint32_t crc = 0xFFFFFFFFu;
+static int do_cksum(FILE *fp, const char *name, AlgKind kind, unsigned char *buf) {
+    uint32_t crc = 0;
     unsigned long long total = 0;
     size_t n;
 
     while ((n = fread(buf, 1, BUFSZ, fp)) > 0) {
-        crc = crc32_update(crc, buf, n);
+        switch (kind) {
+            case ALG_CRC:  crc = crc_posix_update(crc, buf, n); break;
+            case ALG_SYSV: crc = sysv_update(crc, buf, n); break;
+            case ALG_BSD:  crc = bsd_update(crc, buf, n); break;
+            default:       crc = crc32b_update(crc, buf, n); break;
+        }
         total += n;
     }
-    free(buf);
-
     if (ferror(fp)) {
-        fprintf(stderr, "cksum: read error: %s\n", name);
+        fprintf(stderr, "cksum: %s: read error\n", name ? name : "-");
         return 1;
     }
 
-    crc = finalize_crc(crc, total);
-
-    if (name)
-        printf("%u %llu %s\n", crc, total, name);
-    else
-        printf("%u %llu\n", crc, total);
+    /* sysv and bsd give the size in blocks, rounded up, as sum does */
+    if (kind == ALG_SYSV) {
+        uint32_t r = (crc & 0xffff) + (crc >> 16);
+        printf("%u %llu", (r & 0xffff) + (r >> 16), (total + 511) / 512);
+    } else if (kind == ALG_BSD) {
+        printf("%05u %5llu", crc, (total + 1023) / 1024);
+    } else {
+        if (kind == ALG_CRC) crc = crc_posix_final(crc, total);
+        printf("%u %llu", crc, total);
+    }
+    if (name) printf(" %s", name);
+    putchar('\n');
     return 0;
 }
 
-int main(int argc, char *argv[]) {
-    if (!crc_init_done) crc_init();
-
-    for (int i = 1; i < argc; i++) {
-        if (!strcmp(argv[i], "--version")) { printf("cksum %s (Winix)\n", VERSION); return 0; }
-        if (!strcmp(argv[i], "--help")) {
-            fprintf(stderr,
-                "usage: cksum [FILE ...]\n\n"
-                "Print CRC-32 checksum and byte count of each FILE.\n"
-                "With no FILE or FILE is -, reads stdin.\n\n"
-                "Output format:  CRC32  BYTES  FILENAME\n"
-                "      --version\n"
-                "      --help\n");
-            return 0;
-        }
+/* The CRCs and sums take no options but --untagged, a no-op as in GNU */
+static int crc_main(int argc, char **argv, AlgKind kind, const char *alg) {
+    int argi = 1;
+    for (; argi < argc; argi++) {
+        const char *a = argv[argi];
+        if (!strcmp(a, "--")) { argi++; break; }
+        if (a[0] != '-' || a[1] == '\0') break;
+        if (!strcmp(a, "--untagged")) continue;
+        if (!strcmp(a, "-c") || !strcmp(a, "--check"))
+            fprintf(stderr, "cksum: --check is not supported with --algorithm=%s\n", alg);
+        else if (a[1] == '-')
+            fprintf(stderr, "cksum: unrecognized option '%s'\n", a);
+        else
+            fprintf(stderr, "cksum: invalid option -- '%c'\n", a[1]);
+        return 1;
     }
 
-    int ret = 0;
+    unsigned char *buf = (unsigned char *)malloc(BUFSZ);
+    if (!buf) { fprintf(stderr, "cksum: out of memory\n"); return 1; }
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
 
-    if (argc < 2) {
-        ret = do_cksum(stdin, NULL);
+    int ret = 0;
+    if (argi >= argc) {
+        ret = do_cksum(stdin, NULL, kind, buf);
     } else {
-        for (int i = 1; i < argc; i++) {
+        for (int i = argi; i < argc; i++) {
             if (!strcmp(argv[i], "-")) {
-                ret |= do_cksum(stdin, NULL);
+                ret |= do_cksum(stdin, NULL, kind, buf);
                 continue;
             }
             FILE *fp = fopen(argv[i], "rb");
-            if (!fp) { perror(argv[i]); ret = 1; continue; }
-            ret |= do_cksum(fp, argv[i]);
+            if (!fp) {
+                fprintf(stderr, "cksum: %s: %s\n", argv[i], strerror(errno));
+                ret = 1;
+                continue;
+            }
+            ret |= do_cksum(fp, argv[i], kind, buf);
             fclose(fp);
         }
     }
+    free(buf);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    /* Take -a out of the argument list; the rest goes to the CRC loop or,
+       for a digest, to the shared checksum driver. */
+    char **rest = (char **)malloc(((size_t)argc + 1) * sizeof(char *));
+    if (!rest) { fprintf(stderr, "cksum: out of memory\n"); return 1; }
+    int nrest = 0, alg = 0;
+    bool opts = true;
+    rest[nrest++] = argv[0];
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *val = NULL;
+        if (opts && !strcmp(a, "--")) {
+            opts = false;
+        } else if (opts && !strcmp(a, "--version")) {
+            printf("cksum %s (Winix)\n", VERSION);
+            free(rest);
+            return 0;
+        } else if (opts && !strcmp(a, "--help")) {
+            usage();
+            free(rest);
+            return 0;
+        } else if (opts && (!strcmp(a, "-a") || !strcmp(a, "--algorithm"))) {
+            if (++i >= argc) {
+                fprintf(stderr, "cksum: option '%s' requires an argument\n", a);
+                free(rest);
+                return 1;
+            }
+            val = argv[i];
+        } else if (opts && !strncmp(a, "--algorithm=", 12)) {
+            val = a + 12;
+        } else if (opts && !strncmp(a, "-a", 2)) {
+            val = a + 2;
+        }
+        if (val) {
+            if ((alg = find_algo(val)) < 0) { free(rest); return 1; }
+            continue;
+        }
+        rest[nrest++] = argv[i];
+    }
+    rest[nrest] = NULL;
+
+    int ret = algos[alg].kind == ALG_DIGEST
+            ? sumtool_cksum(nrest, rest, algos[alg].digest)
+            : crc_main(nrest, rest, algos[alg].kind, algos[alg].name);
+    free(rest);
     return ret;
 }
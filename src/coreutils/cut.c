@@ -14,6 +14,10 @@
  *   N-     position N through end of line
  *   -M     position 1 through M
  *
+ * Input is read in 1 MB blocks and cut in place: LIST is compiled into
+ * sorted, merged intervals, delimiters and newlines are found with one
+ * SSE2 scan, and selected fields are written as slices of the block.
+ *
  * Compile: C99, no dependencies beyond the C standard library.
  */
 
@@ -22,6 +26,17 @@
 #include <string.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define CUT_SSE2 1
+#endif
 
 /* ------------------------------------------------------------------ */
 /* Range list                                                           */
@@ -29,29 +44,22 @@
 
 #define MAX_RANGES 64
 #define BUF_SIZE   8192
+#define BLOCK_SIZE (1 << 20)
+#define TO_END     INT_MAX
 
 typedef struct {
     int lo;  /* 1-based start; always >= 1 */
-    int hi;  /* 1-based end;   0 means "to end of line" */
+    int hi;  /* 1-based end;   0 means "to end of line" (TO_END once compiled) */
 } Range;
 
 static Range ranges[MAX_RANGES];
 static int   nranges = 0;
+static int   max_pos = 0;   /* highest selected position; TO_END if open-ended */
 
-/* Returns true if 1-based position pos falls inside any range. */
-static bool selected(int pos)
-{
-    for (int i = 0; i < nranges; i++) {
-        int lo = ranges[i].lo;
-        int hi = ranges[i].hi;
-        if (hi == 0) {
-            if (pos >= lo) return true;
-        } else {
-            if (pos >= lo && pos <= hi) return true;
-        }
-    }
-    return false;
-}
+static bool        complement = false;  /* --complement: select what LIST does not */
+static char        line_end   = '\n';   /* '\0' with -z */
+static const char *out_delim  = NULL;   /* --output-delimiter, or NULL for default */
+static size_t      out_delim_len = 0;
 
 /*
  * Parse a LIST string like "1,3-5,7-,2-4" into the global ranges[].
@@ -121,116 +129,246 @@ static bool parse_list(const char *list)
     return true;
 }
 
+static int cmp_range(const void *a, const void *b)
+{
+    const Range *x = a, *y = b;
+    return (x->lo > y->lo) - (x->lo < y->lo);
+}
+
+/*
+ * Sort and merge ranges[] into disjoint ascending intervals, then invert
+ * them for --complement. Positions are visited in increasing order within
+ * a line, so a cursor into this list answers "is this position selected?"
+ * in O(1) amortised. Only overlapping ranges merge: "1-2,3-4" stays two
+ * intervals so --output-delimiter separates them, as in GNU cut.
+ */
+static void compile_ranges(void)
+{
+    for (int i = 0; i < nranges; i++)
+        if (ranges[i].hi == 0) ranges[i].hi = TO_END;
+    qsort(ranges, (size_t)nranges, sizeof(Range), cmp_range);
+
+    int n = 0;
+    for (int i = 0; i < nranges; i++) {
+        Range *last = n > 0 ? &ranges[n - 1] : NULL;
+        if (last && ranges[i].lo <= last->hi) {
+            if (ranges[i].hi > last->hi) last->hi = ranges[i].hi;
+        } else {
+            ranges[n++] = ranges[i];
+        }
+    }
+    nranges = n;
+
+    if (complement) {
+        Range inv[MAX_RANGES + 1];
+        int m = 0;
+        int next = 1;
+        for (int i = 0; i < nranges; i++) {
+            if (ranges[i].lo > next) {
+                inv[m].lo = next;
+                inv[m].hi = ranges[i].lo - 1;
+                m++;
+            }
+            next = ranges[i].hi == TO_END ? TO_END : ranges[i].hi + 1;
+        }
+        if (next != TO_END) {
+            inv[m].lo = next;
+            inv[m].hi = TO_END;
+            m++;
+        }
+        memcpy(ranges, inv, (size_t)m * sizeof(Range));
+        nranges = m;
+    }
+    max_pos = nranges > 0 ? ranges[nranges - 1].hi : 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Output buffer                                                        */
+/* ------------------------------------------------------------------ */
+
+/* Selected slices are copied straight from the input block into one large
+ * output buffer, avoiding a stdio call (and its lock) per field. */
+static char   out_buf[1 << 16];
+static size_t out_len = 0;
+
+static void out_flush(void)
+{
+    if (out_len) fwrite(out_buf, 1, out_len, stdout);
+    out_len = 0;
+}
+
+static void out_write(const char *p, size_t n)
+{
+    if (out_len + n > sizeof(out_buf)) {
+        out_flush();
+        if (n > sizeof(out_buf)) { fwrite(p, 1, n, stdout); return; }
+    }
+    memcpy(out_buf + out_len, p, n);
+    out_len += n;
+}
+
+static void out_byte(char c)
+{
+    if (out_len == sizeof(out_buf)) out_flush();
+    out_buf[out_len++] = c;
+}
+
+/* ------------------------------------------------------------------ */
+/* Delimiter scanning                                                   */
+/* ------------------------------------------------------------------ */
+
+/* First byte in [p, end) equal to a or b, or end. SSE2 tests 16 bytes per
+ * step; that covers the typical CSV field without a scalar loop. */
+static const char *find2(const char *p, const char *end, char a, char b)
+{
+#ifdef CUT_SSE2
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (m) return p + __builtin_ctz((unsigned)m);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != a && *p != b) p++;
+    return p;
+}
+
 /* ------------------------------------------------------------------ */
 /* Line processing                                                      */
 /* ------------------------------------------------------------------ */
 
-/* Strip trailing \r and \n in-place; return new length. */
-static int strip_crlf(char *line)
+typedef enum { MODE_CHAR, MODE_FIELD } CutMode;
+
+/* Content end of a line ending at eol: a CRLF line drops its '\r'
+ * (newline-terminated input only; -z records are taken verbatim). */
+static const char *trim_cr(const char *ls, const char *eol)
 {
-    int len = (int)strlen(line);
-    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
-        line[--len] = '\0';
-    return len;
+    return (line_end == '\n' && eol > ls && eol[-1] == '\r') ? eol - 1 : eol;
 }
 
 /*
- * Process one line in character/byte mode (-c / -b).
- * Outputs only selected 1-based character positions, then '\n'.
+ * Character/byte mode (-c / -b) over whole lines in [p, end).
+ * Each interval is one slice of the input, so cost is per range, not per
+ * byte. An explicit --output-delimiter goes between intervals.
  */
-static void process_char_line(const char *line, int len)
+static void process_char_block(const char *p, const char *end)
 {
-    for (int i = 0; i < len; i++) {
-        if (selected(i + 1))   /* positions are 1-based */
-            putchar(line[i]);
+    while (p < end) {
+        const char *eol = memchr(p, line_end, (size_t)(end - p));
+        if (!eol) eol = end;
+        const char *le = trim_cr(p, eol);
+        long len = (long)(le - p);
+        for (int r = 0; r < nranges && ranges[r].lo <= len; r++) {
+            long hi = ranges[r].hi < len ? ranges[r].hi : len;
+            if (r > 0) out_write(out_delim, out_delim_len);
+            out_write(p + ranges[r].lo - 1, (size_t)(hi - ranges[r].lo + 1));
+        }
+        out_byte(line_end);
+        p = eol + 1;
     }
-    putchar('\n');
 }
 
 /*
- * Process one line in field mode (-f).
- * Splits on delim, outputs selected fields rejoined with delim.
- * If the line contains no delimiter:
- *   - if suppress is true: skip the line entirely
- *   - otherwise: output the whole line unchanged
+ * Field mode (-f) over whole lines in [p, end).
+ * One combined scan finds both delimiters and line ends. Once the highest
+ * selected field has been written the rest of the line is skipped with
+ * memchr. Lines with no delimiter are printed whole unless suppress is set.
  */
-static void process_field_line(const char *line, int len,
-                                char delim, bool suppress)
+static void process_field_block(const char *p, const char *end, char delim, bool suppress)
 {
-    /* Check whether the delimiter is present. */
-    bool has_delim = false;
-    for (int i = 0; i < len; i++) {
-        if (line[i] == delim) { has_delim = true; break; }
-    }
-
-    if (!has_delim) {
-        if (!suppress) {
-            /* Output whole line unchanged. */
-            fputs(line, stdout);
-            putchar('\n');
-        }
-        return;
-    }
+    while (p < end) {
+        const char *ls = p;
+        int  field = 1;
+        int  r = 0;
+        bool first_output = true;
+
+        for (;;) {
+            const char *q = find2(p, end, delim, line_end);
+            bool at_eol = (q == end || *q == line_end);
+            const char *fe = at_eol ? trim_cr(p, q) : q;
+
+            if (at_eol && field == 1) {
+                /* No delimiter on this line. */
+                if (!suppress) {
+                    out_write(ls, (size_t)(fe - ls));
+                    out_byte(line_end);
+                }
+                p = q + 1;
+                break;
+            }
 
-    /*
-     * Walk the line, tracking which field (1-based) we are in.
-     * Collect pointers and lengths for each field, then output selected ones.
-     *
-     * We use a simple two-pass approach: first identify all fields,
-     * then output the selected ones separated by delim.
-     */
-
-    /* First pass: count fields and locate them. */
-#define MAX_FIELDS 4096
-    const char *fstart[MAX_FIELDS];
-    int         flen[MAX_FIELDS];
-    int         nfields = 0;
-
-    const char *p   = line;
-    const char *end = line + len;
-
-    while (p <= end && nfields < MAX_FIELDS) {
-        const char *start = p;
-        while (p < end && *p != delim)
-            p++;
-        fstart[nfields] = start;
-        flen[nfields]   = (int)(p - start);
-        nfields++;
-        if (p < end)
-            p++; /* skip the delimiter */
-        else
-            break;
-    }
+            while (r < nranges && ranges[r].hi < field) r++;
+            if (r < nranges && field >= ranges[r].lo) {
+                if (!first_output) out_write(out_delim, out_delim_len);
+                out_write(p, (size_t)(fe - p));
+                first_output = false;
+            }
 
-    /* Second pass: output selected fields. */
-    bool first_output = true;
-    for (int fi = 0; fi < nfields; fi++) {
-        if (selected(fi + 1)) {
-            if (!first_output)
-                putchar(delim);
-            fwrite(fstart[fi], 1, (size_t)flen[fi], stdout);
-            first_output = false;
+            if (at_eol) {
+                out_byte(line_end);
+                p = q + 1;
+                break;
+            }
+            p = q + 1;
+            if (field++ >= max_pos) {
+                const char *eol = memchr(p, line_end, (size_t)(end - p));
+                out_byte(line_end);
+                p = eol ? eol + 1 : end;
+                break;
+            }
         }
     }
-    putchar('\n');
 }
 
 /* ------------------------------------------------------------------ */
 /* Per-stream driver                                                    */
 /* ------------------------------------------------------------------ */
 
-typedef enum { MODE_CHAR, MODE_FIELD } CutMode;
+static char  *blk     = NULL;
+static size_t blk_cap = 0;
 
+/*
+ * Read large blocks and hand every complete line to the line engine in
+ * place. Only the trailing partial line is moved to the front of the
+ * buffer before the next read; a line longer than the buffer grows it.
+ */
 static int process_stream(FILE *f, CutMode mode, char delim, bool suppress)
 {
-    char line[BUF_SIZE];
-    while (fgets(line, sizeof(line), f)) {
-        int len = strip_crlf(line);
+    size_t len = 0;
+    for (;;) {
+        if (len == blk_cap) {
+            size_t cap = blk_cap ? blk_cap * 2 : BLOCK_SIZE;
+            char *nb = realloc(blk, cap);
+            if (!nb) {
+                fprintf(stderr, "cut: out of memory\n");
+                return 1;
+            }
+            blk = nb;
+            blk_cap = cap;
+        }
+        size_t n = fread(blk + len, 1, blk_cap - len, f);
+        len += n;
+        bool eof = (n == 0);
+
+        size_t done = len;
+        if (!eof) {
+            while (done > 0 && blk[done - 1] != line_end) done--;
+            if (done == 0) continue;   /* no complete line yet: read more */
+        }
+
         if (mode == MODE_CHAR)
-            process_char_line(line, len);
+            process_char_block(blk, blk + done);
         else
-            process_field_line(line, len, delim, suppress);
+            process_field_block(blk, blk + done, delim, suppress);
+
+        memmove(blk, blk + done, len - done);
+        len -= done;
+        if (eof) break;
     }
+    out_flush();
+    if (ferror(f)) return 1;
     return ferror(stdout) ? 1 : 0;
 }
 
@@ -248,6 +386,9 @@ static void print_usage(void)
     puts("  -f LIST   select only these fields");
     puts("  -d DELIM  use DELIM as field delimiter (default: TAB)");
     puts("  -s        with -f: suppress lines with no delimiter");
+    puts("  -z        line delimiter is NUL, not newline");
+    puts("  --complement           select everything except LIST");
+    puts("  --output-delimiter=STR use STR between output fields or ranges");
     puts("  --help    display this help and exit");
     puts("  --version output version information and exit");
     puts("");
@@ -265,6 +406,28 @@ static void print_version(void)
     puts("cut 1.0 (Winix 1.0)");
 }
 
+/* Select -b/-c (MODE_CHAR) or -f (MODE_FIELD) with LIST. */
+static bool set_list(CutMode want, const char *list, CutMode *mode, bool *mode_set)
+{
+    if (*mode_set && *mode != want) {
+        fprintf(stderr, "cut: only one of -b, -c, or -f may be specified\n");
+        return false;
+    }
+    *mode = want;
+    *mode_set = true;
+    return parse_list(list);
+}
+
+static bool set_delim(const char *arg, char *delim)
+{
+    if (arg[0] == '\0' || arg[1] != '\0') {
+        fprintf(stderr, "cut: the delimiter must be a single character\n");
+        return false;
+    }
+    *delim = arg[0];
+    return true;
+}
+
 /* ------------------------------------------------------------------ */
 /* main                                                                 */
 /* ------------------------------------------------------------------ */
@@ -299,82 +462,82 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if (strncmp(arg, "--", 2) == 0) {
+            const char *eq  = strchr(arg, '=');
+            size_t      len = eq ? (size_t)(eq - arg) : strlen(arg);
+            const char *val = eq ? eq + 1 : NULL;
+            bool ok = true;
+
+            if      (len == 12 && strncmp(arg, "--complement", len) == 0)      complement = true;
+            else if (len == 17 && strncmp(arg, "--zero-terminated", len) == 0) line_end = '\0';
+            else if (len == 16 && strncmp(arg, "--only-delimited", len) == 0)  suppress = true;
+            else {
+                /* The remaining long options all take a value */
+                if (!val) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "cut: option '%s' requires an argument\n", arg);
+                        return 1;
+                    }
+                    val = argv[++i];
+                }
+                if (len == 18 && strncmp(arg, "--output-delimiter", len) == 0) {
+                    out_delim     = val;
+                    out_delim_len = strlen(val);
+                }
+                else if (len == 11 && strncmp(arg, "--delimiter", len) == 0) {
+                    ok = set_delim(val, &delim);
+                }
+                else if ((len == 7  && strncmp(arg, "--bytes", len) == 0) ||
+                         (len == 12 && strncmp(arg, "--characters", len) == 0)) {
+                    ok = set_list(MODE_CHAR, val, &mode, &mode_set);
+                    list_set = true;
+                }
+                else if (len == 8 && strncmp(arg, "--fields", len) == 0) {
+                    ok = set_list(MODE_FIELD, val, &mode, &mode_set);
+                    list_set = true;
+                }
+                else {
+                    fprintf(stderr, "cut: unrecognized option '%.*s'\n", (int)len, arg);
+                    return 1;
+                }
+            }
+            if (!ok) return 1;
+            i++;
+            continue;
+        }
+
         /* Short options */
         if (arg[0] == '-' && arg[1] != '\0') {
             const char *p = arg + 1;
             while (*p) {
                 char opt = *p;
 
-                if (opt == 'b' || opt == 'c') {
-                    /* -b and -c are identical on this platform */
-                    if (mode_set && mode != MODE_CHAR) {
-                        fprintf(stderr, "cut: only one of -b, -c, or -f may be specified\n");
-                        return 1;
-                    }
-                    mode = MODE_CHAR;
-                    mode_set = true;
-
-                    /* LIST follows immediately after flag char or as next token */
-                    const char *list_arg = p + 1;
-                    if (*list_arg == '\0') {
-                        /* LIST is the next argv token */
+                if (opt == 'b' || opt == 'c' || opt == 'f' || opt == 'd') {
+                    /* The argument follows immediately or is the next token */
+                    const char *val = p + 1;
+                    if (*val == '\0') {
                         i++;
                         if (i >= argc) {
                             fprintf(stderr, "cut: option requires an argument -- '%c'\n", opt);
                             return 1;
                         }
-                        list_arg = argv[i];
+                        val = argv[i];
                     }
-                    if (!parse_list(list_arg)) return 1;
-                    list_set = true;
+                    /* -b and -c are identical on this platform */
+                    bool ok = opt == 'd' ? set_delim(val, &delim)
+                            : set_list(opt == 'f' ? MODE_FIELD : MODE_CHAR, val, &mode, &mode_set);
+                    if (!ok) return 1;
+                    if (opt != 'd') list_set = true;
                     goto next_arg;   /* consumed rest of this argv token */
 
-                } else if (opt == 'f') {
-                    if (mode_set && mode != MODE_FIELD) {
-                        fprintf(stderr, "cut: only one of -b, -c, or -f may be specified\n");
-                        return 1;
-                    }
-                    mode = MODE_FIELD;
-                    mode_set = true;
-
-                    const char *list_arg = p + 1;
-                    if (*list_arg == '\0') {
-                        i++;
-                        if (i >= argc) {
-                            fprintf(stderr, "cut: option requires an argument -- '%c'\n", opt);
-                            return 1;
-                        }
-                        list_arg = argv[i];
-                    }
-                    if (!parse_list(list_arg)) return 1;
-                    list_set = true;
-                    goto next_arg;
-
-                } else if (opt == 'd') {
-                    const char *delim_arg = p + 1;
-                    if (*delim_arg == '\0') {
-                        i++;
-                        if (i >= argc) {
-                            fprintf(stderr, "cut: option requires an argument -- 'd'\n");
-                            return 1;
-                        }
-                        delim_arg = argv[i];
-                    }
-                    if (delim_arg[0] == '\0') {
-                        fprintf(stderr, "cut: the delimiter must be a single character\n");
-                        return 1;
-                    }
-                    if (delim_arg[1] != '\0') {
-                        fprintf(stderr, "cut: the delimiter must be a single character\n");
-                        return 1;
-                    }
-                    delim = delim_arg[0];
-                    goto next_arg;
-
                 } else if (opt == 's') {
                     suppress = true;
                     p++;
 
+                } else if (opt == 'z') {
+                    line_end = '\0';
+                    p++;
+
                 } else {
                     fprintf(stderr, "cut: invalid option -- '%c'\n", opt);
                     return 1;
@@ -407,8 +570,21 @@ next_arg:
         return 1;
     }
 
+    /* Default output delimiter: the input delimiter for -f, nothing for -b/-c */
+    char delim_str[2] = { delim, '\0' };
+    if (!out_delim) {
+        out_delim     = mode == MODE_FIELD ? delim_str : "";
+        out_delim_len = mode == MODE_FIELD ? 1 : 0;
+    }
+
     /* ---- Process input ---- */
     int ret = 0;
+    compile_ranges();
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    /* NUL-terminated records may hold bare newlines; keep them as-is */
+    if (line_end == '\0') _setmode(_fileno(stdout), _O_BINARY);
+#endif
 
     if (first_file < 0) {
         /* No file arguments: read stdin. */
@@ -420,7 +596,7 @@ next_arg:
             if (strcmp(path, "-") == 0) {
                 f = stdin;
             } else {
-                f = fopen(path, "r");
+                f = fopen(path, "rb");
                 if (!f) {
                     fprintf(stderr, "cut: %s: %s\n", path, strerror(errno));
                     ret = 1;
@@ -434,5 +610,6 @@ next_arg:
         }
     }
 
+    free(blk);
     return ret;
 }
@@ -9,9 +9,16 @@
  *   -c          write to stdout, keep original
  *   -f          force overwrite of existing output file
  *   -v          verbose (show filename and ratio)
- *   -l          list compressed file info
- *   -t          test integrity
+ *   -l          list compressed file info (sizes from the gzip trailer)
+ *   -t          test integrity (-tv reports each member of a multi-member file)
  *   -1 .. -9    compression level (default -6)
+ *   -p N, --processes=N
+ *               compress on N threads (see par_deflate below)
+ *   --rsyncable reset the compressor at content-defined points
+ *   --index     write FILE.gzi, an access-point index (see do_index)
+ *   --offset=N, --length=N
+ *               extract part of the uncompressed data to stdout,
+ *               starting at the nearest FILE.gzi access point
  *   --version / --help
  *
  * Exit: 0 = success, 1 = error, 2 = warning
@@ -23,16 +30,32 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include "zlib.h"
+#include "threads.h"
 
 #ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
 #include <io.h>
 #include <fcntl.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef _WIN32
+#define gz_fseek    _fseeki64
+#else
+#define gz_fseek    fseeko
 #endif
 
 #define VERSION     "1.0"
 #define CHUNK       65536
 #define GZ_EXT      ".gz"
 
+#define PAR_BLOCK   (128 * 1024)  /* input bytes per parallel deflate job */
+#define PAR_DICT    32768         /* deflate window carried into each job */
+#define PAR_BATCH   8             /* jobs per thread read in one batch */
+
 /* ── options ─────────────────────────────────────────────── */
 static int opt_decompress = 0;
 static int opt_keep       = 0;
@@ -42,6 +65,11 @@ static int opt_verbose    = 0;
 static int opt_list       = 0;
 static int opt_test       = 0;
 static int opt_level      = Z_DEFAULT_COMPRESSION; /* -6 */
+static int opt_threads    = 1;
+static int opt_rsyncable  = 0;
+static int opt_index      = 0;
+static long long opt_offset = -1;  /* --offset: extract from here */
+static long long opt_length = -1;  /* --length: at most this much */
 
 /* ── helpers ─────────────────────────────────────────────── */
 static int has_gz_suffix(const char *path) {
@@ -49,6 +77,23 @@ static int has_gz_suffix(const char *path) {
     return n > 3 && strcmp(path + n - 3, GZ_EXT) == 0;
 }
 
+/* N with an optional K, M or G (powers of 1024) suffix */
+static int parse_size(const char *arg, long long *v) {
+    char *end;
+    errno = 0;
+    long long n = strtoll(arg, &end, 10);
+    if (end == arg || n < 0 || errno) return -1;
+    switch (*end) {
+        case 'K': case 'k': n <<= 10; end++; break;
+        case 'M': case 'm': n <<= 20; end++; break;
+        case 'G': case 'g': n <<= 30; end++; break;
+        default: break;
+    }
+    if (*end) return -1;
+    *v = n;
+    return 0;
+}
+
 /* Build output path: compress → append .gz, decompress → strip .gz */
 static int build_outpath(const char *in, char *out, size_t outsz) {
     if (opt_decompress) {
@@ -67,6 +112,271 @@ static int build_outpath(const char *in, char *out, size_t outsz) {
     return 0;
 }
 
+/* ── parallel compression ────────────────────────────────── */
+/*
+ * The input is cut into 128 KB blocks that are deflated independently,
+ * each primed with the 32 KB before it as a preset dictionary so matches
+ * can still reach back across the cut. Every block but the last ends in
+ * a Z_SYNC_FLUSH (an empty stored block that byte-aligns the stream and
+ * does not set BFINAL), so the raw outputs concatenate into one deflate
+ * stream. The block CRCs are joined with crc32_combine() and one gzip
+ * header and trailer go around the lot: the result is an ordinary
+ * single-member .gz file.
+ *
+ * Blocks are read PAR_BATCH per thread at a time, compressed by a pool
+ * that takes them in any order, and written in order.
+ *
+ * --rsyncable also goes through here, on one thread unless -p says
+ * otherwise. As in pigz, a block ends at the last place in its 128 KB
+ * where a hash of the last 12 bytes hits a fixed value (every 4 KB on
+ * average for varied data), and the block after such a cut starts
+ * without a dictionary. What follows a cut then compresses the same
+ * whatever came before it, so an edit early in a file only changes the
+ * output until the cuts line up again, and rsync or deduplicating
+ * storage find the rest unchanged. Within a block deflate runs on
+ * undisturbed; a block with no hit is a full 128 KB and keeps its
+ * dictionary.
+ */
+#define RSYNC_MASK   0x0fffu
+#define RSYNC_HIT    (RSYNC_MASK >> 1)
+
+typedef struct {
+    const unsigned char *data;  /* dictlen bytes of history precede this */
+    size_t         len, dictlen;
+    int            last;
+    unsigned char *out;
+    size_t         outlen, outcap;
+    uLong          crc;
+    int            err;
+} ParBlock;
+
+typedef struct {
+    ParBlock     *blk;
+    long          nblk;
+    volatile long next;
+    volatile long slot;
+    z_stream     *strm;         /* one per thread */
+} ParPool;
+
+/* Deflate n bytes onto b->out, growing it if the data expands */
+static int par_segment(z_stream *s, ParBlock *b, const unsigned char *p, size_t n, int flush)
+{
+    s->next_in  = (Bytef *)p;
+    s->avail_in = (uInt)n;
+    for (;;) {
+        if (b->outlen == b->outcap) {
+            unsigned char *o = (unsigned char *)realloc(b->out, b->outcap * 2);
+            if (!o) return -1;
+            b->out = o;
+            b->outcap *= 2;
+        }
+        s->next_out  = b->out + b->outlen;
+        s->avail_out = (uInt)(b->outcap - b->outlen);
+        int r = deflate(s, flush);
+        b->outlen = b->outcap - s->avail_out;
+        if (r == Z_STREAM_ERROR) return -1;
+        /* done once deflate stops short of the end of the buffer */
+        if (s->avail_out != 0) return flush == Z_FINISH && r != Z_STREAM_END ? -1 : 0;
+    }
+}
+
+static void par_worker(void *arg)
+{
+    ParPool *p = (ParPool *)arg;
+    z_stream *s = &p->strm[__sync_fetch_and_add(&p->slot, 1)];
+    for (;;) {
+        long i = __sync_fetch_and_add(&p->next, 1);
+        if (i >= p->nblk) break;
+        ParBlock *b = &p->blk[i];
+
+        b->outlen = 0;
+        b->err = 0;
+        deflateReset(s);
+        if (b->dictlen)
+            deflateSetDictionary(s, b->data - b->dictlen, (uInt)b->dictlen);
+
+        b->err = par_segment(s, b, b->data, b->len, b->last ? Z_FINISH : Z_SYNC_FLUSH) < 0;
+        b->crc = crc32(0L, b->data, (uInt)b->len);
+    }
+}
+
+static void par_run(ParPool *p, int nthreads)
+{
+    p->next = 0;
+    p->slot = 0;
+    run_threads(par_worker, p, nthreads > p->nblk ? (int)p->nblk : nthreads);
+}
+
+static void put_le32(unsigned char *b, uLong v) {
+    b[0] = (unsigned char)v;         b[1] = (unsigned char)(v >> 8);
+    b[2] = (unsigned char)(v >> 16); b[3] = (unsigned char)(v >> 24);
+}
+
+/*
+ * Lay out at most maxblk blocks of data[0, n). Returns the count; *used
+ * is where the last one ends, short of n when --rsyncable leaves a tail
+ * shorter than a block, or cuts left more blocks than fit, for the next
+ * batch. *hash and *at_cut carry the rsync state across.
+ */
+static long par_blocks(ParBlock *blk, long maxblk, const unsigned char *data, size_t n,
+                       size_t have, int eof, unsigned *hash, int *at_cut, size_t *used)
+{
+    long nb = 0;
+    size_t off = 0;
+    while (nb < maxblk && (off < n || (nb == 0 && eof))) {
+        ParBlock *b = &blk[nb];
+        size_t len = n - off < PAR_BLOCK ? n - off : PAR_BLOCK;
+        b->dictlen = off ? PAR_DICT : have;
+        if (opt_rsyncable) {
+            if (len < PAR_BLOCK && !eof) break;     /* wait for more input */
+            if (*at_cut) b->dictlen = 0;
+            unsigned h = *hash;
+            size_t cut = 0;
+            for (size_t k = off; k < off + len; k++) {
+                h = ((h << 1) ^ data[k]) & RSYNC_MASK;
+                if (h == RSYNC_HIT) cut = k + 1;
+            }
+            /* The final block takes the rest; a hit in it cuts nothing */
+            if (cut && !(eof && off + len == n)) {
+                len = cut - off;
+                h = RSYNC_HIT;
+            }
+            *hash = h;
+            *at_cut = cut == off + len;
+        }
+        b->data = data + off;
+        b->len  = len;
+        b->last = 0;
+        off += len;
+        nb++;
+    }
+    if (nb && eof && off == n) blk[nb - 1].last = 1;
+    *used = off;
+    return nb;
+}
+
+/* Compress all of in to out as one gzip member on opt_threads threads */
+static int par_deflate(FILE *in, FILE *out, long long *in_bytes) {
+    int nthreads = opt_threads;
+    long nblk = (long)nthreads * PAR_BATCH;
+    size_t cap = (size_t)nblk * PAR_BLOCK;
+    ParPool pool;
+    memset(&pool, 0, sizeof(pool));
+
+    pool.strm = (z_stream *)calloc((size_t)nthreads, sizeof(z_stream));
+    pool.blk  = (ParBlock *)calloc((size_t)nblk, sizeof(ParBlock));
+    unsigned char *ibuf = (unsigned char *)malloc(PAR_DICT + cap);
+    int inited = 0, ret = 1;
+    if (!pool.strm || !pool.blk || !ibuf) {
+        fprintf(stderr, "gzip: out of memory\n");
+        goto done;
+    }
+    for (; inited < nthreads; inited++) {
+        if (deflateInit2(&pool.strm[inited], opt_level, Z_DEFLATED, -MAX_WBITS,
+                         8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            fprintf(stderr, "gzip: cannot initialize compressor\n");
+            goto done;
+        }
+    }
+    /* room for a stored-block fallback plus the sync marker */
+    size_t outcap = deflateBound(&pool.strm[0], PAR_BLOCK) + 16;
+    for (long i = 0; i < nblk; i++) {
+        pool.blk[i].outcap = outcap;
+        if (!(pool.blk[i].out = (unsigned char *)malloc(outcap))) {
+            fprintf(stderr, "gzip: out of memory\n");
+            goto done;
+        }
+    }
+
+    int level = opt_level == Z_DEFAULT_COMPRESSION ? 6 : opt_level;
+    unsigned char hdr[10] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0,
+                              level == 9 ? 2 : level == 1 ? 4 : 0,
+#ifdef _WIN32
+                              0x0b };   /* NTFS */
+#else
+                              0x03 };   /* Unix */
+#endif
+    if (fwrite(hdr, 1, sizeof(hdr), out) != sizeof(hdr)) goto write_err;
+
+    unsigned char *data = ibuf + PAR_DICT;
+    size_t have = 0;            /* history bytes just below data */
+    size_t carry = 0;           /* --rsyncable tail held over at data[0] */
+    unsigned hash = 0;
+    int at_cut = 1;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    long long total = 0;
+    int eof = 0, finished = 0;
+    while (!finished) {
+        size_t got = carry + (eof ? 0 : fread(data + carry, 1, cap - carry, in));
+        if (ferror(in)) {
+            fprintf(stderr, "gzip: read error: %s\n", strerror(errno));
+            goto done;
+        }
+        if (got < cap) {
+            eof = 1;
+        } else if (!eof) {
+            int c = getc(in);
+            if (c == EOF) eof = 1; else ungetc(c, in);
+        }
+
+        size_t used;
+        long n = par_blocks(pool.blk, nblk, data, got, have, eof, &hash, &at_cut, &used);
+        pool.nblk = n;
+        par_run(&pool, nthreads);
+
+        for (long i = 0; i < n; i++) {
+            ParBlock *b = &pool.blk[i];
+            if (b->err) { fprintf(stderr, "gzip: compression error\n"); goto done; }
+            if (fwrite(b->out, 1, b->outlen, out) != b->outlen) goto write_err;
+            crc = crc32_combine(crc, b->crc, (z_off_t)b->len);
+        }
+        total += (long long)used;
+
+        size_t keep = have + used < PAR_DICT ? have + used : PAR_DICT;
+        carry = got - used;
+        memmove(data - keep, data + used - keep, keep + carry);
+        have = keep;
+        finished = eof && n && pool.blk[n - 1].last;
+    }
+
+    unsigned char trl[8];
+    put_le32(trl, crc);
+    put_le32(trl + 4, (uLong)(total & 0xffffffffLL));
+    if (fwrite(trl, 1, sizeof(trl), out) != sizeof(trl) || fflush(out) != 0)
+        goto write_err;
+    *in_bytes = total;
+    ret = 0;
+    goto done;
+
+write_err:
+    fprintf(stderr, "gzip: write error: %s\n", strerror(errno));
+done:
+    for (int t = 0; t < inited; t++) deflateEnd(&pool.strm[t]);
+    for (long i = 0; pool.blk && i < nblk; i++) free(pool.blk[i].out);
+    free(pool.strm);
+    free(pool.blk);
+    free(ibuf);
+    return ret;
+}
+
+/* ── gzwrite path ────────────────────────────────────────── */
+static int gz_copy(FILE *in, gzFile gz, long long *in_bytes) {
+    unsigned char buf[CHUNK];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (gzwrite(gz, buf, (unsigned)n) != (int)n) {
+            fprintf(stderr, "gzip: write error: %s\n", gzerror(gz, NULL));
+            return 1;
+        }
+        *in_bytes += (long long)n;
+    }
+    if (ferror(in)) {
+        fprintf(stderr, "gzip: read error: %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
 /* ── compress one file ───────────────────────────────────── */
 static int do_compress(const char *inpath) {
     char outpath[4096];
@@ -87,6 +397,32 @@ static int do_compress(const char *inpath) {
     FILE *in = fopen(inpath, "rb");
     if (!in) { fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno)); return 1; }
 
+    long long in_bytes = 0, out_bytes = 0;
+    if (opt_threads > 1 || opt_rsyncable) {
+        FILE *out;
+        if (opt_stdout) {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            out = stdout;
+        } else if (!(out = fopen(dest, "wb"))) {
+            fprintf(stderr, "gzip: %s: %s\n", dest, strerror(errno));
+            fclose(in);
+            return 1;
+        }
+        int err = par_deflate(in, out, &in_bytes);
+        fclose(in);
+        if (out != stdout && fclose(out) != 0 && !err) {
+            fprintf(stderr, "gzip: %s: %s\n", dest, strerror(errno));
+            err = 1;
+        }
+        if (err) {
+            if (!opt_stdout) remove(dest);
+            return 1;
+        }
+        goto finish;
+    }
+
     gzFile gz;
     if (opt_stdout) {
 #ifdef _WIN32
@@ -106,19 +442,18 @@ static int do_compress(const char *inpath) {
         return 1;
     }
 
-    unsigned char buf[CHUNK];
-    size_t n;
-    long long in_bytes = 0, out_bytes = 0;
-    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
-        if (gzwrite(gz, buf, (unsigned)n) != (int)n) {
-            fprintf(stderr, "gzip: write error: %s\n", gzerror(gz, NULL));
-            gzclose(gz); fclose(in); return 1;
-        }
-        in_bytes += (long long)n;
+    int err = gz_copy(in, gz, &in_bytes);
+    if (gzclose(gz) != Z_OK && !err) {
+        fprintf(stderr, "gzip: write error\n");
+        err = 1;
     }
-    gzclose(gz);
     fclose(in);
+    if (err) {
+        if (!opt_stdout) remove(dest);
+        return 1;
+    }
 
+finish:
     if (opt_verbose && !opt_stdout) {
         struct stat st;
         if (stat(dest, &st) == 0) out_bytes = st.st_size;
@@ -132,6 +467,500 @@ static int do_compress(const char *inpath) {
     return 0;
 }
 
+/* ── decompression pipeline (-d, -t, -l) ─────────────────── */
+/*
+ * Inflate is serial, so decompression is split into three stages that
+ * overlap instead: a reader thread fills 1 MB input slots, this thread
+ * parses the gzip framing and inflates into 1 MB output slots, and a
+ * writer thread runs crc32() over each slot, writes it (unless testing)
+ * and checks every member's CRC and length against its trailer.
+ *
+ * The stages hand slots over through single-producer/single-consumer
+ * rings: each side only ever advances its own index and publishes it
+ * with a store both sides order against, so the busy path takes no lock.
+ * A stage with nothing to do yields its CPU PIPE_SPIN times, then sleeps
+ * on the ring's condition variable; the other side only takes the lock
+ * to wake it when it has said it is waiting. If a thread cannot be
+ * started its stage runs inline on the inflate thread.
+ */
+#define PIPE_SLOTS  4
+#define PIPE_SLOT   (1024 * 1024)
+#define PIPE_SPIN   64
+
+#define GZF_HCRC    0x02
+#define GZF_EXTRA   0x04
+#define GZF_NAME    0x08
+#define GZF_COMMENT 0x10
+
+typedef struct {
+    unsigned char *buf;
+    size_t         len;
+    int            end;         /* input: EOF; output: a member ends here */
+    int            last;        /* output: nothing follows */
+    uLong          crc, isize;  /* output: trailer of the member ending here */
+} Slot;
+
+typedef struct {
+    Slot     slot[PIPE_SLOTS];
+    unsigned head;              /* advanced by the producer only */
+    unsigned tail;              /* advanced by the consumer only */
+    int      waiters;           /* threads asleep, or about to be, on cv */
+#ifdef _WIN32
+    CRITICAL_SECTION   mu;
+    CONDITION_VARIABLE cv;
+#else
+    pthread_mutex_t    mu;
+    pthread_cond_t     cv;
+#endif
+} Ring;
+
+typedef struct {
+    FILE         *in, *out;     /* out is NULL for -t and -l */
+    const char   *name;
+    int           report;       /* -tv: a line per member */
+    Ring          rin, rout;
+    volatile int  stop;         /* set on a write/verify error, or when
+                                   the inflate stage needs no more input */
+    int           rd_err, wr_err;
+    /* writer state */
+    uLong         crc, crc1;
+    long long     size, size1, total;
+    int           member;
+} Pipe;
+
+static void pipe_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static void ring_init(Ring *r) {
+#ifdef _WIN32
+    InitializeCriticalSection(&r->mu);
+    InitializeConditionVariable(&r->cv);
+#else
+    pthread_mutex_init(&r->mu, NULL);
+    pthread_cond_init(&r->cv, NULL);
+#endif
+}
+
+static void ring_free(Ring *r) {
+#ifdef _WIN32
+    DeleteCriticalSection(&r->mu);
+#else
+    pthread_mutex_destroy(&r->mu);
+    pthread_cond_destroy(&r->cv);
+#endif
+}
+
+/* Wake a thread asleep on r. The index or stop flag it waits for has
+   already been stored; since waiters is raised before the waiter looks
+   at them again, one of the two sides always sees the other. */
+static void ring_wake(Ring *r) {
+    if (!__atomic_load_n(&r->waiters, __ATOMIC_SEQ_CST)) return;
+#ifdef _WIN32
+    EnterCriticalSection(&r->mu);
+    WakeAllConditionVariable(&r->cv);
+    LeaveCriticalSection(&r->mu);
+#else
+    pthread_mutex_lock(&r->mu);
+    pthread_cond_broadcast(&r->cv);
+    pthread_mutex_unlock(&r->mu);
+#endif
+}
+
+/* Wait until ready(r) or *stop: spin on yields first, then sleep */
+static void ring_wait(Ring *r, int (*ready)(Ring *), volatile int *stop) {
+    for (int spin = 0; spin < PIPE_SPIN; spin++) {
+        if (ready(r) || (stop && *stop)) return;
+        pipe_yield();
+    }
+#ifdef _WIN32
+    EnterCriticalSection(&r->mu);
+#else
+    pthread_mutex_lock(&r->mu);
+#endif
+    __atomic_add_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+    while (!ready(r) && !(stop && __atomic_load_n(stop, __ATOMIC_SEQ_CST))) {
+#ifdef _WIN32
+        SleepConditionVariableCS(&r->cv, &r->mu, INFINITE);
+#else
+        pthread_cond_wait(&r->cv, &r->mu);
+#endif
+    }
+    __atomic_sub_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+#ifdef _WIN32
+    LeaveCriticalSection(&r->mu);
+#else
+    pthread_mutex_unlock(&r->mu);
+#endif
+}
+
+static int ring_has_room(Ring *r) {
+    return r->head - __atomic_load_n(&r->tail, __ATOMIC_SEQ_CST) != PIPE_SLOTS;
+}
+
+static int ring_has_data(Ring *r) {
+    return __atomic_load_n(&r->head, __ATOMIC_SEQ_CST) != r->tail;
+}
+
+/* Next free slot to fill, or NULL once the pipeline is stopping */
+static Slot *ring_put_wait(Ring *r, volatile int *stop) {
+    if (!ring_has_room(r)) {
+        ring_wait(r, ring_has_room, stop);
+        if (!ring_has_room(r)) return NULL;
+    }
+    return &r->slot[r->head % PIPE_SLOTS];
+}
+
+static void ring_put(Ring *r) {
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_SEQ_CST);
+    ring_wake(r);
+}
+
+/* Next filled slot; a slot already published is returned even when
+   stopping, so whatever was sent before the stop still arrives */
+static Slot *ring_get_wait(Ring *r, volatile int *stop) {
+    if (!ring_has_data(r)) {
+        ring_wait(r, ring_has_data, stop);
+        if (!ring_has_data(r)) return NULL;
+    }
+    return &r->slot[r->tail % PIPE_SLOTS];
+}
+
+static void ring_get(Ring *r) {
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_SEQ_CST);
+    ring_wake(r);
+}
+
+/* Stop the pipeline and wake every stage that is waiting for it */
+static void pipe_stop(Pipe *p) {
+    __atomic_store_n(&p->stop, 1, __ATOMIC_SEQ_CST);
+    ring_wake(&p->rin);
+    ring_wake(&p->rout);
+}
+
+/* ── reader stage ── */
+static void read_stage(Pipe *p) {
+    for (;;) {
+        Slot *s = ring_put_wait(&p->rin, &p->stop);
+        if (!s) return;
+        s->len = fread(s->buf, 1, PIPE_SLOT, p->in);
+        s->end = s->len < PIPE_SLOT;
+        if (s->end && ferror(p->in)) {
+            fprintf(stderr, "gzip: %s: read error: %s\n", p->name, strerror(errno));
+            p->rd_err = 1;
+        }
+        int end = s->end;
+        ring_put(&p->rin);
+        if (end) return;
+    }
+}
+
+/* ── writer stage: one slot; -1 on error, 1 after the last ── */
+static int write_slot(Pipe *p, const Slot *s) {
+    p->crc = crc32(p->crc, s->buf, (uInt)s->len);
+    p->size += (long long)s->len;
+    if (p->out && s->len && fwrite(s->buf, 1, s->len, p->out) != s->len) {
+        fprintf(stderr, "gzip: write error: %s\n", strerror(errno));
+        return -1;
+    }
+    if (s->end) {
+        if (s->crc != p->crc) {
+            fprintf(stderr, "gzip: %s: invalid compressed data--crc error\n", p->name);
+            return -1;
+        }
+        if (s->isize != (uLong)(p->size & 0xffffffffLL)) {
+            fprintf(stderr, "gzip: %s: invalid compressed data--length error\n", p->name);
+            return -1;
+        }
+        /* Member 1 is only reported once a second one turns up */
+        if (p->report && ++p->member > 1) {
+            if (p->member == 2)
+                fprintf(stderr, "%s:\tmember 1: %lld bytes, crc %08lx OK\n",
+                        p->name, p->size1, (unsigned long)p->crc1);
+            fprintf(stderr, "%s:\tmember %d: %lld bytes, crc %08lx OK\n",
+                    p->name, p->member, p->size, (unsigned long)p->crc);
+        }
+        p->size1 = p->size;
+        p->crc1  = p->crc;
+        p->total += p->size;
+        p->size = 0;
+        p->crc  = crc32(0L, Z_NULL, 0);
+    }
+    if (s->last) {
+        if (p->out && fflush(p->out) != 0) {
+            fprintf(stderr, "gzip: write error: %s\n", strerror(errno));
+            return -1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static void write_stage(Pipe *p) {
+    for (;;) {
+        Slot *s = ring_get_wait(&p->rout, NULL);
+        int r = write_slot(p, s);
+        ring_get(&p->rout);
+        if (r < 0) { p->wr_err = 1; pipe_stop(p); }
+        if (r != 0) return;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI read_entry(LPVOID arg)  { read_stage((Pipe *)arg);  return 0; }
+static DWORD WINAPI write_entry(LPVOID arg) { write_stage((Pipe *)arg); return 0; }
+#else
+static void *read_entry(void *arg)  { read_stage((Pipe *)arg);  return NULL; }
+static void *write_entry(void *arg) { write_stage((Pipe *)arg); return NULL; }
+#endif
+
+/* ── inflate stage: input as a byte stream over the slots ── */
+typedef struct {
+    FILE          *f;           /* read directly when there is no ring */
+    Ring          *ring;
+    volatile int  *stop;
+    int            held, eof;
+    unsigned char *buf;
+    size_t         cap, pos, len;
+    long long      used;        /* bytes consumed before buf[0] */
+} GzIn;
+
+static int gzin_fill(GzIn *g) {
+    g->used += (long long)g->len;
+    g->pos = 0;
+    g->len = 0;
+    if (!g->ring) {
+        g->len = fread(g->buf, 1, g->cap, g->f);
+        return g->len > 0;
+    }
+    if (g->held) { ring_get(g->ring); g->held = 0; }
+    if (g->eof) return 0;
+    Slot *s = ring_get_wait(g->ring, g->stop);
+    if (!s) return 0;
+    g->held = 1;
+    g->buf  = s->buf;
+    g->len  = s->len;
+    g->eof  = s->end;
+    return g->len > 0;
+}
+
+static int gzin_byte(GzIn *g) {
+    if (g->pos == g->len && !gzin_fill(g)) return -1;
+    return g->buf[g->pos++];
+}
+
+static int gzin_peek(GzIn *g) {
+    if (g->pos == g->len && !gzin_fill(g)) return -1;
+    return g->buf[g->pos];
+}
+
+static int gzin_skip(GzIn *g, size_t n) {
+    while (n--) if (gzin_byte(g) < 0) return -1;
+    return 0;
+}
+
+static int gzin_skipz(GzIn *g) {
+    int c;
+    while ((c = gzin_byte(g)) > 0) ;
+    return c;
+}
+
+static long long gzin_tell(const GzIn *g) { return g->used + (long long)g->pos; }
+
+/* Parse one member header; 1 = ok, 0 = not a gzip header, -1 = cut short */
+static int read_header(GzIn *g) {
+    int id1 = gzin_byte(g), id2 = gzin_byte(g), cm = gzin_byte(g), flg = gzin_byte(g);
+    if (flg < 0) return -1;
+    if (id1 != 0x1f || id2 != 0x8b || cm != Z_DEFLATED || (flg & 0xe0)) return 0;
+    if (gzin_skip(g, 6) < 0) return -1;                 /* MTIME, XFL, OS */
+    if (flg & GZF_EXTRA) {
+        int lo = gzin_byte(g), hi = gzin_byte(g);
+        if (hi < 0 || gzin_skip(g, (size_t)(lo | hi << 8)) < 0) return -1;
+    }
+    if ((flg & GZF_NAME)    && gzin_skipz(g) < 0) return -1;
+    if ((flg & GZF_COMMENT) && gzin_skipz(g) < 0) return -1;
+    if ((flg & GZF_HCRC)    && gzin_skip(g, 2) < 0) return -1;
+    return 1;
+}
+
+static int gzin_le32(GzIn *g, uLong *v) {
+    *v = 0;
+    for (int k = 0; k < 32; k += 8) {
+        int c = gzin_byte(g);
+        if (c < 0) return -1;
+        *v |= (uLong)c << k;
+    }
+    return 0;
+}
+
+/* Publish an output slot; without a writer thread it is written here */
+static int pipe_send(Pipe *p, int wr_thread) {
+    ring_put(&p->rout);
+    if (wr_thread) return 0;
+    int r = write_slot(p, ring_get_wait(&p->rout, NULL));
+    ring_get(&p->rout);
+    if (r < 0) { p->wr_err = 1; pipe_stop(p); }
+    return r < 0 ? -1 : 0;
+}
+
+/* Inflate every member; 1 on a format error, 2 on trailing garbage */
+static int inflate_stage(Pipe *p, GzIn *g, int wr_thread) {
+    z_stream s;
+    memset(&s, 0, sizeof(s));
+    int ret = 0, member = 0;
+    Slot *o = NULL;
+    if (inflateInit2(&s, -MAX_WBITS) != Z_OK) {
+        fprintf(stderr, "gzip: out of memory\n");
+        ret = 1;
+    }
+    while (ret == 0) {
+        /* Zero padding after a member (tape or block-padded files) is
+           skipped silently, as GNU gzip does */
+        if (member > 0)
+            while (gzin_peek(g) == 0) g->pos++;
+        long long start = gzin_tell(g);
+        int h = read_header(g);
+        if (h <= 0) {
+            if (p->stop) break;
+            if (member == 0) {
+                fprintf(stderr, h < 0 ? "gzip: %s: unexpected end of file\n"
+                                      : "gzip: %s: not in gzip format\n", p->name);
+                ret = 1;
+            } else if (gzin_tell(g) > start) {
+                fprintf(stderr, "gzip: %s: decompression OK, trailing garbage ignored\n",
+                        p->name);
+                ret = 2;
+            }
+            break;
+        }
+        member++;
+
+        inflateReset(&s);
+        int r = Z_OK;
+        for (;;) {
+            if (!o) {
+                if (!(o = ring_put_wait(&p->rout, &p->stop))) break;
+                o->len = 0;
+                o->end = o->last = 0;
+            }
+            if (g->pos == g->len && !gzin_fill(g)) { r = Z_BUF_ERROR; break; }
+            s.next_in   = g->buf + g->pos;
+            s.avail_in  = (uInt)(g->len - g->pos);
+            s.next_out  = o->buf + o->len;
+            s.avail_out = (uInt)(PIPE_SLOT - o->len);
+            r = inflate(&s, Z_NO_FLUSH);
+            g->pos = g->len - s.avail_in;
+            o->len = PIPE_SLOT - s.avail_out;
+            if (r != Z_OK) break;
+            if (o->len == PIPE_SLOT) {
+                if (pipe_send(p, wr_thread) < 0) break;
+                o = NULL;
+            }
+        }
+        if (p->stop) { o = NULL; break; }
+        if (r != Z_STREAM_END) {
+            if (r == Z_BUF_ERROR || r == Z_OK)
+                fprintf(stderr, "gzip: %s: unexpected end of file\n", p->name);
+            else
+                fprintf(stderr, "gzip: %s: invalid compressed data--format violated\n", p->name);
+            ret = 1;
+            break;
+        }
+        if (gzin_le32(g, &o->crc) < 0 || gzin_le32(g, &o->isize) < 0) {
+            fprintf(stderr, "gzip: %s: unexpected end of file\n", p->name);
+            ret = 1;
+            break;
+        }
+        o->end = 1;
+        if (pipe_send(p, wr_thread) < 0) { o = NULL; break; }
+        o = NULL;
+    }
+
+    /* Close the output ring; on an error the writer still gets the
+       partial slot, as gzread() would have handed it out */
+    if (!o && !p->stop && (o = ring_put_wait(&p->rout, &p->stop)) != NULL) {
+        o->len = 0;
+        o->end = 0;
+    }
+    if (o) {
+        o->end = 0;
+        o->last = 1;
+        pipe_send(p, wr_thread);
+    }
+    if (s.state) inflateEnd(&s);
+    return ret;
+}
+
+/*
+ * Decompress every member of in to out (NULL: only check). Returns 0 if
+ * all is well, 1 on an error, 2 when good data is followed by trailing
+ * garbage. *total gets the uncompressed size.
+ */
+static int gunzip_pipe(FILE *in, FILE *out, const char *name, int report, long long *total) {
+    Pipe *p = (Pipe *)calloc(1, sizeof(Pipe));
+    unsigned char *mem = (unsigned char *)malloc((size_t)2 * PIPE_SLOTS * PIPE_SLOT);
+    if (!p || !mem) {
+        fprintf(stderr, "gzip: out of memory\n");
+        free(p); free(mem);
+        return 1;
+    }
+    for (int i = 0; i < PIPE_SLOTS; i++) {
+        p->rin.slot[i].buf  = mem + (size_t)i * PIPE_SLOT;
+        p->rout.slot[i].buf = mem + (size_t)(PIPE_SLOTS + i) * PIPE_SLOT;
+    }
+    p->in = in;
+    p->out = out;
+    p->name = name;
+    p->report = report;
+    p->crc = crc32(0L, Z_NULL, 0);
+    ring_init(&p->rin);
+    ring_init(&p->rout);
+
+    GzIn g;
+    memset(&g, 0, sizeof(g));
+    g.stop = &p->stop;
+
+#ifdef _WIN32
+    HANDLE rd = CreateThread(NULL, 0, read_entry, p, 0, NULL);
+    HANDLE wr = CreateThread(NULL, 0, write_entry, p, 0, NULL);
+    int rd_thread = rd != NULL, wr_thread = wr != NULL;
+#else
+    pthread_t rd, wr;
+    int rd_thread = pthread_create(&rd, NULL, read_entry, p) == 0;
+    int wr_thread = pthread_create(&wr, NULL, write_entry, p) == 0;
+#endif
+    if (rd_thread) {
+        g.ring = &p->rin;
+    } else {
+        g.f   = in;
+        g.buf = p->rin.slot[0].buf;
+        g.cap = PIPE_SLOT;
+    }
+
+    int ret = inflate_stage(p, &g, wr_thread);
+    pipe_stop(p);               /* release a reader still filling slots */
+
+#ifdef _WIN32
+    if (rd_thread) { WaitForSingleObject(rd, INFINITE); CloseHandle(rd); }
+    if (wr_thread) { WaitForSingleObject(wr, INFINITE); CloseHandle(wr); }
+#else
+    if (rd_thread) pthread_join(rd, NULL);
+    if (wr_thread) pthread_join(wr, NULL);
+#endif
+
+    if (p->rd_err || p->wr_err) ret = 1;
+    *total = p->total;
+    ring_free(&p->rin);
+    ring_free(&p->rout);
+    free(mem);
+    free(p);
+    return ret;
+}
+
 /* ── decompress one file ─────────────────────────────────── */
 static int do_decompress(const char *inpath) {
     if (!has_gz_suffix(inpath) && !opt_force) {
@@ -142,11 +971,11 @@ static int do_decompress(const char *inpath) {
     char outpath[4096];
     FILE *out = NULL;
 
-    if (opt_stdout || opt_test) {
+    if (opt_stdout) {
 #ifdef _WIN32
-        if (opt_stdout) _setmode(_fileno(stdout), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
 #endif
-        out = opt_test ? NULL : stdout;
+        out = stdout;
     } else {
         if (build_outpath(inpath, outpath, sizeof(outpath)) != 0) return 1;
         if (!opt_force) {
@@ -163,37 +992,27 @@ static int do_decompress(const char *inpath) {
         }
     }
 
-    gzFile gz = gzopen(inpath, "rb");
-    if (!gz) {
+    FILE *in = fopen(inpath, "rb");
+    if (!in) {
         fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno));
-        if (out && out != stdout) fclose(out);
+        if (out != stdout) { fclose(out); remove(outpath); }
         return 1;
     }
 
-    unsigned char buf[CHUNK];
-    int n;
     long long out_bytes = 0;
-    int err = 0;
-    while ((n = gzread(gz, buf, sizeof(buf))) > 0) {
-        if (out && fwrite(buf, 1, (size_t)n, out) != (size_t)n) {
-            fprintf(stderr, "gzip: write error: %s\n", strerror(errno));
-            err = 1; break;
-        }
-        out_bytes += n;
-    }
-    if (n < 0) {
-        fprintf(stderr, "gzip: %s: %s\n", inpath, gzerror(gz, NULL));
-        err = 1;
+    int ret = gunzip_pipe(in, out, inpath, 0, &out_bytes);
+    fclose(in);
+    if (out != stdout && fclose(out) != 0 && ret != 1) {
+        fprintf(stderr, "gzip: %s: %s\n", outpath, strerror(errno));
+        ret = 1;
     }
-    gzclose(gz);
-    if (out && out != stdout) fclose(out);
 
-    if (err) {
-        if (!opt_stdout && !opt_test) remove(outpath);
+    if (ret == 1) {
+        if (!opt_stdout) remove(outpath);
         return 1;
     }
 
-    if (opt_verbose && !opt_stdout && !opt_test) {
+    if (opt_verbose && !opt_stdout) {
         struct stat st;
         long long in_bytes = 0;
         if (stat(inpath, &st) == 0) in_bytes = st.st_size;
@@ -201,56 +1020,505 @@ static int do_decompress(const char *inpath) {
         fprintf(stderr, "%s:\t%.1f%% -- replaced with %s\n", inpath, ratio, outpath);
     }
 
-    if (opt_test) {
-        if (opt_verbose) fprintf(stderr, "%s:\tOK\n", inpath);
-        return 0;
-    }
-
     if (!opt_stdout && !opt_keep)
         remove(inpath);
 
-    return 0;
+    return ret;
+}
+
+/* ── test mode ───────────────────────────────────────────── */
+static int do_test(FILE *in, const char *name) {
+    long long total;
+    int r = gunzip_pipe(in, NULL, name, opt_verbose, &total);
+    if (r != 1 && opt_verbose) fprintf(stderr, "%s:\tOK\n", name);
+    return r;
+}
+
+static int test_file(const char *inpath) {
+    FILE *in = fopen(inpath, "rb");
+    if (!in) { fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno)); return 1; }
+    int r = do_test(in, inpath);
+    fclose(in);
+    return r;
 }
 
 /* ── list mode ───────────────────────────────────────────── */
+/*
+ * The uncompressed size comes from the ISIZE field of the trailer. That
+ * field belongs to the last member only, so the file is first checked
+ * for more members, and if it has any they are counted with gunzip_pipe().
+ * When the compressed data is larger than any deflate stream of ISIZE
+ * bytes could be, there must be several (or over 4 GB). Otherwise the
+ * bytes are scanned for another member header: each "1f 8b 08" found is
+ * tried with inflate, and a real member always passes, where a chance
+ * match in deflate data fails within a few bytes. -v always counts.
+ */
+#define LIST_SCAN   (1024 * 1024)  /* bytes read per scan step */
+#define LIST_PROBE  65536          /* bytes inflated to try a candidate */
+
+/* Whether the data at off starts a gzip member: the header must parse and
+   the LIST_PROBE bytes that follow must inflate without error. */
+static int member_at(FILE *f, long long off, unsigned char *in, unsigned char *out) {
+    if (gz_fseek(f, off, SEEK_SET) != 0) return 1;
+    size_t n = fread(in, 1, LIST_PROBE, f);
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, 15 + 16) != Z_OK) return 1;
+    z.next_in  = in;
+    z.avail_in = (uInt)n;
+    int r;
+    do {
+        z.next_out  = out;
+        z.avail_out = CHUNK;
+        r = inflate(&z, Z_NO_FLUSH);
+    } while (r == Z_OK && z.avail_in > 0);
+    inflateEnd(&z);
+    return r != Z_DATA_ERROR;
+}
+
+/* Whether another member starts anywhere from offset from to the end */
+static int more_members(FILE *f, long long from, long long size) {
+    unsigned char *buf = (unsigned char *)malloc(LIST_SCAN + LIST_PROBE + CHUNK);
+    if (!buf) return 1;
+    unsigned char *probe = buf + LIST_SCAN, *out = probe + LIST_PROBE;
+    int found = 0;
+    long long at = from;
+    /* A member is at least 10 header, 2 deflate and 8 trailer bytes */
+    while (!found && at + 20 <= size) {
+        if (gz_fseek(f, at, SEEK_SET) != 0) { found = 1; break; }
+        size_t n = fread(buf, 1, LIST_SCAN, f);
+        if (n < 4) break;
+        for (unsigned char *p = buf; !found && p + 4 <= buf + n; p++) {
+            p = (unsigned char *)memchr(p, 0x1f, (size_t)(buf + n - 3 - p));
+            if (!p) break;
+            long long off = at + (p - buf);
+            if (p[1] == 0x8b && p[2] == 8 && !(p[3] & 0xe0) && off + 20 <= size)
+                found = member_at(f, off, probe, out);
+        }
+        if (n < LIST_SCAN) break;
+        at += (long long)n - 3;
+    }
+    free(buf);
+    return found;
+}
+
 static int do_list(const char *inpath) {
-    gzFile gz = gzopen(inpath, "rb");
-    if (!gz) { fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno)); return 1; }
-    unsigned char buf[CHUNK];
-    long long uncompressed = 0;
-    int n;
-    while ((n = gzread(gz, buf, sizeof(buf))) > 0) uncompressed += n;
-    gzclose(gz);
+    FILE *f = fopen(inpath, "rb");
+    if (!f) { fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno)); return 1; }
+
+    unsigned char hbuf[4096];
+    GzIn g;
+    memset(&g, 0, sizeof(g));
+    g.f   = f;
+    g.buf = hbuf;
+    g.cap = sizeof(hbuf);
+    int h = read_header(&g);
+    if (h <= 0) {
+        fprintf(stderr, h < 0 ? "gzip: %s: unexpected end of file\n"
+                              : "gzip: %s: not in gzip format\n", inpath);
+        fclose(f);
+        return 1;
+    }
+    long long hdr = gzin_tell(&g);
+
     struct stat st;
-    long long compressed = 0;
-    if (stat(inpath, &st) == 0) compressed = st.st_size;
-    double ratio = compressed > 0 ? 100.0 * (compressed - uncompressed) / uncompressed : 0.0;
+    unsigned char trl[8];
+    if (fstat(fileno(f), &st) != 0 || (long long)st.st_size < hdr + 10 ||
+        fseek(f, -8L, SEEK_END) != 0 || fread(trl, 1, 8, f) != 8) {
+        fprintf(stderr, "gzip: %s: unexpected end of file\n", inpath);
+        fclose(f);
+        return 1;
+    }
+    long long compressed = (long long)st.st_size;
+    long long uncompressed = (long long)trl[4] | (long long)trl[5] << 8 |
+                             (long long)trl[6] << 16 | (long long)trl[7] << 24;
+
+    /* deflateBound() for stored blocks, plus room for flush markers */
+    long long payload = compressed - hdr - 8;
+    long long bound = uncompressed + (uncompressed >> 5) + (uncompressed >> 7) +
+                      (uncompressed >> 11) + 64;
+    if (opt_verbose || payload > bound || more_members(f, hdr, compressed)) {
+        rewind(f);
+        if (gunzip_pipe(f, NULL, inpath, 0, &uncompressed) == 1) {
+            fclose(f);
+            return 1;
+        }
+    }
+    fclose(f);
+
+    double ratio = uncompressed > 0 ? 100.0 * (compressed - uncompressed) / uncompressed : 0.0;
     printf("%10lld %10lld %6.1f%% %s\n", compressed, uncompressed, -ratio, inpath);
     return 0;
 }
 
+/* ── access-point index (--index, --offset) ──────────────── */
+/*
+ * As in zlib's zran example: while inflating, every IDX_SPAN output bytes
+ * the position of the next deflate block is recorded (byte offset plus the
+ * bits of that byte already used) with the 32 KB of output before it. An
+ * extraction starts at the last point before the wanted offset: prime the
+ * bit buffer with inflatePrime(), load the window as the dictionary, and
+ * inflate from there. New members are points with an empty window.
+ *
+ * FILE.gz.gzi, all integers little-endian:
+ *   "WGZI"  u32 version (1)  u64 size of FILE.gz  u64 span  u32 npoints
+ *   per point:  u64 out  u64 in  u8 bits  u32 wlen  u32 zlen  zlen bytes
+ * where the window (wlen bytes) is stored zlib-compressed.
+ */
+#define IDX_SPAN    (1024 * 1024)
+#define IDX_WIN     32768
+#define IDX_MAGIC   "WGZI"
+
+static void put_le64(unsigned char *b, unsigned long long v) {
+    for (int k = 0; k < 8; k++) b[k] = (unsigned char)(v >> (8 * k));
+}
+
+static unsigned long long get_le(const unsigned char *b, int n) {
+    unsigned long long v = 0;
+    for (int k = n - 1; k >= 0; k--) v = v << 8 | b[k];
+    return v;
+}
+
+/* Append one point; win is the circular output window with left bytes
+   free at its end, mout the bytes this member has produced so far. */
+static int idx_point(FILE *ix, long long out, long long in, int bits,
+                     const unsigned char *win, unsigned left, long long mout,
+                     unsigned char *lin, unsigned char *zbuf, uLong zcap) {
+    unsigned wlen = mout < IDX_WIN ? (unsigned)mout : IDX_WIN;
+    memcpy(lin, win + IDX_WIN - left, left);
+    memcpy(lin + left, win, IDX_WIN - left);
+
+    uLongf zlen = zcap;
+    if (wlen && compress2(zbuf, &zlen, lin + IDX_WIN - wlen, wlen, 9) != Z_OK)
+        return -1;
+    if (!wlen) zlen = 0;
+
+    unsigned char rec[25];
+    put_le64(rec, (unsigned long long)out);
+    put_le64(rec + 8, (unsigned long long)in);
+    rec[16] = (unsigned char)bits;
+    put_le32(rec + 17, wlen);
+    put_le32(rec + 21, zlen);
+    if (fwrite(rec, 1, sizeof(rec), ix) != sizeof(rec) ||
+        fwrite(zbuf, 1, zlen, ix) != zlen)
+        return -1;
+    return 0;
+}
+
+static int do_index(const char *inpath) {
+    char ixpath[4096];
+    if (strlen(inpath) + 4 >= sizeof(ixpath)) { fprintf(stderr, "gzip: path too long\n"); return 1; }
+    snprintf(ixpath, sizeof(ixpath), "%s.gzi", inpath);
+
+    FILE *f = fopen(inpath, "rb");
+    if (!f) { fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno)); return 1; }
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) {
+        fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno));
+        fclose(f);
+        return 1;
+    }
+    FILE *ix = fopen(ixpath, "wb");
+    if (!ix) {
+        fprintf(stderr, "gzip: %s: %s\n", ixpath, strerror(errno));
+        fclose(f);
+        return 1;
+    }
+
+    uLong zcap = compressBound(IDX_WIN);
+    unsigned char *mem = (unsigned char *)malloc(PIPE_SLOT + 2 * IDX_WIN + zcap);
+    z_stream s;
+    memset(&s, 0, sizeof(s));
+    int ret = 1;
+    if (!mem || inflateInit2(&s, -MAX_WBITS) != Z_OK) {
+        fprintf(stderr, "gzip: out of memory\n");
+        goto done;
+    }
+    unsigned char *win = mem + PIPE_SLOT, *lin = win + IDX_WIN, *zbuf = lin + IDX_WIN;
+
+    GzIn g;
+    memset(&g, 0, sizeof(g));
+    g.f   = f;
+    g.buf = mem;
+    g.cap = PIPE_SLOT;
+
+    unsigned char hdr[28];
+    memcpy(hdr, IDX_MAGIC, 4);
+    put_le32(hdr + 4, 1);
+    put_le64(hdr + 8, (unsigned long long)st.st_size);
+    put_le64(hdr + 16, IDX_SPAN);
+    put_le32(hdr + 24, 0);                  /* npoints, filled in at the end */
+    if (fwrite(hdr, 1, sizeof(hdr), ix) != sizeof(hdr)) goto write_err;
+
+    long long total = 0, last = 0;
+    uLong npoints = 0;
+    int member = 0;
+    for (;;) {
+        int h = read_header(&g);
+        if (h <= 0) {
+            if (member == 0) {
+                fprintf(stderr, h < 0 ? "gzip: %s: unexpected end of file\n"
+                                      : "gzip: %s: not in gzip format\n", inpath);
+                goto done;
+            }
+            break;                          /* trailing garbage is not indexed */
+        }
+        member++;
+        inflateReset(&s);
+        long long mout = 0;
+        if (total - last >= IDX_SPAN) {
+            if (idx_point(ix, total, gzin_tell(&g), 0, win, IDX_WIN, 0, lin, zbuf, zcap) < 0)
+                goto write_err;
+            npoints++;
+            last = total;
+        }
+
+        s.avail_out = 0;
+        int r;
+        do {
+            if (s.avail_out == 0) { s.next_out = win; s.avail_out = IDX_WIN; }
+            if (g.pos == g.len && !gzin_fill(&g)) {
+                fprintf(stderr, "gzip: %s: unexpected end of file\n", inpath);
+                goto done;
+            }
+            s.next_in  = g.buf + g.pos;
+            s.avail_in = (uInt)(g.len - g.pos);
+            uInt before = s.avail_out;
+            r = inflate(&s, Z_BLOCK);
+            g.pos = g.len - s.avail_in;
+            total += before - s.avail_out;
+            mout  += before - s.avail_out;
+            if (r != Z_OK && r != Z_STREAM_END) {
+                fprintf(stderr, "gzip: %s: invalid compressed data--format violated\n", inpath);
+                goto done;
+            }
+            /* between two blocks, and not after the last one */
+            if ((s.data_type & 128) && !(s.data_type & 64) && total - last >= IDX_SPAN) {
+                if (idx_point(ix, total, gzin_tell(&g), s.data_type & 7, win,
+                              s.avail_out, mout, lin, zbuf, zcap) < 0)
+                    goto write_err;
+                npoints++;
+                last = total;
+            }
+        } while (r != Z_STREAM_END);
+        if (gzin_skip(&g, 8) < 0) {
+            fprintf(stderr, "gzip: %s: unexpected end of file\n", inpath);
+            goto done;
+        }
+    }
+
+    put_le32(hdr + 24, npoints);
+    if (fseek(ix, 24L, SEEK_SET) != 0 || fwrite(hdr + 24, 1, 4, ix) != 4) goto write_err;
+    if (opt_verbose)
+        fprintf(stderr, "%s:\t%lu access points -- wrote %s\n", inpath, (unsigned long)npoints, ixpath);
+    ret = 0;
+    goto done;
+
+write_err:
+    fprintf(stderr, "gzip: %s: write error: %s\n", ixpath, strerror(errno));
+done:
+    if (s.state) inflateEnd(&s);
+    free(mem);
+    fclose(f);
+    if (fclose(ix) != 0 && ret == 0) {
+        fprintf(stderr, "gzip: %s: %s\n", ixpath, strerror(errno));
+        ret = 1;
+    }
+    if (ret) remove(ixpath);
+    return ret;
+}
+
+/*
+ * Best point at or before offset from FILE.gz.gzi; 1 = found (win holds
+ * its window), 0 = no usable index or no point that early.
+ */
+static int idx_lookup(const char *inpath, long long gzsize, long long offset,
+                      long long *out, long long *in, int *bits,
+                      unsigned char *win, unsigned *wlen) {
+    char ixpath[4096];
+    snprintf(ixpath, sizeof(ixpath), "%s.gzi", inpath);
+    FILE *ix = fopen(ixpath, "rb");
+    if (!ix) return 0;
+
+    unsigned char hdr[28], rec[25];
+    int found = 0;
+    long zpos = 0;
+    uLong zlen = 0;
+    if (fread(hdr, 1, sizeof(hdr), ix) != sizeof(hdr) || memcmp(hdr, IDX_MAGIC, 4) ||
+        get_le(hdr + 4, 4) != 1) {
+        fprintf(stderr, "gzip: %s: not a gzip index, ignored\n", ixpath);
+        fclose(ix);
+        return 0;
+    }
+    if ((long long)get_le(hdr + 8, 8) != gzsize) {
+        fprintf(stderr, "gzip: %s: index is out of date, ignored\n", ixpath);
+        fclose(ix);
+        return 0;
+    }
+    for (unsigned long long n = get_le(hdr + 24, 4); n > 0; n--) {
+        if (fread(rec, 1, sizeof(rec), ix) != sizeof(rec)) break;
+        long long pout = (long long)get_le(rec, 8);
+        if (pout > offset) break;
+        *out  = pout;
+        *in   = (long long)get_le(rec + 8, 8);
+        *bits = rec[16] & 7;
+        *wlen = (unsigned)get_le(rec + 17, 4);
+        zlen  = (uLong)get_le(rec + 21, 4);
+        zpos  = ftell(ix);
+        found = 1;
+        if (fseek(ix, (long)zlen, SEEK_CUR) != 0) break;
+    }
+
+    if (found && *wlen) {
+        unsigned char *z = (unsigned char *)malloc(zlen ? zlen : 1);
+        uLongf got = IDX_WIN;
+        found = z && *wlen <= IDX_WIN && fseek(ix, zpos, SEEK_SET) == 0 &&
+                fread(z, 1, zlen, ix) == zlen &&
+                uncompress(win, &got, z, zlen) == Z_OK && got == *wlen;
+        free(z);
+        if (!found) fprintf(stderr, "gzip: %s: damaged index, ignored\n", ixpath);
+    }
+    fclose(ix);
+    return found;
+}
+
+/*
+ * Write length bytes (all if negative) of the uncompressed data starting
+ * at offset. A file with an index starts inflating at the nearest access
+ * point; otherwise, and on stdin, the data before offset is inflated and
+ * dropped. Checksums cannot be verified on a partial read.
+ */
+static int do_extract(FILE *f, const char *name, const char *inpath,
+                      long long offset, long long length) {
+    unsigned char *mem = (unsigned char *)malloc(2 * (size_t)PIPE_SLOT + IDX_WIN);
+    z_stream s;
+    memset(&s, 0, sizeof(s));
+    int ret = 1;
+    if (!mem || inflateInit2(&s, -MAX_WBITS) != Z_OK) {
+        fprintf(stderr, "gzip: out of memory\n");
+        free(mem);
+        return 1;
+    }
+    unsigned char *obuf = mem + PIPE_SLOT, *win = obuf + PIPE_SLOT;
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    GzIn g;
+    memset(&g, 0, sizeof(g));
+    g.f   = f;
+    g.buf = mem;
+    g.cap = PIPE_SLOT;
+
+    long long pos = 0, pin = 0;
+    int bits = 0;
+    unsigned wlen = 0;
+    struct stat st;
+    int h = 1;
+    if (inpath && fstat(fileno(f), &st) == 0 &&
+        idx_lookup(inpath, (long long)st.st_size, offset, &pos, &pin, &bits, win, &wlen)) {
+        long long at = pin - (bits ? 1 : 0);
+        if (at < 0 || gz_fseek(f, at, SEEK_SET) != 0) {
+            fprintf(stderr, "gzip: %s: cannot seek\n", name);
+            goto done;
+        }
+        g.used = at;
+        if (bits) {
+            int c = gzin_byte(&g);
+            if (c < 0) { fprintf(stderr, "gzip: %s: unexpected end of file\n", name); goto done; }
+            inflatePrime(&s, bits, c >> (8 - bits));
+        }
+        if (wlen) inflateSetDictionary(&s, win, wlen);
+    } else {
+        h = read_header(&g);
+    }
+    if (h <= 0) {
+        fprintf(stderr, h < 0 ? "gzip: %s: unexpected end of file\n"
+                              : "gzip: %s: not in gzip format\n", name);
+        goto done;
+    }
+
+    for (;;) {
+        int r = Z_OK;
+        while (r != Z_STREAM_END && length != 0) {
+            if (g.pos == g.len && !gzin_fill(&g)) {
+                fprintf(stderr, "gzip: %s: unexpected end of file\n", name);
+                goto done;
+            }
+            s.next_in   = g.buf + g.pos;
+            s.avail_in  = (uInt)(g.len - g.pos);
+            s.next_out  = obuf;
+            s.avail_out = PIPE_SLOT;
+            r = inflate(&s, Z_NO_FLUSH);
+            g.pos = g.len - s.avail_in;
+            if (r != Z_OK && r != Z_STREAM_END) {
+                fprintf(stderr, "gzip: %s: invalid compressed data--format violated\n", name);
+                goto done;
+            }
+            long long n = PIPE_SLOT - s.avail_out, skip = 0;
+            if (pos < offset) skip = offset - pos < n ? offset - pos : n;
+            pos += n;
+            n -= skip;
+            if (length >= 0 && n > length) n = length;
+            if (n > 0 && fwrite(obuf + skip, 1, (size_t)n, stdout) != (size_t)n) {
+                fprintf(stderr, "gzip: write error: %s\n", strerror(errno));
+                goto done;
+            }
+            if (length > 0) length -= n;
+        }
+        if (length == 0) break;
+        /* next member, if any */
+        if (gzin_skip(&g, 8) < 0 || read_header(&g) <= 0) break;
+        inflateReset(&s);
+    }
+    if (fflush(stdout) != 0) {
+        fprintf(stderr, "gzip: write error: %s\n", strerror(errno));
+        goto done;
+    }
+    ret = 0;
+
+done:
+    inflateEnd(&s);
+    free(mem);
+    return ret;
+}
+
+static int extract_file(const char *inpath, long long offset, long long length) {
+    FILE *f = fopen(inpath, "rb");
+    if (!f) { fprintf(stderr, "gzip: %s: %s\n", inpath, strerror(errno)); return 1; }
+    int r = do_extract(f, inpath, inpath, offset, length);
+    fclose(f);
+    return r;
+}
+
 /* ── stdin mode ──────────────────────────────────────────── */
 static int do_stdin(void) {
 #ifdef _WIN32
     _setmode(_fileno(stdin),  _O_BINARY);
     _setmode(_fileno(stdout), _O_BINARY);
 #endif
-    if (opt_decompress) {
-        gzFile gz = gzdopen(_dup(_fileno(stdin)), "rb");
-        if (!gz) { fprintf(stderr, "gzip: cannot read stdin\n"); return 1; }
-        unsigned char buf[CHUNK]; int n;
-        while ((n = gzread(gz, buf, sizeof(buf))) > 0)
-            fwrite(buf, 1, (size_t)n, stdout);
-        gzclose(gz);
+    if (opt_offset >= 0) {
+        return do_extract(stdin, "stdin", NULL, opt_offset, opt_length);
+    } else if (opt_test) {
+        return do_test(stdin, "stdin");
+    } else if (opt_decompress) {
+        long long out_bytes;
+        return gunzip_pipe(stdin, stdout, "stdin", 0, &out_bytes);
+    } else if (opt_threads > 1 || opt_rsyncable) {
+        long long in_bytes;
+        return par_deflate(stdin, stdout, &in_bytes);
     } else {
         char mode[8];
         snprintf(mode, sizeof(mode), "wb%d", opt_level == Z_DEFAULT_COMPRESSION ? 6 : opt_level);
         gzFile gz = gzdopen(_dup(_fileno(stdout)), mode);
         if (!gz) { fprintf(stderr, "gzip: cannot write stdout\n"); return 1; }
-        unsigned char buf[CHUNK]; size_t n;
-        while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
-            gzwrite(gz, buf, (unsigned)n);
-        gzclose(gz);
+        long long in_bytes = 0;
+        int err = gz_copy(stdin, gz, &in_bytes);
+        if (gzclose(gz) != Z_OK && !err) {
+            fprintf(stderr, "gzip: write error\n");
+            err = 1;
+        }
+        return err;
     }
     return 0;
 }
@@ -281,12 +1549,41 @@ int main(int argc, char *argv[]) {
                 "  -l        list compressed file info\n"
                 "  -t        test integrity\n"
                 "  -1..-9    compression level\n"
+                "  -p N, --processes=N\n"
+                "            compress on N threads (one gzip member)\n"
+                "      --rsyncable\n"
+                "            reset the compressor at content-defined points\n"
+                "      --index\n"
+                "            write FILE.gzi, an access-point index of FILE\n"
+                "      --offset=N [--length=N]\n"
+                "            write N bytes of uncompressed data from offset N\n"
+                "            to stdout, starting from FILE.gzi if present\n"
                 "      --version\n"
                 "      --help\n");
             return 0;
         }
         if (!strcmp(a, "--")) { argi++; break; }
-        for (const char *p = a + 1; *p; p++) {
+        const char *nthr = NULL;
+        if (!strcmp(a, "--rsyncable")) {
+            opt_rsyncable = 1;
+            continue;
+        } else if (!strcmp(a, "--index")) {
+            opt_index = 1;
+            continue;
+        } else if (!strncmp(a, "--offset=", 9) || !strncmp(a, "--length=", 9)) {
+            long long *v = a[2] == 'o' ? &opt_offset : &opt_length;
+            if (parse_size(a + 9, v) != 0) {
+                fprintf(stderr, "gzip: invalid size in '%s'\n", a);
+                return 1;
+            }
+            continue;
+        } else if (!strncmp(a, "--processes=", 12)) {
+            nthr = a + 12;
+        } else if (a[1] == '-') {
+            fprintf(stderr, "gzip: unrecognized option '%s'\n", a);
+            return 1;
+        }
+        for (const char *p = a + 1; !nthr && *p; p++) {
             switch (*p) {
                 case 'd': opt_decompress = 1; break;
                 case 'k': opt_keep       = 1; break;
@@ -298,24 +1595,55 @@ int main(int argc, char *argv[]) {
                 case '1': case '2': case '3': case '4': case '5':
                 case '6': case '7': case '8': case '9':
                     opt_level = *p - '0'; break;
+                case 'p':
+                    if (p[1]) nthr = p + 1;
+                    else if (argi + 1 < argc) nthr = argv[++argi];
+                    else {
+                        fprintf(stderr, "gzip: option requires an argument -- 'p'\n");
+                        return 1;
+                    }
+                    break;
                 default:
                     fprintf(stderr, "gzip: invalid option -- '%c'\n", *p);
                     return 1;
             }
         }
+        if (nthr) {
+            char *end;
+            long v = strtol(nthr, &end, 10);
+            if (*end || end == nthr || v < 1) {
+                fprintf(stderr, "gzip: invalid number of processes '%s'\n", nthr);
+                return 1;
+            }
+            opt_threads = v > THREADS_MAX ? THREADS_MAX : (int)v;
+        }
     }
 
+    if (opt_length >= 0 && opt_offset < 0) opt_offset = 0;
+
     /* No files — operate on stdin/stdout */
-    if (argi >= argc) return do_stdin();
+    if (argi >= argc) {
+        if (opt_index) {
+            fprintf(stderr, "gzip: --index needs a file\n");
+            return 1;
+        }
+        return do_stdin();
+    }
 
     if (opt_list)
         printf("%10s %10s  ratio  name\n", "compressed", "uncompressed");
 
+    /* An error (1) outranks a warning (2) */
     int ret = 0;
     for (int i = argi; i < argc; i++) {
-        if (opt_list)        ret |= do_list(argv[i]);
-        else if (opt_decompress) ret |= do_decompress(argv[i]);
-        else                 ret |= do_compress(argv[i]);
+        int r;
+        if (opt_index)           r = do_index(argv[i]);
+        else if (opt_offset >= 0) r = extract_file(argv[i], opt_offset, opt_length);
+        else if (opt_list)       r = do_list(argv[i]);
+        else if (opt_test)       r = test_file(argv[i]);
+        else if (opt_decompress) r = do_decompress(argv[i]);
+        else                     r = do_compress(argv[i]);
+        if (r == 1 || (r == 2 && ret == 0)) ret = r;
     }
     return ret;
 }
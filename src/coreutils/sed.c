@@ -3,10 +3,14 @@
  *
  * Supports:
  *   Options : -n -e SCRIPT -f FILE -E/-r -i --
- *   Commands: s d p q = a i y
+ *   Commands: s d D p P l q Q = a i c y r w n N h H g G x : b t T { }
  *   Addresses: line, $, /regex/, ranges (N,M  N,+M  /re/,/re/), negation (!)
  *   Replacement: & \1-\9 \n \\ in s command
  *
+ * The script is compiled once into a Command array: blocks and branch
+ * labels become command indices, so each cycle is a single switch-driven
+ * pass. Pattern and hold space are growable buffers with no line limit.
+ *
  * Uses a self-contained regex engine (no regex.h required).
  */
 
@@ -450,8 +454,8 @@ void regfree(regex_t *re)
 
 #define MAX_CMDS      256
 #define MAX_SCRIPTS   64
-#define PAT_SIZE      65536
 #define ADDR_PAT_SIZE 256
+#define L_WRAP        70
 
 /* s-command flag bits */
 #define S_GLOBAL  (1 << 0)
@@ -459,6 +463,9 @@ void regfree(regex_t *re)
 #define S_PRINT   (1 << 2)
 #define S_NTH     (1 << 3)
 
+/* How a cycle ended — decides autoprint and whether input is read. */
+enum { CYCLE_END, CYCLE_DELETE, CYCLE_RESTART, CYCLE_QUIT, CYCLE_QUIT_SILENT };
+
 /* ------------------------------------------------------------------ */
 /* Data structures                                                      */
 /* ------------------------------------------------------------------ */
@@ -484,16 +491,39 @@ typedef struct {
     int    s_nth;
     regex_t s_re;
     int    s_compiled;
-    /* a / i command */
+    /* a / i / c text, r / w filename */
     char  *text;
+    /* w command */
+    FILE  *wfp;
+    /* : label, b / t / T target label */
+    char  *label;
+    /* b / t / T: index of the ':' to resume after; '{': index of matching '}' */
+    int    jump;
     /* y command */
-    unsigned char y_from[256];
-    unsigned char y_to[256];
-    int    y_len;
+    unsigned char y_map[256];
     /* range state */
     int    in_range;
 } Command;
 
+/* Growable byte buffer, always NUL-terminated for the regex engine. */
+typedef struct {
+    char *s;
+    int   len;
+    int   cap;
+} Buf;
+
+/* Input with one line of lookahead so '$' is known before a line runs.
+ * The file arguments are read as one stream: when fp runs out the next
+ * name in files is opened, so '$', line numbers and n/N span files. */
+typedef struct {
+    FILE  *fp;
+    int    own;        /* fp was opened from files and is closed here */
+    char **files;
+    int    nfiles;
+    Buf    next;
+    int    has_next;
+} Input;
+
 /* ------------------------------------------------------------------ */
 /* Globals                                                              */
 /* ------------------------------------------------------------------ */
@@ -510,8 +540,13 @@ static int      g_inplace  = 0;
 
 static int      g_lineno   = 0;
 static int      g_is_last  = 0;
+static int      g_subst    = 0;   /* s succeeded since last input or t/T */
+
+static Buf      g_ps;             /* pattern space */
+static Buf      g_hs;             /* hold space */
+static Buf      g_sbuf;           /* s command output, swapped with g_ps */
 
-static char    *g_pending_a[MAX_CMDS];
+static Command *g_pending[MAX_CMDS];  /* queued a / r output */
 static int      g_npending  = 0;
 
 /* ------------------------------------------------------------------ */
@@ -530,6 +565,41 @@ static void die2(const char *a, const char *b)
     exit(1);
 }
 
+/* ------------------------------------------------------------------ */
+/* Buffer helpers                                                       */
+/* ------------------------------------------------------------------ */
+
+static void buf_reserve(Buf *b, int need)
+{
+    if (need + 1 <= b->cap) return;
+    int cap = b->cap ? b->cap : 256;
+    while (cap < need + 1) cap *= 2;
+    char *s = realloc(b->s, (size_t)cap);
+    if (!s) die("out of memory");
+    b->s   = s;
+    b->cap = cap;
+    b->s[b->len] = '\0';
+}
+
+static void buf_append(Buf *b, const char *s, int len)
+{
+    buf_reserve(b, b->len + len);
+    memcpy(b->s + b->len, s, (size_t)len);
+    b->len += len;
+    b->s[b->len] = '\0';
+}
+
+static void buf_set(Buf *b, const char *s, int len)
+{
+    b->len = 0;
+    buf_append(b, s, len);
+}
+
+static void buf_swap(Buf *a, Buf *b)
+{
+    Buf t = *a; *a = *b; *b = t;
+}
+
 /* ------------------------------------------------------------------ */
 /* Script buffer helpers                                                */
 /* ------------------------------------------------------------------ */
@@ -661,6 +731,56 @@ static char *parse_text_arg(const char **p)
     return t;
 }
 
+/* Label for ':' / 'b' / 't' / 'T'. Labels end at a newline or ';' (GNU);
+ * branch targets additionally end at blanks and '}' so "b end}" works. */
+static char *parse_label(const char **p, int is_def)
+{
+    skip_blanks(p);
+    const char *start = *p;
+    while (**p && **p != '\n' && **p != ';') {
+        if (!is_def && (**p == ' ' || **p == '\t' || **p == '}')) break;
+        (*p)++;
+    }
+    const char *end = *p;
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    size_t len = (size_t)(end - start);
+    char *s = malloc(len + 1);
+    if (!s) die("out of memory");
+    memcpy(s, start, len);
+    s[len] = '\0';
+    return s;
+}
+
+/* Filename for 'r' / 'w' — runs to end of line, as in POSIX. */
+static char *parse_filename(const char **p)
+{
+    skip_blanks(p);
+    const char *start = *p;
+    while (**p && **p != '\n') (*p)++;
+    size_t len = (size_t)(*p - start);
+    if (len == 0) die("missing filename in r/w command");
+    char *s = malloc(len + 1);
+    if (!s) die("out of memory");
+    memcpy(s, start, len);
+    s[len] = '\0';
+    return s;
+}
+
+/* Several 'w' commands naming the same file share one handle, so their
+ * output interleaves instead of truncating each other. */
+static FILE *open_wfile(const char *path)
+{
+    if (strcmp(path, "/dev/stdout") == 0) return stdout;
+    if (strcmp(path, "/dev/stderr") == 0) return stderr;
+    for (int i = 0; i < g_ncmds; i++) {
+        if (g_cmds[i].cmd == 'w' && strcmp(g_cmds[i].text, path) == 0)
+            return g_cmds[i].wfp;
+    }
+    FILE *fp = fopen(path, "w");
+    if (!fp) die2(path, strerror(errno));
+    return fp;
+}
+
 static void parse_y_cmd(const char **p, Command *cmd)
 {
     if (!**p) die("y: missing delimiter");
@@ -694,10 +814,14 @@ static void parse_y_cmd(const char **p, Command *cmd)
     }
     if (**p == delim) (*p)++;
     if (fi != ti) die("y: unequal set lengths");
-    cmd->y_len = fi;
+    /* Compile to a 256-entry table; first mapping of a byte wins. */
+    int seen[256] = {0};
+    for (int i = 0; i < 256; i++) cmd->y_map[i] = (unsigned char)i;
     for (int i = 0; i < fi; i++) {
-        cmd->y_from[i] = (unsigned char)from_raw[i];
-        cmd->y_to[i]   = (unsigned char)to_raw[i];
+        unsigned char c = (unsigned char)from_raw[i];
+        if (seen[c]) continue;
+        seen[c] = 1;
+        cmd->y_map[c] = (unsigned char)to_raw[i];
     }
 }
 
@@ -734,9 +858,30 @@ static void parse_s_cmd(const char **p, Command *cmd)
     cmd->s_compiled = 1;
 }
 
+/* Branch targets are resolved to command indices once, so the executor
+ * never searches for labels while processing input. */
+static void resolve_labels(void)
+{
+    for (int i = 0; i < g_ncmds; i++) {
+        Command *cmd = &g_cmds[i];
+        if (cmd->cmd != 'b' && cmd->cmd != 't' && cmd->cmd != 'T') continue;
+        if (cmd->label[0] == '\0') { cmd->jump = g_ncmds; continue; }
+        cmd->jump = -1;
+        for (int j = 0; j < g_ncmds; j++) {
+            if (g_cmds[j].cmd == ':' && strcmp(g_cmds[j].label, cmd->label) == 0) {
+                cmd->jump = j;
+                break;
+            }
+        }
+        if (cmd->jump < 0) die2("can't find label for jump to", cmd->label);
+    }
+}
+
 static void parse_script(const char *script)
 {
     const char *p = script;
+    int blocks[MAX_CMDS];
+    int nblocks = 0;
 
     while (*p) {
         while (*p == ' ' || *p == '\t' || *p == '\n' || *p == ';' || *p == '\r')
@@ -777,15 +922,35 @@ static void parse_script(const char *script)
         switch (cmd->cmd) {
             case 's': parse_s_cmd(&p, cmd); break;
             case 'y': parse_y_cmd(&p, cmd); break;
-            case 'a': case 'i': cmd->text = parse_text_arg(&p); break;
-            case 'd': case 'p': case 'q': case '=': break;
-            case '{': case '}': break;
+            case 'a': case 'i': case 'c': cmd->text = parse_text_arg(&p); break;
+            case 'r': cmd->text = parse_filename(&p); break;
+            case 'w':
+                cmd->text = parse_filename(&p);
+                cmd->wfp  = open_wfile(cmd->text);
+                break;
+            case ':':
+                if (has_a1) die(": doesn't want any addresses");
+                cmd->label = parse_label(&p, 1);
+                if (cmd->label[0] == '\0') die("\":\" lacks a label");
+                break;
+            case 'b': case 't': case 'T': cmd->label = parse_label(&p, 0); break;
+            case '{': blocks[nblocks++] = g_ncmds; break;
+            case '}':
+                if (nblocks == 0) die("unexpected '}'");
+                g_cmds[blocks[--nblocks]].jump = g_ncmds;
+                break;
+            case 'd': case 'D': case 'p': case 'P': case 'q': case 'Q':
+            case '=': case 'l': case 'n': case 'N':
+            case 'h': case 'H': case 'g': case 'G': case 'x':
+                break;
             default:
                 fprintf(stderr, "sed: unknown command '%c'\n", cmd->cmd);
                 exit(1);
         }
         g_ncmds++;
     }
+    if (nblocks > 0) die("unmatched '{'");
+    resolve_labels();
 }
 
 /* ------------------------------------------------------------------ */
@@ -860,69 +1025,58 @@ static int cmd_active(Command *cmd, const char *buf, int lineno, int is_last)
 /* s command execution                                                  */
 /* ------------------------------------------------------------------ */
 
-static int build_replacement(const char *repl, const char *src,
-                              regmatch_t *match, char *out, int outsz)
+static void build_replacement(const char *repl, const char *src,
+                              regmatch_t *match, Buf *out)
 {
-    int wi = 0;
     for (const char *r = repl; *r; r++) {
         if (*r == '\\') {
             r++;
             if (!*r) break;
             if (*r >= '1' && *r <= '9') {
                 int gn = *r - '0';
-                if (match[gn].rm_so >= 0) {
-                    int glen = match[gn].rm_eo - match[gn].rm_so;
-                    if (wi + glen < outsz) {
-                        memcpy(out + wi, src + match[gn].rm_so, (size_t)glen);
-                        wi += glen;
-                    }
-                }
-            } else if (*r == '\\') {
-                if (wi < outsz - 1) out[wi++] = '\\';
+                if (match[gn].rm_so >= 0)
+                    buf_append(out, src + match[gn].rm_so, match[gn].rm_eo - match[gn].rm_so);
             } else if (*r == 'n') {
-                if (wi < outsz - 1) out[wi++] = '\n';
+                buf_append(out, "\n", 1);
             } else if (*r == 'u') {
                 r++;
-                if (*r && wi < outsz - 1)
-                    out[wi++] = (char)toupper((unsigned char)*r);
+                if (!*r) break;
+                char c = (char)toupper((unsigned char)*r);
+                buf_append(out, &c, 1);
             } else {
-                if (wi < outsz - 1) out[wi++] = *r;
+                buf_append(out, r, 1);
             }
         } else if (*r == '&') {
-            int mlen = match[0].rm_eo - match[0].rm_so;
-            if (wi + mlen < outsz) {
-                memcpy(out + wi, src + match[0].rm_so, (size_t)mlen);
-                wi += mlen;
-            }
+            buf_append(out, src + match[0].rm_so, match[0].rm_eo - match[0].rm_so);
         } else {
-            if (wi < outsz - 1) out[wi++] = *r;
+            buf_append(out, r, 1);
         }
     }
-    out[wi] = '\0';
-    return wi;
 }
 
-static int exec_s(Command *cmd, char *buf, int *buflen)
+/* Builds the result in g_sbuf and swaps it in, so the pattern space can
+ * grow past any fixed size (N, G and \n in replacements all lengthen it). */
+static int exec_s(Command *cmd, Buf *ps)
 {
     regmatch_t pmatch[10];
-    char tmp[PAT_SIZE];
-    char repl_buf[PAT_SIZE];
+    Buf *tmp = &g_sbuf;
 
     int global = (cmd->s_flags & S_GLOBAL) != 0;
     int nth    = (cmd->s_flags & S_NTH)    != 0 ? cmd->s_nth : 1;
     int made   = 0;
     int occur  = 0;
-    int wi     = 0;
-    const char *src = buf;
-    int src_len = *buflen;
+    const char *src = ps->s;
+    int src_len = ps->len;
     int pos = 0;
 
+    tmp->len = 0;
+    buf_reserve(tmp, src_len);
+
     while (pos <= src_len) {
         int eflags = (pos > 0) ? REG_NOTBOL : 0;
         int rc = regexec(&cmd->s_re, src + pos, 10, pmatch, eflags);
         if (rc != 0) {
-            int rem = src_len - pos;
-            if (wi + rem < PAT_SIZE) { memcpy(tmp + wi, src + pos, (size_t)rem); wi += rem; }
+            buf_append(tmp, src + pos, src_len - pos);
             break;
         }
 
@@ -931,7 +1085,7 @@ static int exec_s(Command *cmd, char *buf, int *buflen)
         int mend   = pmatch[0].rm_eo;
 
         /* copy pre-match */
-        if (wi + mstart < PAT_SIZE) { memcpy(tmp + wi, src + pos, (size_t)mstart); wi += mstart; }
+        buf_append(tmp, src + pos, mstart);
 
         if (occur == nth || (global && occur >= nth)) {
             /* fix up pmatch offsets relative to full src */
@@ -940,121 +1094,261 @@ static int exec_s(Command *cmd, char *buf, int *buflen)
                 abs_match[g].rm_so = (pmatch[g].rm_so >= 0) ? pmatch[g].rm_so + pos : -1;
                 abs_match[g].rm_eo = (pmatch[g].rm_eo >= 0) ? pmatch[g].rm_eo + pos : -1;
             }
-            int rlen = build_replacement(cmd->s_repl, src, abs_match, repl_buf, PAT_SIZE);
-            if (wi + rlen < PAT_SIZE) { memcpy(tmp + wi, repl_buf, (size_t)rlen); wi += rlen; }
+            build_replacement(cmd->s_repl, src, abs_match, tmp);
             made = 1;
         } else {
-            int mlen = mend - mstart;
-            if (wi + mlen < PAT_SIZE) { memcpy(tmp + wi, src + pos + mstart, (size_t)mlen); wi += mlen; }
+            buf_append(tmp, src + pos + mstart, mend - mstart);
         }
 
         pos += mend;
 
         if (mend == mstart) {
-            if (pos < src_len && wi < PAT_SIZE - 1) tmp[wi++] = src[pos++];
+            if (pos < src_len) { buf_append(tmp, src + pos, 1); pos++; }
             else break;
         }
 
         if (!global && occur >= nth) {
-            int rem = src_len - pos;
-            if (wi + rem < PAT_SIZE) { memcpy(tmp + wi, src + pos, (size_t)rem); wi += rem; }
+            buf_append(tmp, src + pos, src_len - pos);
             break;
         }
     }
 
-    if (made) {
-        tmp[wi] = '\0';
-        memcpy(buf, tmp, (size_t)wi + 1);
-        *buflen = wi;
-    }
+    if (made) buf_swap(ps, tmp);
     return made;
 }
 
 /* ------------------------------------------------------------------ */
-/* y command                                                            */
+/* y / l commands                                                       */
 /* ------------------------------------------------------------------ */
 
-static void exec_y(Command *cmd, char *buf, int *buflen)
+static void exec_y(Command *cmd, Buf *ps)
+{
+    unsigned char *s = (unsigned char *)ps->s;
+    for (int i = 0; i < ps->len; i++) s[i] = cmd->y_map[s[i]];
+}
+
+/* Print the pattern space unambiguously, wrapping long lines with '\'. */
+static void exec_l(const Buf *ps, FILE *out)
 {
-    for (int i = 0; i < *buflen; i++) {
-        unsigned char c = (unsigned char)buf[i];
-        for (int j = 0; j < cmd->y_len; j++) {
-            if (cmd->y_from[j] == c) { buf[i] = (char)cmd->y_to[j]; break; }
+    int col = 0;
+    for (int i = 0; i < ps->len; i++) {
+        unsigned char c = (unsigned char)ps->s[i];
+        char num[8];
+        const char *esc;
+        switch (c) {
+            case '\\': esc = "\\\\"; break;
+            case '\a': esc = "\\a";  break;
+            case '\b': esc = "\\b";  break;
+            case '\f': esc = "\\f";  break;
+            case '\n': esc = "\\n";  break;
+            case '\r': esc = "\\r";  break;
+            case '\t': esc = "\\t";  break;
+            case '\v': esc = "\\v";  break;
+            default:
+                if (isprint(c)) snprintf(num, sizeof(num), "%c", c);
+                else            snprintf(num, sizeof(num), "\\%03o", c);
+                esc = num;
         }
+        int w = (int)strlen(esc);
+        if (col + w > L_WRAP - 1) { fputs("\\\n", out); col = 0; }
+        fputs(esc, out);
+        col += w;
     }
+    fputs("$\n", out);
 }
 
 /* ------------------------------------------------------------------ */
-/* Process one line                                                     */
+/* Input                                                                */
 /* ------------------------------------------------------------------ */
 
-static int process_line(char *buf, int *buflen, FILE *out)
+/* Read one line of any length into b, without its \n or \r\n. */
+static int read_raw_line(FILE *fp, Buf *b)
+{
+    b->len = 0;
+    buf_reserve(b, 255);
+    int got = 0;
+    while (fgets(b->s + b->len, b->cap - b->len, fp)) {
+        got = 1;
+        b->len += (int)strlen(b->s + b->len);
+        if (b->len > 0 && b->s[b->len - 1] == '\n') break;
+        buf_reserve(b, b->cap * 2);
+    }
+    if (b->len > 0 && b->s[b->len - 1] == '\n') b->s[--b->len] = '\0';
+    if (b->len > 0 && b->s[b->len - 1] == '\r') b->s[--b->len] = '\0';
+    return got;
+}
+
+/* Read the lookahead line, moving on to the next file at end of input.
+ * A file that cannot be opened is reported and skipped. */
+static int read_input(Input *in)
+{
+    for (;;) {
+        if (in->fp && read_raw_line(in->fp, &in->next)) return 1;
+        if (in->own) fclose(in->fp);
+        in->fp = NULL;
+        in->own = 0;
+        if (in->nfiles == 0) return 0;
+        const char *path = *in->files++;
+        in->nfiles--;
+        if (strcmp(path, "-") == 0)
+            in->fp = stdin;
+        else if (!(in->fp = fopen(path, "r")))
+            fprintf(stderr, "sed: cannot open '%s': %s\n", path, strerror(errno));
+        else
+            in->own = 1;
+    }
+}
+
+/* Move the lookahead line into dst (append: after an embedded newline)
+ * and refill the lookahead. Returns 0 when input is exhausted. */
+static int next_line(Input *in, Buf *dst, int append)
+{
+    if (!in->has_next) return 0;
+    if (append) {
+        buf_append(dst, "\n", 1);
+        buf_append(dst, in->next.s, in->next.len);
+    } else {
+        buf_swap(dst, &in->next);
+    }
+    in->has_next = read_input(in);
+    g_is_last = !in->has_next;
+    g_lineno++;
+    g_subst = 0;
+    return 1;
+}
+
+static void flush_pending(FILE *out)
 {
-    int deleted = 0;
-    int quit    = 0;
-    g_npending  = 0;
+    for (int i = 0; i < g_npending; i++) {
+        Command *cmd = g_pending[i];
+        if (cmd->cmd == 'a') { fputs(cmd->text, out); continue; }
+        /* r: a missing file is silently ignored, as POSIX requires */
+        FILE *rf = fopen(cmd->text, "rb");
+        if (!rf) continue;
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), rf)) > 0) fwrite(buf, 1, n, out);
+        fclose(rf);
+    }
+    g_npending = 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Execute the compiled script against the pattern space                */
+/* ------------------------------------------------------------------ */
 
-    for (int ci = 0; ci < g_ncmds && !deleted && !quit; ci++) {
-        Command *cmd = &g_cmds[ci];
-        if (!cmd_active(cmd, buf, g_lineno, g_is_last)) continue;
+static int exec_script(Input *in, FILE *out)
+{
+    for (int pc = 0; pc < g_ncmds; pc++) {
+        Command *cmd = &g_cmds[pc];
+        if (!cmd_active(cmd, g_ps.s, g_lineno, g_is_last)) {
+            if (cmd->cmd == '{') pc = cmd->jump;
+            continue;
+        }
 
         switch (cmd->cmd) {
-            case 'd': deleted = 1; break;
-            case 'p': fwrite(buf, 1, (size_t)*buflen, out); fputc('\n', out); break;
-            case 'q': quit = 1; break;
+            case '{': case '}': case ':': break;
+            case 'd': return CYCLE_DELETE;
+            case 'D': {
+                char *nl = memchr(g_ps.s, '\n', (size_t)g_ps.len);
+                if (!nl) return CYCLE_DELETE;
+                int cut = (int)(nl - g_ps.s) + 1;
+                memmove(g_ps.s, g_ps.s + cut, (size_t)(g_ps.len - cut) + 1);
+                g_ps.len -= cut;
+                return CYCLE_RESTART;
+            }
+            case 'p': fwrite(g_ps.s, 1, (size_t)g_ps.len, out); fputc('\n', out); break;
+            case 'P': {
+                char *nl = memchr(g_ps.s, '\n', (size_t)g_ps.len);
+                int n = nl ? (int)(nl - g_ps.s) : g_ps.len;
+                fwrite(g_ps.s, 1, (size_t)n, out); fputc('\n', out);
+                break;
+            }
+            case 'l': exec_l(&g_ps, out); break;
+            case 'q': return CYCLE_QUIT;
+            case 'Q': return CYCLE_QUIT_SILENT;
             case '=': fprintf(out, "%d\n", g_lineno); break;
-            case 'a': if (g_npending < MAX_CMDS) g_pending_a[g_npending++] = cmd->text; break;
+            case 'a': case 'r':
+                if (g_npending < MAX_CMDS) g_pending[g_npending++] = cmd;
+                break;
             case 'i': fputs(cmd->text, out); break;
+            case 'c':
+                /* In the middle of a range, delete silently; text goes out once at its end */
+                if (cmd->a2.type == ADDR_NONE || !cmd->in_range || cmd->negate)
+                    fputs(cmd->text, out);
+                return CYCLE_DELETE;
+            case 'w':
+                fwrite(g_ps.s, 1, (size_t)g_ps.len, cmd->wfp); fputc('\n', cmd->wfp);
+                break;
             case 's': {
-                int changed = exec_s(cmd, buf, buflen);
-                if (changed && (cmd->s_flags & S_PRINT)) {
-                    fwrite(buf, 1, (size_t)*buflen, out); fputc('\n', out);
+                if (!exec_s(cmd, &g_ps)) break;
+                g_subst = 1;
+                if (cmd->s_flags & S_PRINT) {
+                    fwrite(g_ps.s, 1, (size_t)g_ps.len, out); fputc('\n', out);
                 }
                 break;
             }
-            case 'y': exec_y(cmd, buf, buflen); break;
+            case 'y': exec_y(cmd, &g_ps); break;
+            case 'h': buf_set(&g_hs, g_ps.s, g_ps.len); break;
+            case 'H': buf_append(&g_hs, "\n", 1); buf_append(&g_hs, g_ps.s, g_ps.len); break;
+            case 'g': buf_set(&g_ps, g_hs.s, g_hs.len); break;
+            case 'G': buf_append(&g_ps, "\n", 1); buf_append(&g_ps, g_hs.s, g_hs.len); break;
+            case 'x': buf_swap(&g_ps, &g_hs); break;
+            case 'n':
+                /* GNU: with no next line in the last file, quit without
+                   running the rest */
+                if (!in->has_next) return CYCLE_QUIT;
+                if (!g_suppress) { fwrite(g_ps.s, 1, (size_t)g_ps.len, out); fputc('\n', out); }
+                flush_pending(out);
+                next_line(in, &g_ps, 0);
+                break;
+            case 'N':
+                if (!in->has_next) return CYCLE_QUIT;
+                flush_pending(out);
+                next_line(in, &g_ps, 1);
+                break;
+            case 'b': pc = cmd->jump; break;
+            case 't': if (g_subst)  { g_subst = 0; pc = cmd->jump; } break;
+            case 'T': if (!g_subst) { pc = cmd->jump; } else g_subst = 0; break;
             default:  break;
         }
     }
-
-    if (!deleted && !g_suppress) {
-        fwrite(buf, 1, (size_t)*buflen, out);
-        fputc('\n', out);
-    }
-    for (int i = 0; i < g_npending; i++) fputs(g_pending_a[i], out);
-    return quit;
+    return CYCLE_END;
 }
 
 /* ------------------------------------------------------------------ */
 /* Stream processing                                                    */
 /* ------------------------------------------------------------------ */
 
-static int process_stream(FILE *fp, FILE *out)
+/* Run the script over fp, then over each of files in turn (fp may be
+ * NULL). q and Q end the whole stream. */
+static void process_stream(FILE *fp, char **files, int nfiles, FILE *out)
 {
-    static char cur[PAT_SIZE];
-    static char nxt[PAT_SIZE];
-
-    if (!fgets(cur, (int)sizeof(cur), fp)) return 0;
-    int curlen = (int)strlen(cur);
-    if (curlen > 0 && cur[curlen-1] == '\n') cur[--curlen] = '\0';
-    if (curlen > 0 && cur[curlen-1] == '\r') cur[--curlen] = '\0';
-    g_lineno = 1;
-
-    while (1) {
-        char *got = fgets(nxt, (int)sizeof(nxt), fp);
-        g_is_last = (got == NULL);
-        if (got) {
-            int nlen = (int)strlen(nxt);
-            if (nlen > 0 && nxt[nlen-1] == '\n') nxt[--nlen] = '\0';
-            if (nlen > 0 && nxt[nlen-1] == '\r') nxt[--nlen] = '\0';
+    Input in;
+    memset(&in, 0, sizeof(in));
+    in.fp = fp;
+    in.files = files;
+    in.nfiles = nfiles;
+    in.has_next = read_input(&in);
+
+    int quit = 0;
+    int restart = 0;
+    while (!quit) {
+        if (!restart && !next_line(&in, &g_ps, 0)) break;
+        restart = 0;
+
+        int end = exec_script(&in, out);
+        if ((end == CYCLE_END || end == CYCLE_QUIT) && !g_suppress) {
+            fwrite(g_ps.s, 1, (size_t)g_ps.len, out);
+            fputc('\n', out);
         }
-        int quit = process_line(cur, &curlen, out);
-        if (quit || g_is_last) break;
-        memcpy(cur, nxt, (size_t)strlen(nxt) + 1);
-        curlen = (int)strlen(cur);
-        g_lineno++;
+        flush_pending(out);
+        if (end == CYCLE_QUIT || end == CYCLE_QUIT_SILENT) quit = 1;
+        /* D with input left restarts on what remains, without reading */
+        if (end == CYCLE_RESTART) restart = 1;
     }
-    return 0;
+    if (in.own) fclose(in.fp);
+    free(in.next.s);
 }
 
 /* ------------------------------------------------------------------ */
@@ -1073,7 +1367,7 @@ static void process_inplace(const char *path)
 
     for (int i = 0; i < g_ncmds; i++) g_cmds[i].in_range = 0;
     g_lineno = 0;
-    process_stream(fp, tmp);
+    process_stream(fp, NULL, 0, tmp);
     fclose(fp);
     fclose(tmp);
 
@@ -1104,7 +1398,9 @@ static void usage(FILE *out)
         "  --help        print this help and exit\n"
         "  --version     print version and exit\n"
         "\n"
-        "Commands: s/RE/REPL/[gipN]  d  p  q  =  a\\TEXT  i\\TEXT  y/S1/S2/\n"
+        "Commands: s/RE/REPL/[gipN]  d  D  p  P  l  q  Q  =  a\\TEXT  i\\TEXT  c\\TEXT\n"
+        "          y/S1/S2/  n  N  h  H  g  G  x  :LABEL  b[LABEL]  t[LABEL]  T[LABEL]\n"
+        "          r FILE  w FILE  { ... }\n"
         "Addressing: N  $  /regex/  N,M  N,+M  addr!\n"
     );
 }
@@ -1160,22 +1456,15 @@ int main(int argc, char *argv[])
     parse_script(full_script);
     free(full_script);
 
+    buf_set(&g_ps, "", 0);
+    buf_set(&g_hs, "", 0);
+
     if (argi >= argc) {
-        g_lineno = 0;
-        process_stream(stdin, stdout);
+        process_stream(stdin, NULL, 0, stdout);
+    } else if (g_inplace) {
+        for (int i = argi; i < argc; i++) process_inplace(argv[i]);
     } else {
-        for (int i = argi; i < argc; i++) {
-            if (g_inplace) {
-                process_inplace(argv[i]);
-            } else {
-                FILE *fp = fopen(argv[i], "r");
-                if (!fp) { fprintf(stderr, "sed: cannot open '%s': %s\n", argv[i], strerror(errno)); continue; }
-                for (int ci = 0; ci < g_ncmds; ci++) g_cmds[ci].in_range = 0;
-                g_lineno = 0;
-                process_stream(fp, stdout);
-                fclose(fp);
-            }
-        }
+        process_stream(NULL, argv + argi, argc - argi, stdout);
     }
 
     for (int i = 0; i < g_ncmds; i++) {
@@ -1183,11 +1472,22 @@ int main(int argc, char *argv[])
         if (cmd->a1.compiled) regfree(&cmd->a1.re);
         if (cmd->a2.compiled) regfree(&cmd->a2.re);
         if (cmd->s_compiled)  regfree(&cmd->s_re);
+        if (cmd->wfp && cmd->wfp != stdout && cmd->wfp != stderr) {
+            /* shared handles: close only at the first command that owns one */
+            FILE *wfp = cmd->wfp;
+            fclose(wfp);
+            for (int j = i; j < g_ncmds; j++)
+                if (g_cmds[j].wfp == wfp) g_cmds[j].wfp = NULL;
+        }
         free(cmd->s_pat);
         free(cmd->s_repl);
         free(cmd->text);
+        free(cmd->label);
     }
     for (int i = 0; i < g_nscripts; i++) free(g_scripts[i]);
+    free(g_ps.s);
+    free(g_hs.s);
+    free(g_sbuf.s);
 
     return 0;
 }
@@ -1,9 +1,32 @@
+/*
+ * tr — translate, squeeze, or delete characters
+ *
+ * Input is read in 1 MB blocks. Once the tables are built, main picks a
+ * kernel for the whole run: table lookup (or a SIMD add for a single
+ * shifted range such as A-Z -> a-z), delete compaction (SIMD scan when
+ * SET1 is one to three bytes, e.g. -d '\r'), or the general
+ * delete/translate/squeeze loop. Each kernel works in place and the
+ * block is written back with one fwrite.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
 
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define TR_X86 1
+#endif
+
+#define BLOCK_SIZE (1 << 20)
+
 /* ---------------------------------------------------------------
  * SET expansion
  * --------------------------------------------------------------- */
@@ -187,6 +210,213 @@ static bool expand_set_to_bitset(const char *s, bool bitset[256])
     return true;
 }
 
+/* ---------------------------------------------------------------
+ * Block kernels
+ *
+ * Each kernel rewrites buf[0..n) in place and returns the new length.
+ * --------------------------------------------------------------- */
+
+static unsigned char xlat[256];     /* translation table */
+static bool          del_set[256];  /* chars to delete (SET1, possibly complemented) */
+static bool          sq_set[256];   /* chars that trigger squeeze */
+static int           last_out = -1; /* last character written, across blocks */
+
+/* Single shifted range for the SIMD translate: [shift_lo, shift_lo+shift_span] += shift_delta */
+static unsigned char shift_lo, shift_span, shift_delta;
+
+/* Up to three deleted bytes for the SIMD delete scan */
+static unsigned char del_bytes[3];
+static int           del_count;
+
+static size_t translate_scalar(unsigned char *buf, size_t n)
+{
+    for (size_t i = 0; i < n; i++) buf[i] = xlat[buf[i]];
+    return n;
+}
+
+static size_t delete_scalar(unsigned char *buf, size_t n)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = buf[i];
+        buf[j] = c;
+        j += !del_set[c];
+    }
+    return j;
+}
+
+/* General path: delete, then translate, then squeeze. */
+static size_t squeeze_block(unsigned char *buf, size_t n)
+{
+    size_t j = 0;
+    int last = last_out;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = buf[i];
+        if (del_set[c]) continue;
+        c = xlat[c];
+        if (sq_set[c] && (int)c == last) continue;
+        buf[j++] = c;
+        last = c;
+    }
+    last_out = last;
+    return j;
+}
+
+#ifdef TR_X86
+/*
+ * Bytes within [shift_lo, shift_lo+shift_span] get shift_delta added. The
+ * range test biases by 0x80 - lo so a signed compare covers it; callers
+ * guarantee shift_span < 255.
+ */
+static size_t translate_shift_sse2(unsigned char *buf, size_t n)
+{
+    const __m128i bias  = _mm_set1_epi8((char)(0x80 - shift_lo));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + shift_span + 1));
+    const __m128i delta = _mm_set1_epi8((char)shift_delta);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i in = _mm_cmpgt_epi8(limit, _mm_add_epi8(v, bias));
+        v = _mm_add_epi8(v, _mm_and_si128(in, delta));
+        _mm_storeu_si128((__m128i *)(buf + i), v);
+    }
+    translate_scalar(buf + i, n - i);
+    return n;
+}
+
+__attribute__((target("avx2")))
+static size_t translate_shift_avx2(unsigned char *buf, size_t n)
+{
+    const __m256i bias  = _mm256_set1_epi8((char)(0x80 - shift_lo));
+    const __m256i limit = _mm256_set1_epi8((char)(-128 + shift_span + 1));
+    const __m256i delta = _mm256_set1_epi8((char)shift_delta);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i in = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias));
+        v = _mm256_add_epi8(v, _mm256_and_si256(in, delta));
+        _mm256_storeu_si256((__m256i *)(buf + i), v);
+    }
+    translate_scalar(buf + i, n - i);
+    return n;
+}
+
+/*
+ * Compact away del_bytes[]. Chunks without a hit are stored whole; the
+ * store never passes the chunk just loaded, so working in place is safe.
+ */
+static size_t delete_few_sse2(unsigned char *buf, size_t n)
+{
+    const __m128i d0 = _mm_set1_epi8((char)del_bytes[0]);
+    const __m128i d1 = _mm_set1_epi8((char)del_bytes[del_count > 1 ? 1 : 0]);
+    const __m128i d2 = _mm_set1_epi8((char)del_bytes[del_count > 2 ? 2 : 0]);
+    size_t i = 0, j = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, d0),
+                      _mm_or_si128(_mm_cmpeq_epi8(v, d1), _mm_cmpeq_epi8(v, d2)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask == 0) {
+            _mm_storeu_si128((__m128i *)(buf + j), v);
+            j += 16;
+            continue;
+        }
+        unsigned char tmp[16];
+        _mm_storeu_si128((__m128i *)tmp, v);
+        for (int k = 0; k < 16; k++) {
+            buf[j] = tmp[k];
+            j += !((mask >> k) & 1);
+        }
+    }
+    for (; i < n; i++) {
+        unsigned char c = buf[i];
+        buf[j] = c;
+        j += !del_set[c];
+    }
+    return j;
+}
+
+__attribute__((target("avx2")))
+static size_t delete_few_avx2(unsigned char *buf, size_t n)
+{
+    const __m256i d0 = _mm256_set1_epi8((char)del_bytes[0]);
+    const __m256i d1 = _mm256_set1_epi8((char)del_bytes[del_count > 1 ? 1 : 0]);
+    const __m256i d2 = _mm256_set1_epi8((char)del_bytes[del_count > 2 ? 2 : 0]);
+    size_t i = 0, j = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, d0),
+                      _mm256_or_si256(_mm256_cmpeq_epi8(v, d1), _mm256_cmpeq_epi8(v, d2)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask == 0) {
+            _mm256_storeu_si256((__m256i *)(buf + j), v);
+            j += 32;
+            continue;
+        }
+        unsigned char tmp[32];
+        _mm256_storeu_si256((__m256i *)tmp, v);
+        for (int k = 0; k < 32; k++) {
+            buf[j] = tmp[k];
+            j += !((mask >> k) & 1);
+        }
+    }
+    for (; i < n; i++) {
+        unsigned char c = buf[i];
+        buf[j] = c;
+        j += !del_set[c];
+    }
+    return j;
+}
+#endif
+
+/*
+ * Pick the kernel for this run. Translate-only and delete-only runs get
+ * their own kernels; anything involving -s goes through squeeze_block.
+ */
+static size_t (*select_kernel(bool opt_delete, bool opt_squeeze))(unsigned char *, size_t)
+{
+    if (opt_squeeze) return squeeze_block;
+
+#ifdef TR_X86
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+
+    if (opt_delete) {
+        del_count = 0;
+        for (int c = 0; c < 256; c++) {
+            if (!del_set[c]) continue;
+            if (del_count == 3) { del_count = 4; break; }
+            del_bytes[del_count++] = (unsigned char)c;
+        }
+#ifdef TR_X86
+        if (del_count >= 1 && del_count <= 3)
+            return avx2 ? delete_few_avx2 : delete_few_sse2;
+#endif
+        return delete_scalar;
+    }
+
+    /* Look for a single run of bytes that all move by the same amount. */
+    int lo = -1, hi = -1;
+    for (int c = 0; c < 256; c++) {
+        if (xlat[c] == c) continue;
+        if (lo < 0) lo = c;
+        else if (hi != c - 1 ||
+                 (unsigned char)(xlat[c] - c) != (unsigned char)(xlat[lo] - lo))
+            return translate_scalar;
+        hi = c;
+    }
+    if (lo < 0 || hi - lo >= 255) return translate_scalar;
+    shift_lo    = (unsigned char)lo;
+    shift_span  = (unsigned char)(hi - lo);
+    shift_delta = (unsigned char)(xlat[lo] - lo);
+#ifdef TR_X86
+    return avx2 ? translate_shift_avx2 : translate_shift_sse2;
+#else
+    return translate_scalar;
+#endif
+}
+
 /* ---------------------------------------------------------------
  * Helpers
  * --------------------------------------------------------------- */
@@ -283,16 +513,7 @@ int main(int argc, char *argv[])
      * Build working tables
      * --------------------------------------------------------------- */
 
-    /* del_set: chars to delete (SET1, possibly complemented) */
-    bool del_set[256];
-    memset(del_set, 0, sizeof(del_set));
-
-    /* sq_set: chars that trigger squeeze */
-    bool sq_set[256];
-    memset(sq_set, 0, sizeof(sq_set));
-
-    /* xlat[]: translation table */
-    unsigned char xlat[256];
+    /* del_set, sq_set and xlat are file-scope; set up the identity map */
     for (int i = 0; i < 256; i++) xlat[i] = (unsigned char)i;
 
     if (opt_delete) {
@@ -370,24 +591,39 @@ int main(int argc, char *argv[])
     /* ---------------------------------------------------------------
      * Main processing loop
      * --------------------------------------------------------------- */
-    int c;
-    int last_out = -1;  /* last character written (for squeeze) */
-
-    while ((c = getchar()) != EOF) {
-        unsigned char uc = (unsigned char)c;
-
-        /* Step 1: delete */
-        if (opt_delete && del_set[uc]) continue;
+#ifdef _WIN32
+    /* Binary on both ends, so \r survives to be deleted or translated */
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
 
-        /* Step 2: translate */
-        unsigned char out_c = xlat[uc];
+    size_t (*kernel)(unsigned char *, size_t) = select_kernel(opt_delete, opt_squeeze);
 
-        /* Step 3: squeeze */
-        if (opt_squeeze && sq_set[out_c] && (int)out_c == last_out) continue;
+    unsigned char *buf = malloc(BLOCK_SIZE);
+    if (!buf) {
+        fprintf(stderr, "tr: out of memory\n");
+        return 1;
+    }
 
-        putchar((int)out_c);
-        last_out = (int)out_c;
+    int status = 0;
+    size_t n;
+    while ((n = fread(buf, 1, BLOCK_SIZE, stdin)) > 0) {
+        size_t m = kernel(buf, n);
+        if (m > 0 && fwrite(buf, 1, m, stdout) != m) {
+            fprintf(stderr, "tr: write error\n");
+            status = 1;
+            break;
+        }
+    }
+    if (status == 0 && ferror(stdin)) {
+        fprintf(stderr, "tr: read error\n");
+        status = 1;
+    }
+    if (fflush(stdout) != 0 && status == 0) {
+        fprintf(stderr, "tr: write error\n");
+        status = 1;
     }
 
-    return 0;
+    free(buf);
+    return status;
 }
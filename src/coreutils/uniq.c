@@ -1,97 +1,675 @@
+/*
+ * uniq — report or omit repeated lines
+ *
+ * Input is read in 1 MB blocks into one of two buffers. Lines are handed
+ * out as pointers into the current buffer, and the first line of the
+ * running group is kept by reference: it is only copied out when a refill
+ * is about to overwrite the buffer it lives in, which needs a whole block
+ * of duplicates. Lines have no length limit.
+ *
+ * Comparison looks at the key (after -f/-s, limited by -w): lengths
+ * first, then a word-at-a-time hash cached for the group's first line,
+ * then the bytes.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#define BLOCK_SIZE (1 << 20)
 
 static int opt_count = 0;   /* -c: prefix lines with occurrence count */
 static int opt_dup   = 0;   /* -d: only print duplicate lines */
 static int opt_uniq  = 0;   /* -u: only print non-duplicate lines */
+static int opt_icase = 0;   /* -i: compare case-insensitively */
+static int opt_hash  = 0;   /* --unsorted: count all lines, not just adjacent ones */
+
+static long   skip_fields = 0;    /* -f N */
+static long   skip_chars  = 0;    /* -s N */
+static long   check_chars = -1;   /* -w N; -1 means the whole line */
+static char   line_end    = '\n'; /* '\0' with -z */
+
+static unsigned char fold[256];
+
+typedef struct {
+    const char *s;      /* line without its terminator */
+    size_t      len;
+    const char *key;    /* part of s that is compared */
+    size_t      klen;
+    uint64_t    hash;
+    bool        hashed;
+} Line;
+
+typedef struct {
+    FILE   *fp;
+    char   *buf[2];
+    size_t  cap[2];
+    int     cur;
+    size_t  pos, end;
+    bool    eof;
+    bool    err;
+} Reader;
+
+/* Copy of a kept line whose buffer is about to be reused */
+static char  *saved     = NULL;
+static size_t saved_cap = 0;
+
+/* ── Keys ─────────────────────────────────────────────────────────────── */
+
+static void make_key(Line *ln) {
+    const char *p = ln->s, *e = ln->s + ln->len;
+    if (line_end == '\n' && e > p && e[-1] == '\r') e--;   /* CRLF input */
+
+    for (long n = skip_fields; n > 0 && p < e; n--) {
+        while (p < e && (*p == ' ' || *p == '\t')) p++;
+        while (p < e && *p != ' ' && *p != '\t') p++;
+    }
+    size_t s = (size_t)skip_chars;
+    p += s < (size_t)(e - p) ? s : (size_t)(e - p);
+    if (check_chars >= 0 && (size_t)(e - p) > (size_t)check_chars)
+        e = p + check_chars;
+
+    ln->key    = p;
+    ln->klen   = (size_t)(e - p);
+    ln->hashed = false;
+}
+
+/* 64-bit hash of a key, eight bytes per step; folded with -i. */
+static uint64_t key_hash(const char *s, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+    unsigned char w8[8];
+    uint64_t w;
+    while (n >= 8) {
+        if (opt_icase) {
+            for (int i = 0; i < 8; i++) w8[i] = fold[(unsigned char)s[i]];
+            memcpy(&w, w8, 8);
+        } else {
+            memcpy(&w, s, 8);
+        }
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        s += 8;
+        n -= 8;
+    }
+    memset(w8, 0, sizeof(w8));
+    for (size_t i = 0; i < n; i++)
+        w8[i] = opt_icase ? fold[(unsigned char)s[i]] : (unsigned char)s[i];
+    memcpy(&w, w8, 8);
+    h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 29);
+}
+
+static uint64_t line_hash(Line *ln) {
+    if (!ln->hashed) {
+        ln->hash   = key_hash(ln->key, ln->klen);
+        ln->hashed = true;
+    }
+    return ln->hash;
+}
+
+static bool key_equal(const char *a, const char *b, size_t n) {
+    if (!opt_icase) return memcmp(a, b, n) == 0;
+    for (size_t i = 0; i < n; i++)
+        if (fold[(unsigned char)a[i]] != fold[(unsigned char)b[i]])
+            return false;
+    return true;
+}
+
+static bool same_key(Line *a, Line *b) {
+    if (a->klen != b->klen) return false;
+    if (line_hash(a) != line_hash(b)) return false;
+    return key_equal(a->key, b->key, a->klen);
+}
+
+/* ── Reading ──────────────────────────────────────────────────────────── */
+
+static bool reserve(char **buf, size_t *cap, size_t need) {
+    if (*cap >= need) return true;
+    size_t ncap = *cap ? *cap : BLOCK_SIZE;
+    while (ncap < need) ncap *= 2;
+    char *nb = realloc(*buf, ncap);
+    if (!nb) return false;
+    *buf = nb;
+    *cap = ncap;
+    return true;
+}
+
+/* Move a kept line into `saved` so its buffer can be refilled. */
+static bool save_line(Line *ln) {
+    if (!reserve(&saved, &saved_cap, ln->len + 1)) return false;
+    size_t koff = (size_t)(ln->key - ln->s);
+    memmove(saved, ln->s, ln->len);
+    ln->s   = saved;
+    ln->key = saved + koff;
+    return true;
+}
+
+/*
+ * Return the next line in *ln. The returned pointers stay valid until the
+ * buffer is refilled; `keep` (may be NULL) is preserved across refills.
+ */
+static bool next_line(Reader *r, Line *ln, Line *keep) {
+    for (;;) {
+        char *b = r->buf[r->cur];
+        char *nl = r->pos < r->end ? memchr(b + r->pos, line_end, r->end - r->pos) : NULL;
+        if (nl) {
+            ln->s   = b + r->pos;
+            ln->len = (size_t)(nl - ln->s);
+            r->pos  = (size_t)(nl - b) + 1;
+            make_key(ln);
+            return true;
+        }
+        if (r->eof) {
+            if (r->pos == r->end) return false;
+            ln->s   = b + r->pos;         /* last line has no terminator */
+            ln->len = r->end - r->pos;
+            r->pos  = r->end;
+            make_key(ln);
+            return true;
+        }
+
+        size_t tail = r->end - r->pos;
+        if (r->pos == 0 && tail > 0) {
+            /* One line fills the buffer: grow it in place */
+            if (!reserve(&r->buf[r->cur], &r->cap[r->cur], tail + BLOCK_SIZE)) goto oom;
+        } else {
+            int o = 1 - r->cur;
+            char *ob = r->buf[o];
+            if (keep && ob && keep->s >= ob && keep->s < ob + r->cap[o] && !save_line(keep))
+                goto oom;
+            if (!reserve(&r->buf[o], &r->cap[o], tail + BLOCK_SIZE)) goto oom;
+            memcpy(r->buf[o], b + r->pos, tail);
+            r->cur = o;
+            r->pos = 0;
+            r->end = tail;
+        }
+        size_t n = fread(r->buf[r->cur] + r->end, 1, BLOCK_SIZE, r->fp);
+        r->end += n;
+        if (n == 0) {
+            r->eof = true;
+            if (ferror(r->fp)) r->err = true;
+        }
+    }
+oom:
+    fprintf(stderr, "uniq: out of memory\n");
+    exit(1);
+}
+
+/* ── Output ───────────────────────────────────────────────────────────── */
+
+static bool wanted(uint64_t count) {
+    return !(opt_dup && count < 2) && !(opt_uniq && count != 1);
+}
+
+static void emit(FILE *out, const Line *ln, unsigned long long count) {
+    if (!wanted(count)) return;
+    if (opt_count) fprintf(out, "%7llu ", count);
+    fwrite(ln->s, 1, ln->len, out);
+    putc(line_end, out);
+}
+
+/* ── Unsorted mode ────────────────────────────────────────────────────── */
+
+/*
+ * --unsorted counts every distinct key in an open-addressing table and
+ * prints the groups in first-seen order. Line bytes live in an arena.
+ * Past the memory budget the table and all further lines are written to
+ * SPILL_PARTS temporary files by hash; each partition is then counted on
+ * its own, sorted back into first-seen order, and the partitions merged.
+ */
+
+#define SPILL_PARTS 64
+#define ARENA_CHUNK (1 << 20)
+
+typedef struct {
+    uint64_t    hash;
+    uint64_t    count;
+    uint64_t    seq;        /* line number of the first occurrence */
+    const char *s;
+    size_t      len;
+    size_t      koff, klen;
+} Entry;
+
+/* Spill record header; the line bytes follow */
+typedef struct {
+    uint64_t seq;
+    uint64_t count;
+    uint64_t len;
+} Record;
+
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t        used, cap;
+    char          data[];
+} Chunk;
+
+typedef struct {
+    Entry    *entries;      /* first-seen order */
+    size_t    n, cap;
+    uint32_t *slots;        /* entry index + 1, 0 = empty */
+    size_t    nslots;       /* power of two */
+    Chunk    *arena;
+    size_t    bytes;        /* memory charged against the budget */
+} Table;
+
+static unsigned long long mem_budget = 256ULL << 20;   /* --memory */
+
+static void *xrealloc(void *p, size_t n) {
+    void *q = realloc(p, n);
+    if (!q) {
+        fprintf(stderr, "uniq: out of memory\n");
+        exit(1);
+    }
+    return q;
+}
+
+static char *arena_copy(Table *t, const char *s, size_t len) {
+    Chunk *c = t->arena;
+    if (!c || c->cap - c->used < len) {
+        size_t cap = len > ARENA_CHUNK ? len : ARENA_CHUNK;
+        c = xrealloc(NULL, sizeof(Chunk) + cap);
+        c->next = t->arena;
+        c->used = 0;
+        c->cap  = cap;
+        t->arena = c;
+        t->bytes += sizeof(Chunk) + cap;
+    }
+    char *p = c->data + c->used;
+    memcpy(p, s, len);
+    c->used += len;
+    return p;
+}
+
+static void table_reset(Table *t) {
+    while (t->arena) {
+        Chunk *next = t->arena->next;
+        free(t->arena);
+        t->arena = next;
+    }
+    free(t->entries);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+static void table_grow(Table *t) {
+    size_t nslots = t->nslots ? t->nslots * 2 : 1024;
+    uint32_t *slots = xrealloc(NULL, nslots * sizeof(uint32_t));
+    memset(slots, 0, nslots * sizeof(uint32_t));
+    for (size_t i = 0; i < t->n; i++) {
+        size_t j = (size_t)t->entries[i].hash & (nslots - 1);
+        while (slots[j]) j = (j + 1) & (nslots - 1);
+        slots[j] = (uint32_t)(i + 1);
+    }
+    t->bytes += (nslots - t->nslots) * sizeof(uint32_t);
+    free(t->slots);
+    t->slots  = slots;
+    t->nslots = nslots;
+}
+
+/* Count one occurrence (or `count` of them) of ln; returns its entry. */
+static Entry *table_add(Table *t, Line *ln, uint64_t seq, uint64_t count) {
+    if (2 * (t->n + 1) > t->nslots) table_grow(t);
+    uint64_t h = line_hash(ln);
+    size_t j = (size_t)h & (t->nslots - 1);
+    while (t->slots[j]) {
+        Entry *e = &t->entries[t->slots[j] - 1];
+        if (e->hash == h && e->klen == ln->klen && key_equal(e->s + e->koff, ln->key, ln->klen)) {
+            e->count += count;
+            if (seq < e->seq) e->seq = seq;
+            return e;
+        }
+        j = (j + 1) & (t->nslots - 1);
+    }
+    if (t->n == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 1024;
+        t->entries = xrealloc(t->entries, cap * sizeof(Entry));
+        t->bytes += (cap - t->cap) * sizeof(Entry);
+        t->cap = cap;
+    }
+    Entry *e = &t->entries[t->n];
+    e->hash  = h;
+    e->count = count;
+    e->seq   = seq;
+    e->s     = arena_copy(t, ln->s, ln->len);
+    e->len   = ln->len;
+    e->koff  = (size_t)(ln->key - ln->s);
+    e->klen  = ln->klen;
+    t->slots[j] = (uint32_t)(++t->n);
+    return e;
+}
+
+static void entry_line(const Entry *e, Line *ln) {
+    ln->s    = e->s;
+    ln->len  = e->len;
+    ln->key  = e->s + e->koff;
+    ln->klen = e->klen;
+}
+
+static void spill_fail(void) {
+    fprintf(stderr, "uniq: cannot write temporary file\n");
+    exit(1);
+}
+
+static FILE *spill_open(void) {
+#ifdef _WIN32
+    /* tmpfile() wants to write to the drive root; use %TEMP% instead */
+    char dir[MAX_PATH], path[MAX_PATH];
+    if (!GetTempPathA(MAX_PATH, dir) || !GetTempFileNameA(dir, "unq", 0, path)) spill_fail();
+    FILE *f = fopen(path, "w+bD");   /* D: delete on close */
+#else
+    FILE *f = tmpfile();
+#endif
+    if (!f) spill_fail();
+    return f;
+}
+
+static void spill_write(FILE *f, uint64_t seq, uint64_t count, const char *s, size_t len) {
+    Record rec = { seq, count, len };
+    if (fwrite(&rec, sizeof(rec), 1, f) != 1 || fwrite(s, 1, len, f) != len) spill_fail();
+}
+
+/* Read one record into a Line backed by *buf. */
+static bool spill_read(FILE *f, Record *rec, char **buf, size_t *cap, Line *ln) {
+    if (fread(rec, sizeof(*rec), 1, f) != 1) return false;
+    if (!reserve(buf, cap, (size_t)rec->len + 1)) {
+        fprintf(stderr, "uniq: out of memory\n");
+        exit(1);
+    }
+    if (fread(*buf, 1, (size_t)rec->len, f) != rec->len) spill_fail();
+    ln->s   = *buf;
+    ln->len = (size_t)rec->len;
+    make_key(ln);
+    return true;
+}
+
+static int by_seq(const void *a, const void *b) {
+    uint64_t x = ((const Entry *)a)->seq, y = ((const Entry *)b)->seq;
+    return x < y ? -1 : x > y;
+}
+
+/* Count each partition, then merge their groups by first-seen line number. */
+static void merge_partitions(FILE **part, FILE *out) {
+    Table t;
+    memset(&t, 0, sizeof(t));
+    char  *buf = NULL;
+    size_t cap = 0;
+    Record rec;
+    Line   ln;
+
+    for (int p = 0; p < SPILL_PARTS; p++) {
+        rewind(part[p]);
+        while (spill_read(part[p], &rec, &buf, &cap, &ln)) {
+            ln.hashed = false;
+            table_add(&t, &ln, rec.seq, rec.count);
+        }
+        qsort(t.entries, t.n, sizeof(Entry), by_seq);
+        FILE *res = spill_open();
+        for (size_t i = 0; i < t.n; i++)
+            if (wanted(t.entries[i].count))
+                spill_write(res, t.entries[i].seq, t.entries[i].count, t.entries[i].s, t.entries[i].len);
+        fclose(part[p]);
+        rewind(res);
+        part[p] = res;
+        table_reset(&t);
+    }
+
+    /* SPILL_PARTS-way merge on seq */
+    Record head[SPILL_PARTS];
+    char  *hbuf[SPILL_PARTS] = {0};
+    size_t hcap[SPILL_PARTS] = {0};
+    Line   hline[SPILL_PARTS];
+    bool   live[SPILL_PARTS];
+    for (int p = 0; p < SPILL_PARTS; p++)
+        live[p] = spill_read(part[p], &head[p], &hbuf[p], &hcap[p], &hline[p]);
+    for (;;) {
+        int best = -1;
+        for (int p = 0; p < SPILL_PARTS; p++)
+            if (live[p] && (best < 0 || head[p].seq < head[best].seq)) best = p;
+        if (best < 0) break;
+        emit(out, &hline[best], (unsigned long long)head[best].count);
+        live[best] = spill_read(part[best], &head[best], &hbuf[best], &hcap[best], &hline[best]);
+    }
+    for (int p = 0; p < SPILL_PARTS; p++) {
+        fclose(part[p]);
+        free(hbuf[p]);
+    }
+    free(buf);
+}
+
+static void unsorted_uniq(Reader *r, FILE *out) {
+    Table t;
+    memset(&t, 0, sizeof(t));
+    FILE *part[SPILL_PARTS];
+    bool spilled = false;
+    uint64_t seq = 0;
+    Line ln;
+
+    while (next_line(r, &ln, NULL)) {
+        if (!spilled) {
+            table_add(&t, &ln, seq++, 1);
+            if (t.bytes <= mem_budget) continue;
+            /* Over budget: move the table out and partition from here on */
+            for (int p = 0; p < SPILL_PARTS; p++) part[p] = spill_open();
+            for (size_t i = 0; i < t.n; i++) {
+                Entry *e = &t.entries[i];
+                spill_write(part[e->hash >> 58], e->seq, e->count, e->s, e->len);
+            }
+            table_reset(&t);
+            spilled = true;
+            continue;
+        }
+        spill_write(part[line_hash(&ln) >> 58], seq++, 1, ln.s, ln.len);
+    }
+
+    if (spilled) {
+        merge_partitions(part, out);
+        return;
+    }
+    for (size_t i = 0; i < t.n; i++) {
+        Line el;
+        entry_line(&t.entries[i], &el);
+        emit(out, &el, (unsigned long long)t.entries[i].count);
+    }
+    table_reset(&t);
+}
+
+/* ── Options ──────────────────────────────────────────────────────────── */
+
+/* SIZE for --memory: a byte count with an optional K, M or G suffix. */
+static bool parse_size(const char *s, unsigned long long *out) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (end == s) goto bad;
+    switch (*end) {
+        case 'k': case 'K': v <<= 10; end++; break;
+        case 'm': case 'M': v <<= 20; end++; break;
+        case 'g': case 'G': v <<= 30; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || v == 0) goto bad;
+    *out = v;
+    return true;
+bad:
+    fprintf(stderr, "uniq: invalid memory size: '%s'\n", s);
+    return false;
+}
+
+static bool parse_num(const char *s, long *out, const char *what) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (*s == '\0' || *end != '\0' || v < 0) {
+        fprintf(stderr, "uniq: invalid number of %s: '%s'\n", what, s);
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static void usage(void) {
+    puts("Usage: uniq [OPTION]... [INPUT [OUTPUT]]");
+    puts("Filter adjacent matching lines from INPUT (or stdin), writing to OUTPUT");
+    puts("(or stdout).  With no options, matching lines are merged to the first.");
+    puts("");
+    puts("  -c, --count           prefix lines by the number of occurrences");
+    puts("  -d, --repeated        only print duplicate lines, one for each group");
+    puts("  -u, --unique          only print unique lines");
+    puts("  -i, --ignore-case     ignore differences in case when comparing");
+    puts("  -f, --skip-fields=N   avoid comparing the first N fields");
+    puts("  -s, --skip-chars=N    avoid comparing the first N characters");
+    puts("  -w, --check-chars=N   compare no more than N characters in lines");
+    puts("  -z, --zero-terminated line delimiter is NUL, not newline");
+    puts("      --unsorted, --hash  merge matching lines anywhere in the input,");
+    puts("                          printing groups in first-seen order");
+    puts("      --memory=SIZE     table size before --unsorted spills to temporary");
+    puts("                        files (default 256M; K, M, G suffixes)");
+    puts("  -h, --help   display this help and exit");
+    puts("      --version  output version information and exit");
+    puts("");
+    puts("Fields are runs of blanks followed by non-blanks; fields are skipped");
+    puts("before characters.");
+}
 
 int main(int argc, char *argv[]) {
     int argi = 1;
     while (argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0') {
-        if (strcmp(argv[argi], "--help") == 0 || strcmp(argv[argi], "-h") == 0) {
-            puts("Usage: uniq [OPTION]... [INPUT [OUTPUT]]");
-            puts("Filter adjacent matching lines from INPUT (or stdin), writing to OUTPUT");
-            puts("(or stdout).  With no options, matching lines are merged to the first.");
-            puts("");
-            puts("  -c         prefix lines by the number of occurrences");
-            puts("  -d         only print duplicate lines, one for each group");
-            puts("  -u         only print unique lines");
-            puts("  -h, --help   display this help and exit");
-            puts("      --version  output version information and exit");
-            return 0;
+        const char *arg = argv[argi];
+        if (strcmp(arg, "--") == 0) { argi++; break; }
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) { usage(); return 0; }
+        if (strcmp(arg, "--version") == 0) { puts("uniq 1.0 (Winix)"); return 0; }
+
+        if (arg[1] == '-') {
+            const char *eq = strchr(arg, '=');
+            size_t nlen = eq ? (size_t)(eq - arg) : strlen(arg);
+            const char *val = eq ? eq + 1 : NULL;
+            long *num = NULL;
+            const char *what = NULL;
+            if      (strcmp(arg, "--count") == 0)           opt_count = 1;
+            else if (strcmp(arg, "--repeated") == 0)        opt_dup   = 1;
+            else if (strcmp(arg, "--unique") == 0)          opt_uniq  = 1;
+            else if (strcmp(arg, "--ignore-case") == 0)     opt_icase = 1;
+            else if (strcmp(arg, "--zero-terminated") == 0) line_end  = '\0';
+            else if (strcmp(arg, "--unsorted") == 0 ||
+                     strcmp(arg, "--hash") == 0)            opt_hash  = 1;
+            else if (strncmp(arg, "--memory=", 9) == 0) {
+                if (!parse_size(arg + 9, &mem_budget)) return 1;
+            }
+            else if (nlen == 13 && strncmp(arg, "--skip-fields", nlen) == 0) { num = &skip_fields; what = "fields to skip"; }
+            else if (nlen == 12 && strncmp(arg, "--skip-chars", nlen) == 0)  { num = &skip_chars;  what = "bytes to skip"; }
+            else if (nlen == 13 && strncmp(arg, "--check-chars", nlen) == 0) { num = &check_chars; what = "bytes to compare"; }
+            else {
+                fprintf(stderr, "uniq: unrecognized option '%s'\n", arg);
+                return 1;
+            }
+            if (num) {
+                if (!val) {
+                    if (argi + 1 >= argc) {
+                        fprintf(stderr, "uniq: option '%.*s' requires an argument\n", (int)nlen, arg);
+                        return 1;
+                    }
+                    val = argv[++argi];
+                }
+                if (!parse_num(val, num, what)) return 1;
+            }
+            argi++;
+            continue;
         }
-        if (strcmp(argv[argi], "--version") == 0) { puts("uniq 1.0 (Winix)"); return 0; }
-        for (const char *p = argv[argi] + 1; *p; p++) {
+
+        for (const char *p = arg + 1; *p; p++) {
+            long *num = NULL;
+            const char *what = NULL;
             if      (*p == 'c') opt_count = 1;
             else if (*p == 'd') opt_dup   = 1;
             else if (*p == 'u') opt_uniq  = 1;
+            else if (*p == 'i') opt_icase = 1;
+            else if (*p == 'z') line_end  = '\0';
+            else if (*p == 'f') { num = &skip_fields; what = "fields to skip"; }
+            else if (*p == 's') { num = &skip_chars;  what = "bytes to skip"; }
+            else if (*p == 'w') { num = &check_chars; what = "bytes to compare"; }
             else {
                 fprintf(stderr, "uniq: invalid option -- '%c'\n", *p);
                 return 1;
             }
+            if (num) {
+                /* -f2 or -f 2 */
+                const char *val = p[1] ? p + 1 : (argi + 1 < argc ? argv[++argi] : NULL);
+                if (!val) {
+                    fprintf(stderr, "uniq: option requires an argument -- '%c'\n", *p);
+                    return 1;
+                }
+                if (!parse_num(val, num, what)) return 1;
+                break;
+            }
         }
         argi++;
     }
 
+    for (int i = 0; i < 256; i++) fold[i] = (unsigned char)tolower(i);
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
     FILE *in  = stdin;
     FILE *out = stdout;
 
-    if (argi < argc) {
-        in = fopen(argv[argi++], "r");
+    if (argi < argc && strcmp(argv[argi], "-") != 0) {
+        in = fopen(argv[argi], "rb");
         if (!in) { perror("uniq"); return 1; }
     }
+    if (argi < argc) argi++;
     if (argi < argc) {
-        out = fopen(argv[argi], "w");
-        if (!out) { perror("uniq"); fclose(in); return 1; }
+        out = fopen(argv[argi], "wb");
+        if (!out) { perror("uniq"); if (in != stdin) fclose(in); return 1; }
     }
 
-    char prev[4096] = "";
-    char line[4096];
-    int  count = 0;
-    int  have_prev = 0;
+    Reader r;
+    memset(&r, 0, sizeof(r));
+    r.fp = in;
 
-    while (fgets(line, sizeof(line), in)) {
-        /* Strip trailing newline for comparison */
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') line[--len] = '\0';
+    Line prev, line;
+    unsigned long long count = 0;
 
-        if (have_prev && strcmp(line, prev) == 0) {
-            count++;
-        } else {
-            /* Flush previous group */
-            if (have_prev) {
-                int emit = (!opt_dup && !opt_uniq)
-                           || (opt_dup  && count > 1)
-                           || (opt_uniq && count == 1);
-                if (emit) {
-                    if (opt_count)
-                        fprintf(out, "%7d %s\n", count, prev);
-                    else
-                        fprintf(out, "%s\n", prev);
-                }
+    if (opt_hash) {
+        unsorted_uniq(&r, out);
+    } else if (next_line(&r, &prev, NULL)) {
+        count = 1;
+        while (next_line(&r, &line, &prev)) {
+            if (same_key(&prev, &line)) {
+                count++;
+            } else {
+                emit(out, &prev, count);
+                prev  = line;
+                count = 1;
             }
-            strncpy(prev, line, sizeof(prev) - 1);
-            prev[sizeof(prev) - 1] = '\0';
-            count = 1;
-            have_prev = 1;
         }
+        emit(out, &prev, count);
     }
 
-    /* Flush last group */
-    if (have_prev) {
-        int emit = (!opt_dup && !opt_uniq)
-                   || (opt_dup  && count > 1)
-                   || (opt_uniq && count == 1);
-        if (emit) {
-            if (opt_count)
-                fprintf(out, "%7d %s\n", count, prev);
-            else
-                fprintf(out, "%s\n", prev);
-        }
+    int status = 0;
+    if (r.err) {
+        fprintf(stderr, "uniq: read error\n");
+        status = 1;
+    }
+    if (fflush(out) != 0 || ferror(out)) {
+        fprintf(stderr, "uniq: write error\n");
+        status = 1;
     }
 
+    free(r.buf[0]);
+    free(r.buf[1]);
+    free(saved);
     if (in  != stdin)  fclose(in);
     if (out != stdout) fclose(out);
-    return 0;
+    return status;
 }
@@ -1,101 +1,576 @@
+/*
+ * wc — print newline, word, character and byte counts
+ *
+ * Input is read in 1 MB blocks and counted by SIMD kernels (SSE2, or AVX2
+ * when the CPU has it) into 64-bit counters. A plain -c on a regular file
+ * is answered from fstat without reading the data.
+ *
+ * --parallel counts files on a thread pool in batches; each batch is
+ * printed in argument order once all of its files are counted.
+ * --files0-from streams a NUL-separated name list (find -print0).
+ */
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
-#include <ctype.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <sys/stat.h>
+#include "threads.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+/* MinGW's plain struct stat has a 32-bit st_size */
+typedef struct _stat64 wc_stat_t;
+#define wc_fstat(fd, st) _fstat64((fd), (st))
+#define wc_lseek _lseeki64
+#else
+#include <unistd.h>
+typedef struct stat wc_stat_t;
+#define wc_fstat(fd, st) fstat((fd), (st))
+#define wc_lseek lseek
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define WC_X86 1
+#endif
+
+#define BLOCK_SIZE  (1 << 20)
+#define BATCH_SIZE  4096
+
+typedef struct {
+    uint64_t lines, words, chars, bytes, maxlen;
+} Counts;
+
+typedef struct {
+    const char *name;     /* "-" is standard input */
+    Counts      c;
+    int         opened;
+    int         err;      /* errno of a failed open or read, else 0 */
+} Job;
+
+static bool show_l = false, show_w = false, show_m = false;
+static bool show_c = false, show_L = false;
+static bool bytes_only = false;
+
+/* ── Scalar kernels (reference, and for block tails) ──────────────────── */
+
+/* isspace() in the C locale: \t \n \v \f \r and space */
+static int is_ws(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= 4;
+}
+
+static void count_lines_scalar(const unsigned char *p, size_t n, Counts *c) {
+    const unsigned char *end = p + n;
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        c->lines++;
+        p++;
+    }
+}
+
+/* -m counts UTF-8 characters: every byte that is not a continuation byte */
+static void count_chars_scalar(const unsigned char *p, size_t n, Counts *c) {
+    for (size_t i = 0; i < n; i++)
+        c->chars += ((p[i] & 0xC0) != 0x80);
+}
+
+/* -L: tabs advance to the next multiple of 8; \n, \r and \f end a line;
+ * other control bytes have no width. *linepos carries across blocks. */
+static void count_maxlen(const unsigned char *p, size_t n, Counts *c, uint64_t *linepos) {
+    uint64_t pos = *linepos, max = c->maxlen;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char b = p[i];
+        if (b == '\n' || b == '\r' || b == '\f') {
+            if (pos > max) max = pos;
+            pos = 0;
+        } else if (b == '\t') {
+            pos += 8 - pos % 8;
+        } else if (b >= 0x20 && b != 0x7F && (b & 0xC0) != 0x80) {
+            pos++;
+        }
+    }
+    *linepos = pos;
+    c->maxlen = max;
+}
+
+/* *prev_ws carries "previous byte was white space" across blocks; a word
+ * starts at every non-space byte that follows a space byte. */
+static void count_words_scalar(const unsigned char *p, size_t n, Counts *c, int *prev_ws) {
+    int prev = *prev_ws;
+    for (size_t i = 0; i < n; i++) {
+        int ws = is_ws(p[i]);
+        c->lines += (p[i] == '\n');
+        c->words += (uint64_t)(prev & !ws);
+        prev = ws;
+    }
+    *prev_ws = prev;
+}
+
+/* ── SSE2 kernels (baseline on x86-64) ────────────────────────────────── */
+
+#if defined(WC_X86) && defined(__SSE2__)
+/* Newline hits are summed in byte lanes and flushed with SAD every 255
+ * iterations, before any lane can wrap. */
+static void count_lines_sse2(const unsigned char *p, size_t n, Counts *c) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i acc = _mm_setzero_si128();
+        for (int k = 0; k < 255 && i + 16 <= n; k++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, nl));
+        }
+        __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        c->lines += (uint64_t)_mm_cvtsi128_si32(sum)
+                  + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    }
+    count_lines_scalar(p + i, n - i, c);
+}
+
+static void count_chars_sse2(const unsigned char *p, size_t n, Counts *c) {
+    const __m128i lim = _mm_set1_epi8(-65);   /* 0x80..0xBF are <= -65 signed */
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i acc = _mm_setzero_si128();
+        for (int k = 0; k < 255 && i + 16 <= n; k++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(v, lim));
+        }
+        __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        c->chars += (uint64_t)_mm_cvtsi128_si32(sum)
+                  + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    }
+    count_chars_scalar(p + i, n - i, c);
+}
+
+static void count_words_sse2(const unsigned char *p, size_t n, Counts *c, int *prev_ws) {
+    const __m128i nl    = _mm_set1_epi8('\n');
+    const __m128i sp    = _mm_set1_epi8(' ');
+    const __m128i tab   = _mm_set1_epi8('\t');
+    const __m128i four  = _mm_set1_epi8(4);
+    uint32_t prev = (uint32_t)*prev_ws;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v   = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i t   = _mm_sub_epi8(v, tab);
+        __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, four), t);
+        uint32_t ws = (uint32_t)_mm_movemask_epi8(_mm_or_si128(ctl, _mm_cmpeq_epi8(v, sp)));
+        uint32_t starts = ~ws & ((ws << 1) | prev) & 0xFFFFu;
+        c->words += (uint64_t)__builtin_popcount(starts);
+        c->lines += (uint64_t)__builtin_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+        prev = (ws >> 15) & 1u;
+    }
+    int tail_prev = (int)prev;
+    count_words_scalar(p + i, n - i, c, &tail_prev);
+    *prev_ws = tail_prev;
+}
+#endif
+
+/* ── AVX2 kernels (selected at runtime) ───────────────────────────────── */
+
+#ifdef WC_X86
+__attribute__((target("avx2")))
+static void count_lines_avx2(const unsigned char *p, size_t n, Counts *c) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    while (i + 32 <= n) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int k = 0; k < 255 && i + 32 <= n; k++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, nl));
+        }
+        __m256i sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        c->lines += (uint64_t)_mm256_extract_epi64(sum, 0) + (uint64_t)_mm256_extract_epi64(sum, 1)
+                  + (uint64_t)_mm256_extract_epi64(sum, 2) + (uint64_t)_mm256_extract_epi64(sum, 3);
+    }
+    count_lines_scalar(p + i, n - i, c);
+}
 
-static void count_stream(FILE *f, int *lines, int *words, int *chars) {
-    *lines = *words = *chars = 0;
-    int c, in_word = 0;
-    while ((c = fgetc(f)) != EOF) {
-        (*chars)++;
-        if (c == '\n') (*lines)++;
-        if (isspace(c)) in_word = 0;
-        else if (!in_word) { (*words)++; in_word = 1; }
+__attribute__((target("avx2")))
+static void count_chars_avx2(const unsigned char *p, size_t n, Counts *c) {
+    const __m256i lim = _mm256_set1_epi8(-65);
+    size_t i = 0;
+    while (i + 32 <= n) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int k = 0; k < 255 && i + 32 <= n; k++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(v, lim));
+        }
+        __m256i sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        c->chars += (uint64_t)_mm256_extract_epi64(sum, 0) + (uint64_t)_mm256_extract_epi64(sum, 1)
+                  + (uint64_t)_mm256_extract_epi64(sum, 2) + (uint64_t)_mm256_extract_epi64(sum, 3);
+    }
+    count_chars_scalar(p + i, n - i, c);
+}
+
+__attribute__((target("avx2,popcnt")))
+static void count_words_avx2(const unsigned char *p, size_t n, Counts *c, int *prev_ws) {
+    const __m256i nl   = _mm256_set1_epi8('\n');
+    const __m256i sp   = _mm256_set1_epi8(' ');
+    const __m256i tab  = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    uint32_t prev = (uint32_t)*prev_ws;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v   = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i t   = _mm256_sub_epi8(v, tab);
+        __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, four), t);
+        uint32_t ws = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, sp)));
+        uint32_t starts = ~ws & ((ws << 1) | prev);
+        c->words += (uint64_t)__builtin_popcount(starts);
+        c->lines += (uint64_t)__builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+        prev = ws >> 31;
     }
+    int tail_prev = (int)prev;
+    count_words_scalar(p + i, n - i, c, &tail_prev);
+    *prev_ws = tail_prev;
 }
+#endif
 
-static void print_counts(int lines, int words, int chars,
-                         bool show_l, bool show_w, bool show_c,
-                         const char *label) {
-    if (show_l) printf("%8d", lines);
-    if (show_w) printf("%8d", words);
-    if (show_c) printf("%8d", chars);
+static void (*count_lines)(const unsigned char *, size_t, Counts *) = count_lines_scalar;
+static void (*count_chars)(const unsigned char *, size_t, Counts *) = count_chars_scalar;
+static void (*count_words)(const unsigned char *, size_t, Counts *, int *) = count_words_scalar;
+
+static void select_kernels(void) {
+#if defined(WC_X86) && defined(__SSE2__)
+    count_lines = count_lines_sse2;
+    count_chars = count_chars_sse2;
+    count_words = count_words_sse2;
+#endif
+#ifdef WC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        count_lines = count_lines_avx2;
+        count_chars = count_chars_avx2;
+        count_words = count_words_avx2;
+    }
+#endif
+}
+
+/* ── Counting ─────────────────────────────────────────────────────────── */
+
+static int count_stream(FILE *f, unsigned char *buf, Counts *c) {
+    memset(c, 0, sizeof(*c));
+    int prev_ws = 1;
+    uint64_t linepos = 0;
+    size_t n;
+    while ((n = fread(buf, 1, BLOCK_SIZE, f)) > 0) {
+        c->bytes += n;
+        if (show_w)      count_words(buf, n, c, &prev_ws);
+        else if (show_l) count_lines(buf, n, c);
+        if (show_m) count_chars(buf, n, c);
+        if (show_L) count_maxlen(buf, n, c, &linepos);
+    }
+    if (linepos > c->maxlen) c->maxlen = linepos;
+    return ferror(f) ? -1 : 0;
+}
+
+/* Byte count of a regular file straight from its metadata. Standard
+ * input may already have been read partway, so only the bytes from the
+ * current offset on count; with no usable offset the data is read. */
+static bool size_from_stat(FILE *f, Counts *c) {
+    wc_stat_t st;
+    int fd = fileno(f);
+    if (wc_fstat(fd, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) return false;
+    long long off = (long long)wc_lseek(fd, 0, SEEK_CUR);
+    if (off < 0 || off > (long long)st.st_size) return false;
+    memset(c, 0, sizeof(*c));
+    c->bytes = (uint64_t)(st.st_size - off);
+    return true;
+}
+
+static void count_job(Job *j, unsigned char *buf) {
+    FILE *f = strcmp(j->name, "-") == 0 ? stdin : fopen(j->name, "rb");
+    if (!f) {
+        j->err = errno;
+        return;
+    }
+    j->opened = 1;
+    if (!(bytes_only && size_from_stat(f, &j->c)) && count_stream(f, buf, &j->c) != 0)
+        j->err = errno ? errno : EIO;
+    if (f != stdin) fclose(f);
+}
+
+/* ── Thread pool ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    Job          *jobs;
+    long          njobs;
+    volatile long next;     /* next job to claim — __sync_fetch_and_add */
+} Pool;
+
+/* Workers claim jobs one at a time so a few huge files cannot leave the
+ * other threads idle. Standard input is left for the main thread. */
+static void count_worker(void *arg) {
+    Pool *p = (Pool *)arg;
+    unsigned char *buf = malloc(BLOCK_SIZE);
+    for (;;) {
+        long i = __sync_fetch_and_add(&p->next, 1);
+        if (i >= p->njobs) break;
+        Job *j = &p->jobs[i];
+        if (strcmp(j->name, "-") == 0) continue;
+        if (!buf) { j->err = ENOMEM; continue; }
+        count_job(j, buf);
+    }
+    free(buf);
+}
+
+static void run_pool(Pool *p, int nthreads) {
+    run_threads(count_worker, p, nthreads > p->njobs ? (int)p->njobs : nthreads);
+}
+
+static int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int n = (int)si.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    if (n > THREADS_MAX) n = THREADS_MAX;
+    return n;
+}
+
+/* ── Output ───────────────────────────────────────────────────────────── */
+
+/* " %7llu" keeps the classic 8-column layout but never lets counts of
+ * 8+ digits run into each other. Column order follows GNU wc. */
+static void print_counts(const Counts *c, const char *label) {
+    if (show_l) printf(" %7llu", (unsigned long long)c->lines);
+    if (show_w) printf(" %7llu", (unsigned long long)c->words);
+    if (show_m) printf(" %7llu", (unsigned long long)c->chars);
+    if (show_c) printf(" %7llu", (unsigned long long)c->bytes);
+    if (show_L) printf(" %7llu", (unsigned long long)c->maxlen);
     if (label)  printf(" %s", label);
     printf("\n");
 }
 
+static void add_counts(Counts *total, const Counts *c) {
+    total->lines += c->lines;
+    total->words += c->words;
+    total->chars += c->chars;
+    total->bytes += c->bytes;
+    if (c->maxlen > total->maxlen) total->maxlen = c->maxlen;
+}
+
+/* Count one batch (in parallel when asked), then report it in order. */
+static int run_batch(Job *jobs, int n, int nthreads, unsigned char *buf,
+                     Counts *total, int *file_count) {
+    Pool p = { jobs, n, 0 };
+    run_pool(&p, nthreads);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(jobs[i].name, "-") == 0) count_job(&jobs[i], buf);
+    }
+
+    int ret = 0;
+    for (int i = 0; i < n; i++) {
+        Job *j = &jobs[i];
+        if (j->err) {
+            fprintf(stderr, "wc: %s: %s\n", j->name, strerror(j->err));
+            ret = 1;
+        }
+        if (!j->opened) continue;
+        print_counts(&j->c, j->name);
+        add_counts(total, &j->c);
+        (*file_count)++;
+    }
+    return ret;
+}
+
+/* Next NUL-terminated name from fp, malloc'd; "" for an empty entry and
+ * NULL at end of input. A final name without a trailing NUL still counts. */
+static char *read_name0(FILE *fp) {
+    size_t cap = 256, len = 0;
+    char *s = malloc(cap);
+    if (!s) return NULL;
+    int ch;
+    while ((ch = getc(fp)) != EOF && ch != '\0') {
+        if (len + 1 >= cap) {
+            char *t = realloc(s, cap *= 2);
+            if (!t) { free(s); return NULL; }
+            s = t;
+        }
+        s[len++] = (char)ch;
+    }
+    if (ch == EOF && len == 0) { free(s); return NULL; }
+    s[len] = '\0';
+    return s;
+}
+
+static void usage(void) {
+    puts("Usage: wc [OPTION]... [FILE]...");
+    puts("  or:  wc [OPTION]... --files0-from=F");
+    puts("Print newline, word, and byte counts for each FILE, and a total if more");
+    puts("than one FILE is specified.  With no FILE, read standard input.");
+    puts("");
+    puts("  -c, --bytes            print the byte counts");
+    puts("  -m, --chars            print the character counts (UTF-8)");
+    puts("  -l, --lines            print the newline counts");
+    puts("  -w, --words            print the word counts");
+    puts("  -L, --max-line-length  print the maximum display width");
+    puts("      --files0-from=F    read NUL-terminated file names from F (- = stdin)");
+    puts("      --parallel[=N]     count files on N threads (default: all CPUs)");
+    puts("  -h, --help   display this help and exit");
+    puts("      --version  output version information and exit");
+}
+
 int main(int argc, char* argv[]) {
-    bool show_l = false, show_w = false, show_c = false;
-    int first_file = argc; // index of first non-flag arg
+    const char *files0_from = NULL;
+    int nthreads = 1;
+    char **files = malloc((size_t)argc * sizeof(char *));
+    int nfiles = 0;
+    if (!files) {
+        fprintf(stderr, "wc: out of memory\n");
+        return 1;
+    }
 
     for (int i = 1; i < argc; ++i) {
-        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
-            puts("Usage: wc [OPTION]... [FILE]...");
-            puts("Print newline, word, and byte counts for each FILE, and a total if more");
-            puts("than one FILE is specified.  With no FILE, read standard input.");
-            puts("");
-            puts("  -l         print the newline counts");
-            puts("  -w         print the word counts");
-            puts("  -c         print the byte counts");
-            puts("  -h, --help   display this help and exit");
-            puts("      --version  output version information and exit");
-            return 0;
-        }
-        if (strcmp(argv[i], "--version") == 0) { puts("wc 1.0 (Winix)"); return 0; }
-        if (argv[i][0] == '-' && argv[i][1] != '\0') {
-            for (char *p = argv[i] + 1; *p; ++p) {
+        const char *a = argv[i];
+        if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) { usage(); free(files); return 0; }
+        if (strcmp(a, "--version") == 0) { puts("wc 1.0 (Winix)"); free(files); return 0; }
+        if      (strcmp(a, "--lines") == 0)           show_l = true;
+        else if (strcmp(a, "--words") == 0)           show_w = true;
+        else if (strcmp(a, "--chars") == 0)           show_m = true;
+        else if (strcmp(a, "--bytes") == 0)           show_c = true;
+        else if (strcmp(a, "--max-line-length") == 0) show_L = true;
+        else if (strcmp(a, "--parallel") == 0)        nthreads = cpu_count();
+        else if (strncmp(a, "--parallel=", 11) == 0) {
+            nthreads = atoi(a + 11);
+            if (nthreads < 1) nthreads = 1;
+            if (nthreads > THREADS_MAX) nthreads = THREADS_MAX;
+        }
+        else if (strncmp(a, "--files0-from=", 14) == 0) files0_from = a + 14;
+        else if (strcmp(a, "--files0-from") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "wc: option '--files0-from' requires an argument\n");
+                free(files);
+                return 1;
+            }
+            files0_from = argv[++i];
+        }
+        else if (a[0] == '-' && a[1] == '-' && a[2] != '\0') {
+            fprintf(stderr, "wc: unrecognized option '%s'\n", a);
+            free(files);
+            return 1;
+        }
+        else if (a[0] == '-' && a[1] != '\0') {
+            for (const char *p = a + 1; *p; ++p) {
                 if      (*p == 'l') show_l = true;
                 else if (*p == 'w') show_w = true;
+                else if (*p == 'm') show_m = true;
                 else if (*p == 'c') show_c = true;
+                else if (*p == 'L') show_L = true;
                 else {
                     fprintf(stderr, "wc: invalid option -- '%c'\n", *p);
+                    free(files);
                     return 1;
                 }
             }
         } else {
-            if (first_file == argc) first_file = i;
+            files[nfiles++] = argv[i];
         }
     }
 
-    // No flags → show all three
-    if (!show_l && !show_w && !show_c)
+    if (files0_from && nfiles > 0) {
+        fprintf(stderr, "wc: extra operand '%s'\n", files[0]);
+        fprintf(stderr, "wc: file operands cannot be combined with --files0-from\n");
+        free(files);
+        return 1;
+    }
+
+    // No flags → show lines, words and bytes
+    if (!show_l && !show_w && !show_m && !show_c && !show_L)
         show_l = show_w = show_c = true;
 
-    // No file args → read stdin
-    if (first_file == argc) {
-        int l, w, c;
-        count_stream(stdin, &l, &w, &c);
-        print_counts(l, w, c, show_l, show_w, show_c, NULL);
-        return 0;
+    bytes_only = show_c && !show_l && !show_w && !show_m && !show_L;
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    select_kernels();
+
+    unsigned char *buf = malloc(BLOCK_SIZE);
+    Job *jobs = calloc(BATCH_SIZE, sizeof(Job));
+    if (!buf || !jobs) {
+        fprintf(stderr, "wc: out of memory\n");
+        free(buf); free(jobs); free(files);
+        return 1;
     }
 
-    int total_l = 0, total_w = 0, total_c = 0;
+    // Serial runs report each file as soon as it is counted
+    int batch = nthreads > 1 ? BATCH_SIZE : 1;
+    Counts total;
+    memset(&total, 0, sizeof(total));
     int file_count = 0;
     int ret = 0;
 
-    for (int i = first_file; i < argc; ++i) {
-        if (argv[i][0] == '-' && argv[i][1] != '\0') continue; // skip flags
-
-        FILE *f = strcmp(argv[i], "-") == 0 ? stdin : fopen(argv[i], "r");
-        if (!f) {
-            fprintf(stderr, "wc: %s: %s\n", argv[i], strerror(errno));
+    if (files0_from) {
+        FILE *lf = strcmp(files0_from, "-") == 0 ? stdin : fopen(files0_from, "rb");
+        if (!lf) {
+            fprintf(stderr, "wc: cannot open '%s' for reading: %s\n", files0_from, strerror(errno));
+            free(buf); free(jobs); free(files);
+            return 1;
+        }
+        unsigned long long idx = 0;
+        int n = 0;
+        char *name;
+        while ((name = read_name0(lf)) != NULL) {
+            idx++;
+            if (name[0] == '\0' || (lf == stdin && strcmp(name, "-") == 0)) {
+                if (name[0] == '\0')
+                    fprintf(stderr, "wc: %s:%llu: invalid zero-length file name\n", files0_from, idx);
+                else
+                    fprintf(stderr, "wc: when reading file names from stdin, no file name of '-' allowed\n");
+                free(name);
+                ret = 1;
+                continue;
+            }
+            memset(&jobs[n], 0, sizeof(Job));
+            jobs[n++].name = name;
+            if (n == batch) {
+                ret |= run_batch(jobs, n, nthreads, buf, &total, &file_count);
+                for (int k = 0; k < n; k++) free((char *)jobs[k].name);
+                n = 0;
+            }
+        }
+        if (ferror(lf)) {
+            fprintf(stderr, "wc: %s: read error\n", files0_from);
             ret = 1;
-            continue;
         }
-
-        int l, w, c;
-        count_stream(f, &l, &w, &c);
-        print_counts(l, w, c, show_l, show_w, show_c, argv[i]);
-
-        total_l += l; total_w += w; total_c += c;
-        file_count++;
-
-        if (f != stdin) fclose(f);
+        ret |= run_batch(jobs, n, nthreads, buf, &total, &file_count);
+        for (int k = 0; k < n; k++) free((char *)jobs[k].name);
+        if (lf != stdin) fclose(lf);
+    } else if (nfiles > 0) {
+        for (int i = 0; i < nfiles; i += batch) {
+            int n = nfiles - i < batch ? nfiles - i : batch;
+            memset(jobs, 0, (size_t)n * sizeof(Job));
+            for (int k = 0; k < n; k++) jobs[k].name = files[i + k];
+            ret |= run_batch(jobs, n, nthreads, buf, &total, &file_count);
+        }
+    } else {
+        // No file args → read stdin, unlabelled
+        Job j;
+        memset(&j, 0, sizeof(j));
+        j.name = "-";
+        count_job(&j, buf);
+        if (j.err) {
+            fprintf(stderr, "wc: -: %s\n", strerror(j.err));
+            ret = 1;
+        }
+        print_counts(&j.c, NULL);
     }
 
     if (file_count > 1)
-        print_counts(total_l, total_w, total_c, show_l, show_w, show_c, "total");
+        print_counts(&total, "total");
 
+    free(buf);
+    free(jobs);
+    free(files);
     return ret;
 }
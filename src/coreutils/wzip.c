@@ -10,30 +10,63 @@
  *   -f / --force        force overwrite of existing output file
  *   -v / --verbose      verbose (filename + ratio)
  *   -t / --test         test integrity (decompress to /dev/null)
- *   -r / --recursive    recurse into directories
+ *   -r / --recursive    recurse into directories; with -T, files are
+ *                       compressed in parallel, one per thread
  *   -1 .. -19           compression level (default 3)
+ *   --ultra             allow levels -20 .. -22
+ *   --long[=WLOG]       long-distance matching with a 2^WLOG window (27)
+ *   --memory=SIZE       largest window wunzip accepts (default: the window
+ *                       the header records, or 128 MB)
+ *   -D DICT             compress / decompress with a dictionary; wunzip
+ *                       takes several and uses the one the header names
+ *   --train FILE... [-o DICT] [--maxdict=SIZE]
+ *                       train a dictionary on sample files (default name
+ *                       "dictionary", 110 KB)
+ *   --seekable[=SIZE]   independent frames of SIZE (default 1M) plus a
+ *                       seek table, compressed on -T threads
+ *   --range=OFF[:LEN]   wunzip: write LEN bytes from offset OFF to stdout,
+ *                       decoding only the frames needed when seekable
+ *   -T N / --threads=N  compress on N zstd worker threads (0 or default:
+ *                       one per core)
+ *   --job-size=SIZE     input per worker job (K/M/G suffix; 0 = automatic)
+ *   --adapt[=min=N,max=M]
+ *                       raise or lower the level between jobs to keep up
+ *                       with the input and output
  *   --version / --help
  *
  * .wz file format (all fields little-endian):
  *   [0..3]   magic   "WZ\x01\x00"
- *   [4..5]   version uint16  (currently 1)
+ *   [4..5]   version uint16  (1, or 2 when extra fields follow the name)
  *   [6..9]   mtime   uint32  (Unix timestamp, 0 if unknown)
  *   [10]     fnlen   uint8   (original filename length, 0 = stdin)
  *   [11..]   fname   bytes   (original filename, no NUL)
+ *   version 2 only:
+ *   [..]     xlen    uint8   (length of the extra fields; readers skip
+ *                             fields they do not know)
+ *   [..]     wlog    uint8   (window log the frames need, 0 = default)
+ *   [..]     dictid  uint32  (dictionary the frames need, 0 = none)
  *   [..]     zstd frame(s)   (standard zstd format)
+ *   [..]     seek table      (--seekable only; zstd seekable format: a
+ *                             skippable frame of (csize, dsize) uint32
+ *                             pairs ending in nframes, a descriptor byte
+ *                             and the magic 0x8F92EAB1)
  *
  * Exit: 0 = success, 1 = error
  */
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
+#include "zdict.h"
+#include "threads.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <errno.h>
 #include <stdint.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <time.h>
 
 #ifdef _WIN32
@@ -47,8 +80,13 @@
 #  ifndef S_ISDIR
 #    define S_ISDIR(m)  (((m) & _S_IFMT) == _S_IFDIR)
 #  endif
-/* Recursive directory listing on Windows */
 #  include <windows.h>
+#  define wz_fseek  _fseeki64
+#  define wz_ftell  _ftelli64
+#else
+#  include <unistd.h>
+#  define wz_fseek  fseeko
+#  define wz_ftell  ftello
 #endif
 
 /* ── magic ───────────────────────────────────────────────── */
@@ -56,11 +94,21 @@
 #define WZ_MAGIC1  'Z'
 #define WZ_MAGIC2  '\x01'
 #define WZ_MAGIC3  '\x00'
-#define WZ_VERSION  1
+#define WZ_VERSION  2    /* highest version read; 1 is written when possible */
 #define WZ_EXT      ".wz"
 #define WZ_EXT_LEN  3
 
 #define CHUNK  (1 << 17)  /* 128 KiB I/O buffer */
+#define SAMPLE_MAX  (1 << 17)  /* --train reads at most this much of each file */
+#define PAR_BATCH   4          /* frames per thread handled in one batch */
+#define PAR_CBUF    (64 << 20) /* -T decompression: compressed input window */
+#define PAR_DMAX    ((size_t)256 << 20) /* and decompressed output per batch */
+#define PAR_FILES   4096       /* -r -T: files per batch of queued messages */
+#define PAR_FILE_BIG ((long long)32 << 20) /* compressed alone, on all -T workers */
+
+#define SEEK_SKIP_MAGIC 0x184D2A5Eu
+#define SEEK_MAGIC      0x8F92EAB1u
+#define SEEK_MAXFRAMES  0x8000000u
 
 /* ── options ─────────────────────────────────────────────── */
 static int opt_decompress = 0;
@@ -71,6 +119,28 @@ static int opt_verbose    = 0;
 static int opt_test       = 0;
 static int opt_recursive  = 0;
 static int opt_level      = 3;   /* zstd default fast level */
+static int opt_threads    = 0;   /* zstd workers; 0 = one per core */
+static long long opt_job_size = 0;  /* 0 = zstd picks from the window size */
+static int opt_ultra      = 0;
+static int opt_long       = 0;   /* window log for long matching, 0 = off */
+static long long opt_memory = 0; /* wunzip window limit, 0 = from header */
+static int opt_train      = 0;
+static const char *opt_output = "dictionary";   /* --train -o */
+static long long opt_maxdict = 112640;
+static const char **opt_dicts = NULL;            /* -D, in argument order */
+static int opt_ndicts     = 0;
+static long long opt_frame_size = 0;     /* --seekable; 0 = one frame */
+static long long opt_range_off  = -1;    /* --range; -1 = everything */
+static long long opt_range_len  = -1;    /* -1 = to the end */
+static int opt_adapt      = 0;
+static int opt_adapt_min  = 1;
+static int opt_adapt_max  = 0;   /* 0 = 19, or 22 with --ultra */
+
+/* Dictionaries, digested once and shared by every file */
+static ZSTD_CDict  *g_cdict   = NULL;
+static unsigned     g_dict_id = 0;
+static ZSTD_DDict **g_ddicts  = NULL;
+static unsigned    *g_ddict_ids = NULL;
 
 /* ── return codes ────────────────────────────────────────── */
 static int g_rc = 0;  /* 0 = success, 1 = at least one error */
@@ -100,6 +170,34 @@ static uint32_t read_le32(const uint8_t *buf) {
                       ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24));
 }
 
+/* N with an optional K, M or G (powers of 1024) suffix */
+static int parse_size(const char *arg, long long *v) {
+    char *end;
+    errno = 0;
+    long long n = strtoll(arg, &end, 10);
+    if (end == arg || n < 0 || errno) return -1;
+    switch (*end) {
+        case 'K': case 'k': n <<= 10; end++; break;
+        case 'M': case 'm': n <<= 20; end++; break;
+        case 'G': case 'g': n <<= 30; end++; break;
+        default: break;
+    }
+    if (*end) return -1;
+    *v = n;
+    return 0;
+}
+
+static int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int n = (int)si.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n < 1 ? 1 : n;
+}
+
 /* Extract just the base filename from a path */
 static const char *basename_of(const char *path) {
     const char *p = path + strlen(path);
@@ -107,141 +205,674 @@ static const char *basename_of(const char *path) {
     return p;
 }
 
-/* ── compress one FILE* → FILE* ──────────────────────────── */
-static int compress_stream(FILE *fin, FILE *fout,
-                            const char *orig_name, uint32_t mtime,
-                            size_t *in_bytes, size_t *out_bytes)
+/* ── messages ────────────────────────────────────────────── */
+/* Messages of a file compressed on a -r worker thread are kept here and
+   printed in argument order once the batch is done, so -v output and
+   errors read the same at any -T. NULL means straight to stderr. */
+typedef struct {
+    char  *buf;
+    size_t len, cap;
+} MsgBuf;
+
+static void say(MsgBuf *m, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    if (m) {
+        char line[4200];
+        int n = vsnprintf(line, sizeof(line), fmt, ap);
+        if (n < 0) n = 0;
+        if ((size_t)n >= sizeof(line)) n = (int)sizeof(line) - 1;
+        if (m->len + (size_t)n > m->cap) {
+            size_t nc = m->cap ? m->cap * 2 : 256;
+            while (nc < m->len + (size_t)n) nc *= 2;
+            char *nb = realloc(m->buf, nc);
+            if (!nb) { fputs(line, stderr); va_end(ap); return; }
+            m->buf = nb; m->cap = nc;
+        }
+        memcpy(m->buf + m->len, line, (size_t)n);
+        m->len += (size_t)n;
+    } else {
+        vfprintf(stderr, fmt, ap);
+    }
+    va_end(ap);
+}
+
+/* ── .wz header ──────────────────────────────────────────── */
+typedef struct {
+    uint32_t mtime;
+    char     name[256];  /* original filename, "" for stdin */
+    int      wlog;       /* window log the frames need, 0 = within the default */
+    unsigned dict_id;    /* dictionary the frames need, 0 = none */
+} WzHeader;
+
+/* Returns the header size, or -1 on a write error. Version 1 is written
+   unless an extra field is needed, so older wunzip builds can still read
+   ordinary files. */
+static int write_header(FILE *fout, const char *orig_name, uint32_t mtime,
+                        int wlog, unsigned dict_id, MsgBuf *m)
 {
-    /* Write .wz header */
-    uint8_t fnlen = orig_name ? (uint8_t)strlen(orig_name) : 0;
-    /* cap at 255 */
     const char *fn = orig_name ? orig_name : "";
-    if (fnlen > 255) { fnlen = 255; }
+    size_t fnlen = strlen(fn);
+    if (fnlen > 255) fnlen = 255;
 
-    uint8_t hdr[11];
+    uint8_t hdr[11 + 255 + 6];
+    size_t n = 11 + fnlen;
     hdr[0] = WZ_MAGIC0; hdr[1] = WZ_MAGIC1;
     hdr[2] = WZ_MAGIC2; hdr[3] = WZ_MAGIC3;
-    write_le16(hdr + 4, WZ_VERSION);
+    write_le16(hdr + 4, wlog || dict_id ? 2 : 1);
     write_le32(hdr + 6, mtime);
-    hdr[10] = fnlen;
-    if (fwrite(hdr, 1, 11, fout) != 11) return -1;
-    if (fnlen && fwrite(fn, 1, fnlen, fout) != fnlen) return -1;
+    hdr[10] = (uint8_t)fnlen;
+    memcpy(hdr + 11, fn, fnlen);
+    if (dict_id) {
+        hdr[n++] = 5;
+        hdr[n++] = (uint8_t)wlog;
+        write_le32(hdr + n, dict_id);
+        n += 4;
+    } else if (wlog) {
+        hdr[n++] = 1;
+        hdr[n++] = (uint8_t)wlog;
+    }
+    if (fwrite(hdr, 1, n, fout) != n) {
+        say(m, "wzip: write error: %s\n", strerror(errno));
+        return -1;
+    }
+    return (int)n;
+}
+
+#define WZ_HDR_MAX  (11 + 255 + 1 + 255)
+
+static int is_wz_magic(const uint8_t *p) {
+    return p[0] == WZ_MAGIC0 && p[1] == WZ_MAGIC1 &&
+           p[2] == WZ_MAGIC2 && p[3] == WZ_MAGIC3;
+}
+
+/* Length of the header at p, as far as the n bytes there tell */
+static size_t header_len(const uint8_t *p, size_t n)
+{
+    if (n < 11) return 11;
+    size_t len = 11 + p[10];
+    if (read_le16(p + 4) >= 2) {
+        if (n <= len) return len + 1;
+        len += 1 + p[len];
+    }
+    return len;
+}
+
+/* Read a header from p[0, n), which holds at least header_len(p, n) bytes
+   once that stops growing. 0 = ok, -1 = not a header (reported). */
+static int parse_header(const uint8_t *p, size_t n, WzHeader *h, const char *label)
+{
+    if (n < 11 || !is_wz_magic(p)) {
+        fprintf(stderr, "wunzip: %s: not a .wz file\n", label);
+        return -1;
+    }
+    uint16_t ver = read_le16(p + 4);
+    if (ver > WZ_VERSION) {
+        fprintf(stderr, "wunzip: %s: unsupported .wz version %u\n", label, ver);
+        return -1;
+    }
+    size_t fnlen = p[10], len = header_len(p, n);
+    if (n < len) {
+        fprintf(stderr, "wunzip: %s: truncated header\n", label);
+        return -1;
+    }
+    const uint8_t *x = p + 12 + fnlen;
+    size_t xlen = ver >= 2 ? p[11 + fnlen] : 0;
+    h->mtime = read_le32(p + 6);
+    memcpy(h->name, p + 11, fnlen);
+    h->name[fnlen] = '\0';
+    h->wlog    = xlen >= 1 ? x[0] : 0;
+    h->dict_id = xlen >= 5 ? read_le32(x + 1) : 0;
+    return 0;
+}
 
-    *out_bytes = 11 + fnlen;
+/* Read a header from fin, taking no byte past its end */
+static int read_header(FILE *fin, WzHeader *h, const char *label, size_t *in_bytes)
+{
+    uint8_t hdr[WZ_HDR_MAX];
+    size_t n = 0, need;
+    while (n < (need = header_len(hdr, n))) {
+        size_t got = fread(hdr + n, 1, need - n, fin);
+        n += got;
+        if (n < need || (n == 11 && !is_wz_magic(hdr))) break;
+    }
+    if (parse_header(hdr, n, h, label) != 0) return -1;
+    *in_bytes = n;
+    return 0;
+}
 
-    /* Streaming compression */
-    ZSTD_CStream *cstream = ZSTD_createCStream();
-    if (!cstream) { fprintf(stderr, "wzip: out of memory\n"); return -1; }
-    size_t r = ZSTD_initCStream(cstream, opt_level);
+/*
+ * A header inside the body: .wz files joined with cat. rest[0, *nrest)
+ * starts with the magic; it is topped up from fin to a whole header, which
+ * is parsed, and what follows the header is left in rest.
+ */
+static int next_header(FILE *fin, WzHeader *h, const char *label,
+                       uint8_t **rest, size_t *nrest, size_t *in_bytes)
+{
+    uint8_t *p = *rest;
+    size_t n = *nrest, need;
+    if (n < WZ_HDR_MAX) {
+        if (!(p = realloc(p, WZ_HDR_MAX))) {
+            fprintf(stderr, "wunzip: out of memory\n");
+            return -1;
+        }
+        *rest = p;
+    }
+    while (n < (need = header_len(p, n))) {
+        size_t got = fread(p + n, 1, need - n, fin);
+        *in_bytes += got;
+        n += got;
+        if (got == 0) break;
+    }
+    if (parse_header(p, n, h, label) != 0) return -1;
+    need = header_len(p, n);
+    memmove(p, p + need, n - need);
+    *nrest = n - need;
+    return 0;
+}
+
+/* ── compression parameters ──────────────────────────────── */
+/* Level, long matching and the -D dictionary; workers > 0 hands the
+   frame to zstd's own job pool. */
+static size_t setup_cctx(ZSTD_CCtx *cctx, int workers)
+{
+    size_t r = ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, opt_level);
+    if (!ZSTD_isError(r))
+        r = ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers);
+    if (!ZSTD_isError(r) && workers && opt_job_size)
+        r = ZSTD_CCtx_setParameter(cctx, ZSTD_c_jobSize,
+                                   opt_job_size > INT32_MAX ? INT32_MAX : (int)opt_job_size);
+    if (!ZSTD_isError(r) && g_cdict)
+        r = ZSTD_CCtx_refCDict(cctx, g_cdict);
+    if (!ZSTD_isError(r) && opt_long) {
+        r = ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
+        if (!ZSTD_isError(r))
+            r = ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, opt_long);
+    }
+    return r;
+}
+
+/* ── seekable frames ─────────────────────────────────────── */
+/*
+ * --seekable cuts the input into frames of opt_frame_size that are
+ * compressed independently, PAR_BATCH per thread at a time, and appends
+ * a seek table in the zstd seekable format: a skippable frame holding
+ * (compressed size, decompressed size) per frame and a 9-byte footer.
+ * Any zstd decoder skips it; wunzip --range reads it from the end.
+ */
+typedef struct {
+    const uint8_t *in;
+    size_t         inlen;
+    uint8_t       *out;
+    size_t         outcap;
+    size_t         outlen;      /* result size or a zstd error code */
+} SeekFrame;
+
+/* Frames compressed (cctx) or decompressed (dctx) on a thread each */
+typedef struct {
+    SeekFrame     *f;
+    long           nf;
+    volatile long  next;
+    volatile long  slot;
+    ZSTD_CCtx    **cctx;        /* one per thread */
+    ZSTD_DCtx    **dctx;
+} FramePool;
+
+static void frame_worker(void *arg)
+{
+    FramePool *p = (FramePool *)arg;
+    long t = __sync_fetch_and_add(&p->slot, 1);
+    for (;;) {
+        long i = __sync_fetch_and_add(&p->next, 1);
+        if (i >= p->nf) break;
+        SeekFrame *f = &p->f[i];
+        f->outlen = p->dctx
+            ? ZSTD_decompressDCtx(p->dctx[t], f->out, f->outcap, f->in, f->inlen)
+            : ZSTD_compress2(p->cctx[t], f->out, f->outcap, f->in, f->inlen);
+    }
+}
+
+static void frame_run(FramePool *p, int nthreads)
+{
+    p->next = 0;
+    p->slot = 0;
+    run_threads(frame_worker, p, nthreads > p->nf ? (int)p->nf : nthreads);
+}
+
+/* cctx0, when given, is the caller's context: used as the first thread's
+   and not freed. */
+static int seek_compress(FILE *fin, FILE *fout, ZSTD_CCtx *cctx0, int nthreads,
+                         MsgBuf *m, size_t *in_bytes, size_t *out_bytes)
+{
+    if (nthreads > THREADS_MAX) nthreads = THREADS_MAX;
+    long batch = (long)nthreads * PAR_BATCH;
+    size_t fsz = (size_t)opt_frame_size, cap = ZSTD_compressBound(fsz);
+    FramePool pool = { 0 };
+    uint8_t *ibuf = malloc(fsz * (size_t)batch);
+    uint8_t *table = NULL;
+    size_t tlen = 0, tcap = 0;
+    uint32_t nframes = 0;
+    int rc = -1;
+
+    pool.f    = calloc((size_t)batch, sizeof(SeekFrame));
+    pool.cctx = calloc((size_t)nthreads, sizeof(ZSTD_CCtx *));
+    if (!ibuf || !pool.f || !pool.cctx) goto oom;
+    for (long i = 0; i < batch; i++) {
+        if (!(pool.f[i].out = malloc(cap))) goto oom;
+        pool.f[i].outcap = cap;
+    }
+    for (int t = 0; t < nthreads; t++) {
+        if (t == 0 && cctx0) {
+            pool.cctx[t] = cctx0;
+            ZSTD_CCtx_reset(cctx0, ZSTD_reset_session_and_parameters);
+        } else if (!(pool.cctx[t] = ZSTD_createCCtx())) {
+            goto oom;
+        }
+        size_t r = setup_cctx(pool.cctx[t], 0);
+        if (ZSTD_isError(r)) {
+            say(m, "wzip: zstd init error: %s\n", ZSTD_getErrorName(r));
+            goto done;
+        }
+    }
+
+    *in_bytes = 0;
+    for (;;) {
+        size_t nr = fread(ibuf, 1, fsz * (size_t)batch, fin);
+        if (ferror(fin)) {
+            say(m, "wzip: read error: %s\n", strerror(errno));
+            goto done;
+        }
+        if (nr == 0) break;
+        *in_bytes += nr;
+
+        pool.nf = 0;
+        for (size_t at = 0; at < nr; at += fsz, pool.nf++) {
+            pool.f[pool.nf].in    = ibuf + at;
+            pool.f[pool.nf].inlen = nr - at < fsz ? nr - at : fsz;
+        }
+        frame_run(&pool, nthreads);
+
+        if (tlen + (size_t)pool.nf * 8 > tcap) {
+            size_t nc = tcap ? tcap * 2 : 4096;
+            while (nc < tlen + (size_t)pool.nf * 8) nc *= 2;
+            uint8_t *nt = realloc(table, nc);
+            if (!nt) goto oom;
+            table = nt; tcap = nc;
+        }
+        for (long i = 0; i < pool.nf; i++) {
+            SeekFrame *f = &pool.f[i];
+            if (ZSTD_isError(f->outlen)) {
+                say(m, "wzip: compress error: %s\n", ZSTD_getErrorName(f->outlen));
+                goto done;
+            }
+            if (fwrite(f->out, 1, f->outlen, fout) != f->outlen) {
+                say(m, "wzip: write error: %s\n", strerror(errno));
+                goto done;
+            }
+            *out_bytes += f->outlen;
+            write_le32(table + tlen,     (uint32_t)f->outlen);
+            write_le32(table + tlen + 4, (uint32_t)f->inlen);
+            tlen += 8;
+            if (++nframes > SEEK_MAXFRAMES) {
+                say(m, "wzip: more than %u frames; use a larger --seekable size\n",
+                        SEEK_MAXFRAMES);
+                goto done;
+            }
+        }
+        if (nr < fsz * (size_t)batch) break;
+    }
+
+    /* Skippable frame header, the entries, then the footer */
+    {
+        uint8_t head[8], foot[9];
+        write_le32(head, SEEK_SKIP_MAGIC);
+        write_le32(head + 4, (uint32_t)(tlen + 9));
+        write_le32(foot, nframes);
+        foot[4] = 0;                            /* no per-frame checksums */
+        write_le32(foot + 5, SEEK_MAGIC);
+        if (fwrite(head, 1, 8, fout) != 8 ||
+            (tlen && fwrite(table, 1, tlen, fout) != tlen) ||
+            fwrite(foot, 1, 9, fout) != 9) {
+            say(m, "wzip: write error: %s\n", strerror(errno));
+            goto done;
+        }
+        *out_bytes += 8 + tlen + 9;
+    }
+    rc = 0;
+    goto done;
+
+oom:
+    say(m, "wzip: out of memory\n");
+done:
+    if (pool.f)
+        for (long i = 0; i < batch; i++) free(pool.f[i].out);
+    if (pool.cctx)
+        for (int t = cctx0 ? 1 : 0; t < nthreads; t++) ZSTD_freeCCtx(pool.cctx[t]);
+    free(pool.f);
+    free(pool.cctx);
+    free(ibuf);
+    free(table);
+    return rc;
+}
+
+/* ── --adapt ───────────────────────────────────────────────── */
+/*
+ * As in the zstd CLI: with zstd workers running, compressStream2 only
+ * blocks when every job is busy, so time spent inside it means the
+ * workers are the bottleneck and the level goes down; time spent in
+ * fread / fwrite (a slow source, or a pipe or share that pushes back)
+ * means the CPU is waiting and the level goes up. The level is changed
+ * with ZSTD_CCtx_setParameter whenever zstd starts a new job, and takes
+ * effect from the next job on; the window stays the same.
+ */
+typedef struct {
+    int      level;
+    unsigned job;       /* zstd job the times below belong to */
+    double   t_io;      /* in fread and fwrite */
+    double   t_comp;    /* in compressStream2 */
+} Adapt;
+
+static double now_sec(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / (double)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void adapt_level(ZSTD_CCtx *cctx, Adapt *a)
+{
+    ZSTD_frameProgression fp = ZSTD_getFrameProgression(cctx);
+    if (fp.currentJobID == a->job) return;
+    a->job = fp.currentJobID;
+
+    int lv = a->level;
+    if (a->t_comp > a->t_io)
+        lv--;                           /* workers cannot keep up */
+    else if (a->t_comp * 4 < a->t_io)
+        lv++;                           /* mostly waiting on I/O */
+    if (lv < opt_adapt_min) lv = opt_adapt_min;
+    if (lv > opt_adapt_max) lv = opt_adapt_max;
+    if (lv != a->level &&
+        !ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, lv)))
+        a->level = lv;
+    a->t_io = a->t_comp = 0;
+}
+
+/* ── compress one FILE* → FILE* ──────────────────────────── */
+/* cctx may be a context the caller reuses across files; it is reset and
+   left allocated. Without one a context is made and freed here. nthreads
+   is the zstd worker count, 0 to compress on the calling thread. */
+static int compress_stream(FILE *fin, FILE *fout,
+                            const char *orig_name, uint32_t mtime,
+                            ZSTD_CCtx *cctx, int nthreads, MsgBuf *m,
+                            size_t *in_bytes, size_t *out_bytes)
+{
+    /* Only a window past the decoder's default limit needs recording */
+    int n = write_header(fout, orig_name, mtime,
+                         opt_long > ZSTD_WINDOWLOG_LIMIT_DEFAULT ? opt_long : 0,
+                         g_dict_id, m);
+    if (n < 0) return -1;
+    *out_bytes = (size_t)n;
+
+    if (opt_frame_size)
+        return seek_compress(fin, fout, cctx, nthreads ? nthreads : 1, m,
+                             in_bytes, out_bytes);
+
+    /* Streaming compression. With nbWorkers >= 1 zstd cuts the input into
+       jobs compressed on its own thread pool; the frame is the same for any
+       worker count, and compressStream2 only blocks when all jobs are busy. */
+    ZSTD_CCtx *own = NULL;
+    if (cctx)
+        ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+    else if (!(cctx = own = ZSTD_createCCtx())) {
+        say(m, "wzip: out of memory\n");
+        return -1;
+    }
+    /* --adapt changes the level between jobs, so it needs zstd workers */
+    size_t r = setup_cctx(cctx, opt_adapt && !nthreads ? 1 : nthreads);
     if (ZSTD_isError(r)) {
-        fprintf(stderr, "wzip: zstd init error: %s\n", ZSTD_getErrorName(r));
-        ZSTD_freeCStream(cstream);
+        say(m, "wzip: zstd init error: %s\n", ZSTD_getErrorName(r));
+        ZSTD_freeCCtx(own);
         return -1;
     }
 
     uint8_t *ibuf = malloc(CHUNK);
     uint8_t *obuf = malloc(ZSTD_CStreamOutSize());
     if (!ibuf || !obuf) {
-        free(ibuf); free(obuf); ZSTD_freeCStream(cstream);
-        fprintf(stderr, "wzip: out of memory\n");
+        free(ibuf); free(obuf); ZSTD_freeCCtx(own);
+        say(m, "wzip: out of memory\n");
         return -1;
     }
     size_t obufsz = ZSTD_CStreamOutSize();
 
+    Adapt ad = { opt_level, 0, 0, 0 };
+    double t0 = opt_adapt ? now_sec() : 0, t1;
     *in_bytes = 0;
     int rc = 0;
     size_t nr;
-    while ((nr = fread(ibuf, 1, CHUNK, fin)) > 0) {
+    ZSTD_EndDirective mode = ZSTD_e_continue;
+    do {
+        nr = fread(ibuf, 1, CHUNK, fin);
+        if (opt_adapt) { t1 = now_sec(); ad.t_io += t1 - t0; t0 = t1; }
+        if (nr < CHUNK) {
+            if (ferror(fin)) {
+                say(m, "wzip: read error: %s\n", strerror(errno));
+                rc = -1; goto done;
+            }
+            mode = ZSTD_e_end;
+        }
         *in_bytes += nr;
-        ZSTD_inBuffer in_buf  = { ibuf, nr, 0 };
-        while (in_buf.pos < in_buf.size) {
+        ZSTD_inBuffer in_buf = { ibuf, nr, 0 };
+        /* continue: until the input is taken; end: until the frame is flushed */
+        do {
             ZSTD_outBuffer out_buf = { obuf, obufsz, 0 };
-            r = ZSTD_compressStream(cstream, &out_buf, &in_buf);
+            r = ZSTD_compressStream2(cctx, &out_buf, &in_buf, mode);
+            if (opt_adapt) { t1 = now_sec(); ad.t_comp += t1 - t0; t0 = t1; }
             if (ZSTD_isError(r)) {
-                fprintf(stderr, "wzip: compress error: %s\n", ZSTD_getErrorName(r));
+                say(m, "wzip: compress error: %s\n", ZSTD_getErrorName(r));
                 rc = -1; goto done;
             }
             if (out_buf.pos && fwrite(obuf, 1, out_buf.pos, fout) != out_buf.pos) {
-                fprintf(stderr, "wzip: write error: %s\n", strerror(errno));
+                say(m, "wzip: write error: %s\n", strerror(errno));
                 rc = -1; goto done;
             }
             *out_bytes += out_buf.pos;
-        }
-    }
-    if (ferror(fin)) {
-        fprintf(stderr, "wzip: read error: %s\n", strerror(errno));
-        rc = -1; goto done;
-    }
-
-    /* Flush / end frame */
-    {
-        ZSTD_outBuffer out_buf = { obuf, obufsz, 0 };
-        r = ZSTD_endStream(cstream, &out_buf);
-        if (ZSTD_isError(r)) {
-            fprintf(stderr, "wzip: flush error: %s\n", ZSTD_getErrorName(r));
-            rc = -1; goto done;
-        }
-        if (out_buf.pos && fwrite(obuf, 1, out_buf.pos, fout) != out_buf.pos) {
-            fprintf(stderr, "wzip: write error: %s\n", strerror(errno));
-            rc = -1; goto done;
-        }
-        *out_bytes += out_buf.pos;
-    }
+            if (opt_adapt) {
+                t1 = now_sec(); ad.t_io += t1 - t0; t0 = t1;
+                adapt_level(cctx, &ad);
+            }
+        } while (mode == ZSTD_e_end ? r != 0 : in_buf.pos < in_buf.size);
+    } while (mode != ZSTD_e_end);
 
 done:
     free(ibuf); free(obuf);
-    ZSTD_freeCStream(cstream);
+    ZSTD_freeCCtx(own);
     return rc;
 }
 
-/* ── decompress one FILE* → FILE* ───────────────────────── */
-static int decompress_stream(FILE *fin, FILE *fout,
-                              char *orig_name_out, size_t name_out_sz,
-                              uint32_t *mtime_out,
-                              size_t *in_bytes, size_t *out_bytes)
+/* ── decompression ─────────────────────────────────────── */
+/* A DCtx with the window limit and the -D dictionary the header calls for */
+static ZSTD_DCtx *make_dctx(const WzHeader *h, const char *label)
 {
-    /* Read and validate .wz header */
-    uint8_t hdr[11];
-    if (fread(hdr, 1, 11, fin) != 11) {
-        fprintf(stderr, "wunzip: not a .wz file (too short)\n");
-        return -1;
+    /* The -D dictionary the header names, or the first one for files
+       without a recorded ID (made with a raw content dictionary) */
+    ZSTD_DDict *ddict = NULL;
+    if (opt_ndicts) {
+        int k = 0;
+        if (h->dict_id)
+            while (k < opt_ndicts && g_ddict_ids[k] != h->dict_id) k++;
+        if (k < opt_ndicts) ddict = g_ddicts[k];
+    }
+    if (h->dict_id && !ddict) {
+        fprintf(stderr, "wunzip: %s: needs dictionary %u (pass it with -D)\n",
+                label, h->dict_id);
+        return NULL;
+    }
+
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (!dctx) { fprintf(stderr, "wunzip: out of memory\n"); return NULL; }
+    /* --memory is a hard limit; without it the window the header records
+       is allowed, so --long files need no extra option to restore. */
+    size_t r = 0;
+    if (opt_memory)
+        r = ZSTD_DCtx_setMaxWindowSize(dctx,
+                opt_memory < (1 << ZSTD_WINDOWLOG_MIN) ? (size_t)1 << ZSTD_WINDOWLOG_MIN :
+                opt_memory > ((long long)1 << ZSTD_WINDOWLOG_MAX) ?
+                    (size_t)1 << ZSTD_WINDOWLOG_MAX : (size_t)opt_memory);
+    else if (h->wlog > ZSTD_WINDOWLOG_LIMIT_DEFAULT)
+        r = ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, h->wlog);
+    if (!ZSTD_isError(r) && ddict)
+        r = ZSTD_DCtx_refDDict(dctx, ddict);
+    if (ZSTD_isError(r)) {
+        fprintf(stderr, "wunzip: %s: %s\n", label, ZSTD_getErrorName(r));
+        ZSTD_freeDCtx(dctx);
+        return NULL;
+    }
+    return dctx;
+}
+
+/* Write the part of p[0, n) inside --range (all of it without one);
+   *pos is the offset of p[0] in the decompressed data. */
+static int emit(FILE *fout, const uint8_t *p, size_t n, unsigned long long *pos)
+{
+    unsigned long long lo = *pos, hi = lo + n;
+    *pos = hi;
+    if (opt_range_off >= 0) {
+        unsigned long long a = (unsigned long long)opt_range_off;
+        unsigned long long b = opt_range_len < 0 ? ~0ULL : a + (unsigned long long)opt_range_len;
+        if (hi <= a || lo >= b) return 0;
+        if (lo < a) { p += a - lo; lo = a; }
+        if (hi > b) hi = b;
+        n = (size_t)(hi - lo);
     }
-    if (hdr[0] != WZ_MAGIC0 || hdr[1] != WZ_MAGIC1 ||
-        hdr[2] != WZ_MAGIC2 || hdr[3] != WZ_MAGIC3) {
-        fprintf(stderr, "wunzip: not a .wz file (bad magic)\n");
+    if (fout && n && fwrite(p, 1, n, fout) != n) {
+        fprintf(stderr, "wunzip: write error: %s\n", strerror(errno));
         return -1;
     }
-    uint16_t ver   = read_le16(hdr + 4);
-    uint32_t mtime = read_le32(hdr + 6);
-    uint8_t  fnlen = hdr[10];
-    (void)ver;
+    return 0;
+}
 
-    if (mtime_out) *mtime_out = mtime;
+/* True once the output is past the end of --range */
+static int range_done(unsigned long long pos)
+{
+    return opt_range_off >= 0 && opt_range_len >= 0 &&
+           pos >= (unsigned long long)(opt_range_off + opt_range_len);
+}
 
-    char fname[256] = "";
-    if (fnlen > 0) {
-        if (fread(fname, 1, fnlen, fin) != fnlen) {
-            fprintf(stderr, "wunzip: truncated header\n");
-            return -1;
-        }
-        fname[fnlen] = '\0';
+/*
+ * --range on a file that ends in a seek table: decompress only the frames
+ * that overlap the range. Returns 1, with fin back at data_start, when
+ * there is no seek table and the caller should stream instead.
+ */
+static int seek_range(FILE *fin, FILE *fout, const WzHeader *h, const char *label,
+                      long long data_start, size_t *in_bytes, size_t *out_bytes)
+{
+    uint8_t foot[9], head[8];
+    if (wz_fseek(fin, -9, SEEK_END) != 0 || fread(foot, 1, 9, fin) != 9 ||
+        read_le32(foot + 5) != SEEK_MAGIC) {
+        clearerr(fin);
+        return wz_fseek(fin, data_start, SEEK_SET) == 0 ? 1 : -1;
     }
-    if (orig_name_out && name_out_sz > 0) {
-        strncpy(orig_name_out, fname, name_out_sz - 1);
-        orig_name_out[name_out_sz - 1] = '\0';
+
+    long long fsize = wz_ftell(fin);
+    uint32_t nframes = read_le32(foot);
+    size_t esz = (foot[4] & 0x80) ? 12 : 8;     /* entries may carry a checksum */
+    long long tsize = 8 + (long long)nframes * esz + 9;
+    uint8_t *table = NULL, *cbuf = NULL, *dbuf = NULL;
+    size_t ccap = 0, dcap = 0;
+    ZSTD_DCtx *dctx = NULL;
+    int rc = -1;
+
+    if ((foot[4] & 0x7c) || nframes > SEEK_MAXFRAMES || tsize > fsize - data_start ||
+        wz_fseek(fin, fsize - tsize, SEEK_SET) != 0 || fread(head, 1, 8, fin) != 8 ||
+        read_le32(head) != SEEK_SKIP_MAGIC || read_le32(head + 4) != tsize - 8)
+        goto corrupt;
+    if (!(table = malloc(nframes * esz + 1))) goto oom;
+    if (fread(table, esz, nframes, fin) != nframes) goto corrupt;
+
+    /* The frames must fill the space between the header and the table;
+       if they do not, this is the table of the last of several .wz files
+       joined with cat, and the whole body is streamed instead */
+    long long csum = 0;
+    for (uint32_t k = 0; k < nframes; k++) csum += read_le32(table + k * esz);
+    if (csum != fsize - tsize - data_start) {
+        free(table);
+        return wz_fseek(fin, data_start, SEEK_SET) == 0 ? 1 : -1;
     }
 
-    *in_bytes  = 11 + fnlen;
-    *out_bytes = 0;
+    if (!(dctx = make_dctx(h, label))) goto done;
+    unsigned long long pos = 0;
+    long long coff = data_start;
+    *in_bytes = (size_t)data_start;
+    for (uint32_t k = 0; k < nframes && !range_done(pos); k++) {
+        size_t csize = read_le32(table + k * esz), dsize = read_le32(table + k * esz + 4);
+        if (pos + dsize <= (unsigned long long)opt_range_off) {
+            pos += dsize;
+            coff += (long long)csize;
+            continue;
+        }
+        if (csize > ccap) {
+            free(cbuf);
+            if (!(cbuf = malloc(ccap = csize))) goto oom;
+        }
+        if (dsize > dcap) {
+            free(dbuf);
+            if (!(dbuf = malloc(dcap = dsize))) goto oom;
+        }
+        if (wz_fseek(fin, coff, SEEK_SET) != 0 || fread(cbuf, 1, csize, fin) != csize) {
+            fprintf(stderr, "wunzip: %s: read error\n", label);
+            goto done;
+        }
+        *in_bytes += csize;
+        coff += (long long)csize;
+        size_t r = ZSTD_decompressDCtx(dctx, dbuf, dsize, cbuf, csize);
+        if (ZSTD_isError(r) || r != dsize) {
+            fprintf(stderr, "wunzip: %s: frame %u: %s\n", label, k,
+                    ZSTD_isError(r) ? ZSTD_getErrorName(r) : "size does not match the seek table");
+            goto done;
+        }
+        if (emit(fout, dbuf, dsize, &pos) != 0) goto done;
+    }
+    *out_bytes = (size_t)pos;
+    rc = 0;
+    goto done;
 
-    ZSTD_DStream *dstream = ZSTD_createDStream();
-    if (!dstream) { fprintf(stderr, "wunzip: out of memory\n"); return -1; }
-    ZSTD_initDStream(dstream);
+corrupt:
+    fprintf(stderr, "wunzip: %s: corrupt seek table\n", label);
+    goto done;
+oom:
+    fprintf(stderr, "wunzip: out of memory\n");
+done:
+    free(table); free(cbuf); free(dbuf);
+    ZSTD_freeDCtx(dctx);
+    return rc;
+}
+
+/* Stream the frames after a header through emit() on this thread. The
+   first npre bytes are taken from pre, already read (and counted) by the
+   caller; *out_bytes is the output offset to carry on from. */
+/* Returns 0, -1 on an error, or 2 when another .wz header follows a
+   frame: the input from there on is then left in a malloc'd *rest. */
+static int decompress_body(FILE *fin, FILE *fout, const WzHeader *h, const char *label,
+                           const uint8_t *pre, size_t npre, uint8_t **rest, size_t *nrest,
+                           size_t *in_bytes, size_t *out_bytes)
+{
+    ZSTD_DCtx *dctx = make_dctx(h, label);
+    if (!dctx) return -1;
+    size_t r;
 
     uint8_t *ibuf = malloc(CHUNK);
     uint8_t *obuf = malloc(ZSTD_DStreamOutSize());
     if (!ibuf || !obuf) {
-        free(ibuf); free(obuf); ZSTD_freeDStream(dstream);
+        free(ibuf); free(obuf); ZSTD_freeDCtx(dctx);
         fprintf(stderr, "wunzip: out of memory\n");
         return -1;
     }
@@ -249,49 +880,226 @@ static int decompress_stream(FILE *fin, FILE *fout,
 
     int rc = 0;
     size_t nr;
-    while ((nr = fread(ibuf, 1, CHUNK, fin)) > 0) {
-        *in_bytes += nr;
-        ZSTD_inBuffer in_buf = { ibuf, nr, 0 };
-        while (in_buf.pos < in_buf.size) {
-            ZSTD_outBuffer out_buf = { obuf, obufsz, 0 };
-            size_t r = ZSTD_decompressStream(dstream, &out_buf, &in_buf);
-            if (ZSTD_isError(r)) {
-                fprintf(stderr, "wunzip: decompress error: %s\n", ZSTD_getErrorName(r));
-                rc = -1; goto done;
+    unsigned long long pos = *out_bytes;
+    r = 0;                      /* 0: between frames */
+    while (!range_done(pos)) {
+        ZSTD_inBuffer in_buf = { pre, npre, 0 };
+        if (npre) {
+            npre = 0;
+        } else {
+            if ((nr = fread(ibuf, 1, CHUNK, fin)) == 0) break;
+            *in_bytes += nr;
+            in_buf.src  = ibuf;
+            in_buf.size = nr;
+        }
+        while (in_buf.pos < in_buf.size && !range_done(pos)) {
+            const uint8_t *at = (const uint8_t *)in_buf.src + in_buf.pos;
+            size_t left = in_buf.size - in_buf.pos;
+            if (r == 0 && left < 4) {
+                /* Too little to tell a frame from a header: read on */
+                memmove(ibuf, at, left);
+                nr = fread(ibuf + left, 1, CHUNK - left, fin);
+                *in_bytes += nr;
+                in_buf.src  = ibuf;
+                in_buf.size = left + nr;
+                in_buf.pos  = 0;
+                at = ibuf;
+                left += nr;
             }
-            if (out_buf.pos) {
-                if (fout && fwrite(obuf, 1, out_buf.pos, fout) != out_buf.pos) {
-                    fprintf(stderr, "wunzip: write error: %s\n", strerror(errno));
+            if (r == 0 && left >= 4 && is_wz_magic(at)) {
+                if (!(*rest = malloc(left))) {
+                    fprintf(stderr, "wunzip: out of memory\n");
                     rc = -1; goto done;
                 }
-                *out_bytes += out_buf.pos;
+                memcpy(*rest, at, left);
+                *nrest = left;
+                rc = 2; goto done;
+            }
+            ZSTD_outBuffer out_buf = { obuf, obufsz, 0 };
+            r = ZSTD_decompressStream(dctx, &out_buf, &in_buf);
+            if (ZSTD_getErrorCode(r) == ZSTD_error_frameParameter_windowTooLarge) {
+                if (h->wlog)
+                    fprintf(stderr, "wunzip: %s: needs a %llu MB window, over the "
+                            "--memory limit\n", label, (1ULL << h->wlog) >> 20);
+                else
+                    fprintf(stderr, "wunzip: %s: window too large; raise the limit "
+                            "with --memory=SIZE\n", label);
+                rc = -1; goto done;
             }
+            if (ZSTD_isError(r)) {
+                fprintf(stderr, "wunzip: %s: decompress error: %s\n",
+                        label, ZSTD_getErrorName(r));
+                rc = -1; goto done;
+            }
+            if (emit(fout, obuf, out_buf.pos, &pos) != 0) { rc = -1; goto done; }
         }
     }
+    *out_bytes = (size_t)pos;
     if (ferror(fin)) {
-        fprintf(stderr, "wunzip: read error: %s\n", strerror(errno));
+        fprintf(stderr, "wunzip: %s: read error: %s\n", label, strerror(errno));
+        rc = -1;
+    } else if (r != 0 && !range_done(pos)) {
+        fprintf(stderr, "wunzip: %s: unexpected end of file\n", label);
         rc = -1;
     }
 
 done:
+    *out_bytes = (size_t)pos;
     free(ibuf); free(obuf);
-    ZSTD_freeDStream(dstream);
+    ZSTD_freeDCtx(dctx);
+    return rc;
+}
+
+/*
+ * -T N decompression: frames are located in a PAR_CBUF window of input
+ * with ZSTD_findFrameCompressedSize, decoded one-shot on the frame pool
+ * (up to PAR_BATCH per thread and PAR_DMAX of output at a time) and
+ * written in order. A frame that does not fit, or whose size the header
+ * does not give, is left with the rest of the input to decompress_body.
+ */
+static int par_decompress(FILE *fin, FILE *fout, const WzHeader *h, const char *label,
+                          const uint8_t *pre, size_t npre, uint8_t **rest, size_t *nrest,
+                          size_t *in_bytes, size_t *out_bytes)
+{
+    int nthreads = opt_threads > THREADS_MAX ? THREADS_MAX : opt_threads;
+    long batch = (long)nthreads * PAR_BATCH;
+    FramePool pool = { 0 };
+    uint8_t *cbuf = malloc(PAR_CBUF);
+    size_t clen = 0;
+    unsigned long long pos = *out_bytes;
+    int eof = 0, rc = -1;
+
+    pool.f    = calloc((size_t)batch, sizeof(SeekFrame));
+    pool.dctx = calloc((size_t)nthreads, sizeof(ZSTD_DCtx *));
+    if (!cbuf || !pool.f || !pool.dctx) goto oom;
+    for (int t = 0; t < nthreads; t++)
+        if (!(pool.dctx[t] = make_dctx(h, label))) goto done;
+    memcpy(cbuf, pre, npre);
+    clen = npre;
+
+    for (;;) {
+        if (!eof) {
+            size_t nr = fread(cbuf + clen, 1, PAR_CBUF - clen, fin);
+            if (ferror(fin)) {
+                fprintf(stderr, "wunzip: %s: read error: %s\n", label, strerror(errno));
+                goto done;
+            }
+            eof = clen + nr < PAR_CBUF;
+            clen += nr;
+            *in_bytes += nr;
+        }
+        if (clen == 0) break;
+
+        size_t at = 0, dsum = 0;
+        int joined = 0;         /* another .wz header at cbuf + at */
+        pool.nf = 0;
+        while (pool.nf < batch && at < clen) {
+            if (clen - at >= 4 && is_wz_magic(cbuf + at)) { joined = 1; break; }
+            size_t csize = ZSTD_findFrameCompressedSize(cbuf + at, clen - at);
+            if (ZSTD_isError(csize)) break;
+            unsigned long long dsize = ZSTD_getFrameContentSize(cbuf + at, csize);
+            if (dsize >= ZSTD_CONTENTSIZE_ERROR || dsum + dsize > PAR_DMAX) break;
+            SeekFrame *f = &pool.f[pool.nf++];
+            if (dsize > f->outcap || !f->out) {
+                free(f->out);
+                f->outcap = 0;
+                if (!(f->out = malloc(dsize ? (size_t)dsize : 1))) goto oom;
+                f->outcap = (size_t)dsize;
+            }
+            f->in    = cbuf + at;
+            f->inlen = csize;
+            at   += csize;
+            dsum += (size_t)dsize;
+        }
+        if (pool.nf == 0 && !joined) {
+            /* Too big, unsized, truncated or corrupt: let the streaming
+               decoder take it from here, and report any error */
+            *out_bytes = (size_t)pos;
+            rc = decompress_body(fin, fout, h, label, cbuf, clen, rest, nrest,
+                                 in_bytes, out_bytes);
+            goto done;
+        }
+
+        frame_run(&pool, nthreads);
+        for (long i = 0; i < pool.nf; i++) {
+            SeekFrame *f = &pool.f[i];
+            if (ZSTD_isError(f->outlen)) {
+                fprintf(stderr, "wunzip: %s: decompress error: %s\n",
+                        label, ZSTD_getErrorName(f->outlen));
+                goto done;
+            }
+            if (emit(fout, f->out, f->outlen, &pos) != 0) goto done;
+        }
+        if (range_done(pos)) break;
+        if (joined) {
+            if (!(*rest = malloc(clen - at))) goto oom;
+            memcpy(*rest, cbuf + at, clen - at);
+            *nrest = clen - at;
+            *out_bytes = (size_t)pos;
+            rc = 2;
+            goto done;
+        }
+        memmove(cbuf, cbuf + at, clen - at);
+        clen -= at;
+    }
+    *out_bytes = (size_t)pos;
+    rc = 0;
+    goto done;
+
+oom:
+    fprintf(stderr, "wunzip: out of memory\n");
+done:
+    if (pool.f)
+        for (long i = 0; i < batch; i++) free(pool.f[i].out);
+    if (pool.dctx)
+        for (int t = 0; t < nthreads; t++) ZSTD_freeDCtx(pool.dctx[t]);
+    free(pool.f);
+    free(pool.dctx);
+    free(cbuf);
+    return rc;
+}
+
+/* The body after the header h, and the body of every .wz file joined on
+   after it; each joined header brings its own dictionary and window. */
+static int decompress_frames(FILE *fin, FILE *fout, const WzHeader *h, const char *label,
+                             size_t *in_bytes, size_t *out_bytes)
+{
+    WzHeader cur = *h;
+    uint8_t *pre = NULL;
+    size_t npre = 0;
+    int rc;
+    for (;;) {
+        uint8_t *rest = NULL;
+        size_t nrest = 0;
+        rc = opt_threads > 1
+           ? par_decompress(fin, fout, &cur, label, pre, npre, &rest, &nrest,
+                            in_bytes, out_bytes)
+           : decompress_body(fin, fout, &cur, label, pre, npre, &rest, &nrest,
+                             in_bytes, out_bytes);
+        free(pre);
+        pre = rest;
+        npre = nrest;
+        if (rc != 2) break;
+        if (next_header(fin, &cur, label, &pre, &npre, in_bytes) != 0) { rc = -1; break; }
+    }
+    free(pre);
     return rc;
 }
 
 /* ── compress a named file ───────────────────────────────── */
-static void compress_file(const char *path)
+/* Returns 0 or 1 (error). cctx, nthreads and m as for compress_stream. */
+static int compress_file(const char *path, ZSTD_CCtx *cctx, int nthreads, MsgBuf *m)
 {
     struct stat st;
     if (stat(path, &st) != 0) {
-        fprintf(stderr, "wzip: %s: %s\n", path, strerror(errno));
-        g_rc = 1; return;
+        say(m, "wzip: %s: %s\n", path, strerror(errno));
+        return 1;
     }
     if (S_ISDIR(st.st_mode)) {
         if (!opt_recursive)
-            fprintf(stderr, "wzip: %s: is a directory (use -r)\n", path);
+            say(m, "wzip: %s: is a directory (use -r)\n", path);
         /* recursive case handled by caller */
-        return;
+        return 0;
     }
 
     /* Build output path */
@@ -302,19 +1110,19 @@ static void compress_file(const char *path)
     } else {
         if (snprintf(outpath, sizeof(outpath), "%s%s", path, WZ_EXT)
                 >= (int)sizeof(outpath)) {
-            fprintf(stderr, "wzip: %s: path too long\n", path);
-            g_rc = 1; return;
+            say(m, "wzip: %s: path too long\n", path);
+            return 1;
         }
         if (!opt_force && access(outpath, 0) == 0) {
-            fprintf(stderr, "wzip: %s: already exists\n", outpath);
-            g_rc = 1; return;
+            say(m, "wzip: %s: already exists\n", outpath);
+            return 1;
         }
     }
 
     FILE *fin = fopen(path, "rb");
     if (!fin) {
-        fprintf(stderr, "wzip: %s: %s\n", path, strerror(errno));
-        g_rc = 1; return;
+        say(m, "wzip: %s: %s\n", path, strerror(errno));
+        return 1;
     }
 
     FILE *fout;
@@ -326,8 +1134,8 @@ static void compress_file(const char *path)
     } else {
         fout = fopen(outpath, "wb");
         if (!fout) {
-            fprintf(stderr, "wzip: %s: %s\n", outpath, strerror(errno));
-            fclose(fin); g_rc = 1; return;
+            say(m, "wzip: %s: %s\n", outpath, strerror(errno));
+            fclose(fin); return 1;
         }
     }
 
@@ -335,23 +1143,25 @@ static void compress_file(const char *path)
     uint32_t mtime = (uint32_t)st.st_mtime;
     size_t in_b = 0, out_b = 0;
 
-    int r = compress_stream(fin, fout, bname, mtime, &in_b, &out_b);
+    int r = compress_stream(fin, fout, bname, mtime, cctx, nthreads, m,
+                            &in_b, &out_b);
     fclose(fin);
     if (!opt_stdout) fclose(fout);
 
     if (r != 0) {
         if (!opt_stdout) remove(outpath);
-        g_rc = 1; return;
+        return 1;
     }
 
     if (opt_verbose) {
         double pct = in_b > 0 ? (1.0 - (double)out_b / in_b) * 100.0 : 0.0;
-        fprintf(stderr, "%s: %.1f%% (%.0f -> %.0f bytes)\n",
+        say(m, "%s: %.1f%% (%.0f -> %.0f bytes)\n",
                 path, pct, (double)in_b, (double)out_b);
     }
 
     if (!opt_keep && !opt_stdout)
         remove(path);
+    return 0;
 }
 
 /* ── decompress a named file ─────────────────────────────── */
@@ -368,12 +1178,13 @@ static void decompress_file(const char *path)
         g_rc = 1; return;
     }
 
-    /* Peek at header to get original filename */
-    char orig_name[256] = "";
-    uint32_t mtime = 0;
+    /* The header gives the original name, which names the output */
+    WzHeader h;
     size_t in_b = 0, out_b = 0;
+    if (read_header(fin, &h, path, &in_b) != 0) {
+        fclose(fin); g_rc = 1; return;
+    }
 
-    /* Determine output path before we start streaming */
     FILE *fout = NULL;
     char outpath[4096] = "";
 
@@ -385,39 +1196,19 @@ static void decompress_file(const char *path)
 #endif
         fout = stdout;
     } else {
-        /* We need to read the header first to get the original name.
-         * Open a temp file or read header then seek back? Instead,
-         * read header, build outpath, then stream rest. */
-        /* peek-read the header to get orig_name */
-        uint8_t hdr[11];
-        if (fread(hdr, 1, 11, fin) != 11 ||
-            hdr[0] != WZ_MAGIC0 || hdr[1] != WZ_MAGIC1 ||
-            hdr[2] != WZ_MAGIC2 || hdr[3] != WZ_MAGIC3) {
-            fprintf(stderr, "wunzip: %s: not a .wz file\n", path);
-            fclose(fin); g_rc = 1; return;
-        }
-        uint8_t fnlen = hdr[10];
-        mtime = read_le32(hdr + 6);
-        if (fnlen > 0) {
-            if (fread(orig_name, 1, fnlen, fin) != (size_t)fnlen) {
-                fprintf(stderr, "wunzip: %s: truncated header\n", path);
-                fclose(fin); g_rc = 1; return;
-            }
-            orig_name[fnlen] = '\0';
-        }
-        in_b = 11 + fnlen;
-
-        /* Build output path from original name or strip .wz */
-        if (orig_name[0]) {
-            snprintf(outpath, sizeof(outpath), "%s", orig_name);
+        /* Build output path from original name, next to the input, or
+           strip .wz */
+        if (h.name[0]) {
+            int dlen = (int)(basename_of(path) - path);
+            snprintf(outpath, sizeof(outpath), "%.*s%s", dlen, path,
+                     basename_of(h.name));
         } else {
-            /* strip .wz */
             size_t n = strlen(path);
             if (n - WZ_EXT_LEN >= sizeof(outpath)) {
                 fprintf(stderr, "wunzip: path too long\n");
                 fclose(fin); g_rc = 1; return;
             }
-            strncpy(outpath, path, n - WZ_EXT_LEN);
+            memcpy(outpath, path, n - WZ_EXT_LEN);
             outpath[n - WZ_EXT_LEN] = '\0';
         }
 
@@ -430,67 +1221,21 @@ static void decompress_file(const char *path)
             fprintf(stderr, "wunzip: %s: %s\n", outpath, strerror(errno));
             fclose(fin); g_rc = 1; return;
         }
-
-        /* Now decompress the remaining stream (header already consumed) */
-        ZSTD_DStream *dstream = ZSTD_createDStream();
-        if (!dstream) { fclose(fin); fclose(fout); g_rc = 1; return; }
-        ZSTD_initDStream(dstream);
-
-        uint8_t *ibuf = malloc(CHUNK);
-        uint8_t *obuf = malloc(ZSTD_DStreamOutSize());
-        if (!ibuf || !obuf) {
-            free(ibuf); free(obuf);
-            ZSTD_freeDStream(dstream);
-            fclose(fin); fclose(fout);
-            fprintf(stderr, "wunzip: out of memory\n");
-            g_rc = 1; return;
-        }
-        size_t obufsz = ZSTD_DStreamOutSize();
-        int rc_d = 0;
-        size_t nr;
-        while ((nr = fread(ibuf, 1, CHUNK, fin)) > 0) {
-            in_b += nr;
-            ZSTD_inBuffer ib = { ibuf, nr, 0 };
-            while (ib.pos < ib.size) {
-                ZSTD_outBuffer ob = { obuf, obufsz, 0 };
-                size_t r2 = ZSTD_decompressStream(dstream, &ob, &ib);
-                if (ZSTD_isError(r2)) {
-                    fprintf(stderr, "wunzip: %s: decompress error: %s\n",
-                            path, ZSTD_getErrorName(r2));
-                    rc_d = -1; goto done_file;
-                }
-                if (ob.pos) {
-                    if (fwrite(obuf, 1, ob.pos, fout) != ob.pos) {
-                        fprintf(stderr, "wunzip: write error: %s\n", strerror(errno));
-                        rc_d = -1; goto done_file;
-                    }
-                    out_b += ob.pos;
-                }
-            }
-        }
-        done_file:
-        free(ibuf); free(obuf);
-        ZSTD_freeDStream(dstream);
-        fclose(fin);
-        fclose(fout);
-
-        if (rc_d != 0) { remove(outpath); g_rc = 1; return; }
-
-        if (opt_verbose) {
-            double pct = out_b > 0 ? (1.0 - (double)in_b / out_b) * 100.0 : 0.0;
-            fprintf(stderr, "%s: %.1f%% (%.0f -> %.0f bytes)\n",
-                    path, pct, (double)in_b, (double)out_b);
-        }
-        if (!opt_keep) remove(path);
-        return;
     }
 
-    /* test or stdout path: use decompress_stream which handles header internally */
-    rewind(fin);
-    int r = decompress_stream(fin, fout, orig_name, sizeof(orig_name),
-                               &mtime, &in_b, &out_b);
+    int r = 1;
+    if (opt_range_off >= 0)
+        r = seek_range(fin, fout, &h, path, (long long)in_b, &in_b, &out_b);
+    if (r == 1)
+        r = decompress_frames(fin, fout, &h, path, &in_b, &out_b);
     fclose(fin);
-
+    if (outpath[0]) {
+        if (fclose(fout) != 0 && r == 0) {
+            fprintf(stderr, "wunzip: %s: %s\n", outpath, strerror(errno));
+            r = -1;
+        }
+        if (r != 0) remove(outpath);
+    }
     if (r != 0) { g_rc = 1; return; }
 
     if (opt_verbose) {
@@ -514,7 +1259,8 @@ static void compress_stdin(void)
     _setmode(_fileno(stdout), _O_BINARY);
 #endif
     size_t in_b = 0, out_b = 0;
-    if (compress_stream(stdin, stdout, NULL, 0, &in_b, &out_b) != 0)
+    if (compress_stream(stdin, stdout, NULL, 0, NULL, opt_threads, NULL,
+                        &in_b, &out_b) != 0)
         g_rc = 1;
 }
 
@@ -524,42 +1270,304 @@ static void decompress_stdin(void)
     _setmode(_fileno(stdin),  _O_BINARY);
     _setmode(_fileno(stdout), _O_BINARY);
 #endif
-    char orig_name[256];
-    uint32_t mtime = 0;
+    WzHeader h;
     size_t in_b = 0, out_b = 0;
-    if (decompress_stream(stdin, stdout, orig_name, sizeof(orig_name),
-                           &mtime, &in_b, &out_b) != 0)
+    if (read_header(stdin, &h, "stdin", &in_b) != 0 ||
+        decompress_frames(stdin, opt_test ? NULL : stdout, &h, "stdin", &in_b, &out_b) != 0)
         g_rc = 1;
 }
 
 /* ── recursive directory walk ────────────────────────────── */
+typedef struct {
+    char **v;
+    int    n, cap;
+} PathList;
+
+static int path_push(PathList *l, const char *path)
+{
+    if (l->n == l->cap) {
+        int nc = l->cap ? l->cap * 2 : 64;
+        char **nv = realloc(l->v, (size_t)nc * sizeof(char *));
+        if (!nv) return -1;
+        l->v = nv; l->cap = nc;
+    }
+    if (!(l->v[l->n] = strdup(path))) return -1;
+    l->n++;
+    return 0;
+}
+
+static int cmp_name(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Append the files under dir to l, each directory in name order */
+static void walk_dir(const char *dir, PathList *l)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "wzip: %s: %s\n", dir, strerror(errno));
+        g_rc = 1; return;
+    }
+    PathList names = { 0 };
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+        if (path_push(&names, ent->d_name) != 0) {
+            fprintf(stderr, "wzip: out of memory\n");
+            g_rc = 1; break;
+        }
+    }
+    closedir(d);
+    qsort(names.v, (size_t)names.n, sizeof(char *), cmp_name);
+
+    for (int i = 0; i < names.n; i++) {
+        char full[4096];
 #ifdef _WIN32
-static void walk_dir(const char *dir)
+        snprintf(full, sizeof(full), "%s\\%s", dir, names.v[i]);
+#else
+        snprintf(full, sizeof(full), "%s/%s", dir, names.v[i]);
+#endif
+        struct stat st;
+        if (stat(full, &st) == 0 && S_ISDIR(st.st_mode)) {
+            walk_dir(full, l);
+        } else if (opt_decompress || opt_test ? has_wz_suffix(names.v[i]) || opt_force
+                                              : !has_wz_suffix(names.v[i])) {
+            if (path_push(l, full) != 0) {
+                fprintf(stderr, "wzip: out of memory\n");
+                g_rc = 1; break;
+            }
+        }
+        free(names.v[i]);
+    }
+    free(names.v);
+}
+
+/* ── parallel -r compression ─────────────────────────────── */
+/*
+ * With -T N and several files, whole files are compressed on N threads,
+ * each reusing one CCtx with a single zstd worker, so jobs are cut as in
+ * a -T 1 run and the output is the same for any N. A file's messages
+ * are kept in its FileJob and printed in list order after each batch.
+ * Files of PAR_FILE_BIG or more are left to the main thread, which runs
+ * them one at a time on all N zstd workers as usual.
+ */
+typedef struct {
+    const char *path;
+    MsgBuf      msg;
+    int         rc;
+    int         big;
+} FileJob;
+
+typedef struct {
+    FileJob       *j;
+    long           nj;
+    volatile long  next;
+    volatile long  slot;
+    ZSTD_CCtx    **cctx;        /* one per thread */
+} FilePool;
+
+static void file_worker(void *arg)
+{
+    FilePool *p = (FilePool *)arg;
+    ZSTD_CCtx *cctx = p->cctx[__sync_fetch_and_add(&p->slot, 1)];
+    for (;;) {
+        long i = __sync_fetch_and_add(&p->next, 1);
+        if (i >= p->nj) break;
+        FileJob *f = &p->j[i];
+        if (!f->big) f->rc = compress_file(f->path, cctx, 1, &f->msg);
+    }
+}
+
+static void compress_files(char **paths, int n)
+{
+    int nthreads = opt_threads > THREADS_MAX ? THREADS_MAX : opt_threads;
+    FileJob *jobs = calloc(PAR_FILES, sizeof(FileJob));
+    FilePool pool = { 0 };
+    pool.cctx = calloc((size_t)nthreads, sizeof(ZSTD_CCtx *));
+    if (!jobs || !pool.cctx) goto oom;
+    for (int t = 0; t < nthreads; t++)
+        if (!(pool.cctx[t] = ZSTD_createCCtx())) goto oom;
+    pool.j = jobs;
+
+    for (int at = 0; at < n; at += PAR_FILES) {
+        long nj = n - at < PAR_FILES ? n - at : PAR_FILES, nsmall = 0;
+        for (long i = 0; i < nj; i++) {
+            struct stat st;
+            jobs[i].path = paths[at + i];
+            jobs[i].rc   = 0;
+            jobs[i].msg.len = 0;
+            jobs[i].big  = stat(jobs[i].path, &st) == 0 && st.st_size >= PAR_FILE_BIG;
+            nsmall += !jobs[i].big;
+        }
+        pool.nj   = nj;
+        pool.next = 0;
+        pool.slot = 0;
+        run_threads(file_worker, &pool, nsmall < nthreads ? (int)nsmall : nthreads);
+        for (long i = 0; i < nj; i++)
+            if (jobs[i].big)
+                jobs[i].rc = compress_file(jobs[i].path, pool.cctx[0], opt_threads,
+                                           &jobs[i].msg);
+
+        for (long i = 0; i < nj; i++) {
+            fwrite(jobs[i].msg.buf, 1, jobs[i].msg.len, stderr);
+            g_rc |= jobs[i].rc;
+        }
+    }
+    goto done;
+
+oom:
+    fprintf(stderr, "wzip: out of memory\n");
+    g_rc = 1;
+done:
+    if (pool.cctx)
+        for (int t = 0; t < nthreads; t++) ZSTD_freeCCtx(pool.cctx[t]);
+    if (jobs)
+        for (int i = 0; i < PAR_FILES; i++) free(jobs[i].msg.buf);
+    free(pool.cctx);
+    free(jobs);
+}
+
+/* ── dictionaries ────────────────────────────────────────── */
+/* Read up to max bytes of path into a malloc'd buffer */
+static uint8_t *load_file(const char *path, size_t max, size_t *size)
 {
-    char pattern[4096];
-    snprintf(pattern, sizeof(pattern), "%s\\*", dir);
-    WIN32_FIND_DATAA fd;
-    HANDLE h = FindFirstFileA(pattern, &fd);
-    if (h == INVALID_HANDLE_VALUE) return;
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "wzip: %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    size_t cap = 0, n = 0, nr;
+    uint8_t *buf = NULL;
     do {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, "..")) continue;
-        char full[4096];
-        snprintf(full, sizeof(full), "%s\\%s", dir, fd.cFileName);
-        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            walk_dir(full);
+        if (n == cap) {
+            cap = cap ? cap * 2 : CHUNK;
+            uint8_t *nb = realloc(buf, cap);
+            if (!nb) {
+                fprintf(stderr, "wzip: out of memory\n");
+                free(buf); fclose(f);
+                return NULL;
+            }
+            buf = nb;
+        }
+        nr = fread(buf + n, 1, (cap < max ? cap : max) - n, f);
+        n += nr;
+    } while (nr > 0 && n < max);
+    if (ferror(f)) {
+        fprintf(stderr, "wzip: %s: read error: %s\n", path, strerror(errno));
+        free(buf); fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = n;
+    return buf;
+}
+
+/* Digest the -D files: one CDict for compression (the last -D), or a
+   DDict per file for wunzip to choose from by ID */
+static int load_dicts(int decomp)
+{
+    const char *prog = decomp ? "wunzip" : "wzip";
+    if (decomp) {
+        g_ddicts    = calloc((size_t)opt_ndicts, sizeof(*g_ddicts));
+        g_ddict_ids = calloc((size_t)opt_ndicts, sizeof(*g_ddict_ids));
+        if (!g_ddicts || !g_ddict_ids) {
+            fprintf(stderr, "%s: out of memory\n", prog);
+            return -1;
+        }
+    }
+    for (int k = decomp ? 0 : opt_ndicts - 1; k < opt_ndicts; k++) {
+        size_t n;
+        uint8_t *buf = load_file(opt_dicts[k], (size_t)-1, &n);
+        if (!buf) return -1;
+        if (decomp) {
+            g_ddicts[k]    = ZSTD_createDDict(buf, n);
+            g_ddict_ids[k] = ZSTD_getDictID_fromDict(buf, n);
         } else {
-            if (opt_decompress) {
-                if (has_wz_suffix(fd.cFileName) || opt_force)
-                    decompress_file(full);
-            } else {
-                if (!has_wz_suffix(fd.cFileName))
-                    compress_file(full);
+            g_cdict   = ZSTD_createCDict(buf, n, opt_level);
+            g_dict_id = ZSTD_getDictID_fromDict(buf, n);
+        }
+        free(buf);
+        if (decomp ? !g_ddicts[k] : !g_cdict) {
+            fprintf(stderr, "%s: %s: cannot load dictionary\n", prog, opt_dicts[k]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* --train: each file (its first SAMPLE_MAX bytes) is one sample */
+static int train_dict(char **files, int nfiles)
+{
+    size_t total = 0, cap = 0;
+    uint8_t *samples = NULL;
+    size_t *sizes = malloc((size_t)(nfiles ? nfiles : 1) * sizeof(size_t));
+    int ns = 0, rc = 1;
+    if (!sizes) { fprintf(stderr, "wzip: out of memory\n"); return 1; }
+
+    for (int k = 0; k < nfiles; k++) {
+        size_t n;
+        uint8_t *buf = load_file(files[k], SAMPLE_MAX, &n);
+        if (!buf) { g_rc = 1; continue; }
+        if (total + n > cap) {
+            size_t nc = cap ? cap : (size_t)1 << 20;
+            while (nc < total + n) nc *= 2;
+            uint8_t *ns2 = realloc(samples, nc);
+            if (!ns2) {
+                fprintf(stderr, "wzip: out of memory\n");
+                free(buf);
+                goto done;
             }
+            samples = ns2; cap = nc;
         }
-    } while (FindNextFileA(h, &fd));
-    FindClose(h);
+        memcpy(samples + total, buf, n);
+        free(buf);
+        total += n;
+        sizes[ns++] = n;
+    }
+    if (ns == 0) {
+        fprintf(stderr, "wzip: --train needs sample files\n");
+        goto done;
+    }
+
+    void *dict = malloc((size_t)opt_maxdict);
+    if (!dict) { fprintf(stderr, "wzip: out of memory\n"); goto done; }
+    size_t dsize = ZDICT_trainFromBuffer(dict, (size_t)opt_maxdict, samples,
+                                         sizes, (unsigned)ns);
+    if (ZDICT_isError(dsize)) {
+        fprintf(stderr, "wzip: dictionary training failed: %s "
+                "(too few or too small samples?)\n", ZDICT_getErrorName(dsize));
+        free(dict);
+        goto done;
+    }
+    if (!opt_force && access(opt_output, 0) == 0) {
+        fprintf(stderr, "wzip: %s: already exists\n", opt_output);
+        free(dict);
+        goto done;
+    }
+    FILE *f = fopen(opt_output, "wb");
+    int werr = !f;
+    if (f) {
+        werr = fwrite(dict, 1, dsize, f) != dsize;
+        werr |= fclose(f) != 0;
+        if (werr) remove(opt_output);
+    }
+    if (werr) {
+        fprintf(stderr, "wzip: %s: %s\n", opt_output, strerror(errno));
+        free(dict);
+        goto done;
+    }
+    if (opt_verbose)
+        fprintf(stderr, "%s: %zu bytes, ID %u, from %d samples (%zu bytes)\n",
+                opt_output, dsize, ZDICT_getDictID(dict, dsize), ns, total);
+    free(dict);
+    rc = 0;
+
+done:
+    free(samples);
+    free(sizes);
+    return rc ? 1 : g_rc;
 }
-#endif
 
 /* ── usage / version ─────────────────────────────────────── */
 static void print_usage(int decomp)
@@ -580,6 +1588,18 @@ static void print_usage(int decomp)
     puts("  -t, --test          test integrity (decompress to null)");
     puts("  -r, --recursive     recurse into directories");
     puts("  -1 .. -19           compression level (default 3)");
+    puts("  --ultra             allow levels -20 .. -22 (more memory)");
+    puts("  --long[=WLOG]       long-distance matching, 2^WLOG window (default 27)");
+    puts("  --memory=SIZE       largest window to decompress (default: as recorded)");
+    puts("  -D DICT             use dictionary DICT (wunzip: several, chosen by ID)");
+    puts("  --train FILE... [-o DICT] [--maxdict=SIZE]");
+    puts("                      train a dictionary on sample files");
+    puts("  --seekable[=SIZE]   independent SIZE frames (1M) and a seek table");
+    puts("  --range=OFF[:LEN]   decompress LEN bytes from offset OFF to stdout");
+    puts("  -T, --threads=N     compress on N threads (0: one per core, the default)");
+    puts("  --job-size=SIZE     input per thread job, e.g. 32M (default: automatic)");
+    puts("  --adapt[=min=N,max=M]");
+    puts("                      adjust the level to the input and output speed");
     puts("  --help              show this help");
     puts("  --version           show version");
 }
@@ -601,7 +1621,11 @@ int main(int argc, char *argv[])
             opt_decompress = 1;
     }
 
-    int file_start = argc; /* index where non-option args begin */
+    /* Options may follow file names (--train FILE... -o DICT); "--" ends them */
+    char **files = malloc((size_t)argc * sizeof(char *));
+    opt_dicts = malloc((size_t)argc * sizeof(char *));
+    if (!files || !opt_dicts) { fprintf(stderr, "wzip: out of memory\n"); return 1; }
+    int nfiles = 0;
     int i;
     for (i = 1; i < argc; i++) {
         const char *a = argv[i];
@@ -614,14 +1638,96 @@ int main(int argc, char *argv[])
         if (strcmp(a, "--verbose")    == 0) { opt_verbose    = 1; continue; }
         if (strcmp(a, "--test")       == 0) { opt_test       = 1; continue; }
         if (strcmp(a, "--recursive")  == 0) { opt_recursive  = 1; continue; }
-        if (strcmp(a, "--")           == 0) { file_start = i + 1; break; }
+        if (strcmp(a, "--train")      == 0) { opt_train      = 1; continue; }
+        if (strcmp(a, "--")           == 0) {
+            while (++i < argc) files[nfiles++] = argv[i];
+            break;
+        }
 
-        if (a[0] == '-' && a[1] != '\0') {
-            /* Check for numeric level: -1 .. -19 */
+        const char *nthr = NULL;
+        if (strncmp(a, "--threads=", 10) == 0) {
+            nthr = a + 10;
+        } else if (strncmp(a, "--job-size=", 11) == 0) {
+            if (parse_size(a + 11, &opt_job_size) != 0) {
+                fprintf(stderr, "wzip: invalid size in '%s'\n", a);
+                return 1;
+            }
+            continue;
+        } else if (strncmp(a, "--maxdict=", 10) == 0) {
+            if (parse_size(a + 10, &opt_maxdict) != 0 || opt_maxdict < 256) {
+                fprintf(stderr, "wzip: invalid size in '%s'\n", a);
+                return 1;
+            }
+            continue;
+        } else if (strcmp(a, "--seekable") == 0 || strncmp(a, "--seekable=", 11) == 0) {
+            opt_frame_size = 1 << 20;
+            if (a[10] && (parse_size(a + 11, &opt_frame_size) != 0 ||
+                          opt_frame_size < 1024 || opt_frame_size > (1 << 30))) {
+                fprintf(stderr, "wzip: --seekable: frame size must be 1K..1G\n");
+                return 1;
+            }
+            continue;
+        } else if (strncmp(a, "--range=", 8) == 0) {
+            char buf[64], *colon;
+            snprintf(buf, sizeof(buf), "%s", a + 8);
+            if ((colon = strchr(buf, ':')) != NULL) *colon = '\0';
+            if (parse_size(buf, &opt_range_off) != 0 ||
+                (colon && colon[1] && parse_size(colon + 1, &opt_range_len) != 0)) {
+                fprintf(stderr, "wzip: invalid range '%s'\n", a + 8);
+                return 1;
+            }
+            opt_decompress = 1;
+            opt_stdout = 1;
+            continue;
+        } else if (strcmp(a, "--ultra") == 0) {
+            opt_ultra = 1;
+            continue;
+        } else if (strcmp(a, "--adapt") == 0 || strncmp(a, "--adapt=", 8) == 0) {
+            /* --adapt=min=N,max=M, either part optional */
+            const char *q = a[7] ? a + 8 : "";
+            opt_adapt = 1;
+            while (*q) {
+                int *dst = strncmp(q, "min=", 4) == 0 ? &opt_adapt_min
+                         : strncmp(q, "max=", 4) == 0 ? &opt_adapt_max : NULL;
+                char *end;
+                long v = dst ? strtol(q + 4, &end, 10) : 0;
+                if (!dst || end == q + 4 || (*end && *end != ',') || v < 1 || v > 22) {
+                    fprintf(stderr, "wzip: invalid --adapt '%s' (min=N,max=M, 1..22)\n",
+                            a + 8);
+                    return 1;
+                }
+                *dst = (int)v;
+                q = *end ? end + 1 : end;
+            }
+            continue;
+        } else if (strcmp(a, "--long") == 0 || strncmp(a, "--long=", 7) == 0) {
+            char *end;
+            long v = a[6] ? strtol(a + 7, &end, 10) : ZSTD_WINDOWLOG_LIMIT_DEFAULT;
+            if ((a[6] && (*end || end == a + 7)) ||
+                v < ZSTD_WINDOWLOG_MIN || v > ZSTD_WINDOWLOG_MAX) {
+                fprintf(stderr, "wzip: --long: window log must be %d..%d\n",
+                        ZSTD_WINDOWLOG_MIN, ZSTD_WINDOWLOG_MAX);
+                return 1;
+            }
+            opt_long = (int)v;
+            continue;
+        } else if (strncmp(a, "--memory=", 9) == 0) {
+            if (parse_size(a + 9, &opt_memory) != 0 || opt_memory == 0) {
+                fprintf(stderr, "wzip: invalid size in '%s'\n", a);
+                return 1;
+            }
+            continue;
+        } else if (a[0] == '-' && a[1] == '-' && a[2]) {
+            fprintf(stderr, "wzip: unrecognized option '%s'\n", a);
+            return 1;
+        }
+
+        if (!nthr && a[0] == '-' && a[1] != '\0') {
+            /* Check for numeric level: -1 .. -22, past 19 with --ultra */
             if (a[1] >= '1' && a[1] <= '9') {
                 char *end;
                 long lvl = strtol(a + 1, &end, 10);
-                if (*end == '\0' && lvl >= 1 && lvl <= 19) {
+                if (*end == '\0' && lvl >= 1 && lvl <= ZSTD_maxCLevel()) {
                     opt_level = (int)lvl;
                     continue;
                 }
@@ -638,25 +1744,67 @@ int main(int argc, char *argv[])
                     case 'v': opt_verbose    = 1; break;
                     case 't': opt_test       = 1; break;
                     case 'r': opt_recursive  = 1; break;
+                    case 'T': case 'D': case 'o': {
+                        const char *v = p[1] ? p + 1 : i + 1 < argc ? argv[++i] : NULL;
+                        if (!v) {
+                            fprintf(stderr, "wzip: option requires an argument -- '%c'\n", *p);
+                            return 1;
+                        }
+                        if (*p == 'T')      nthr = v;
+                        else if (*p == 'D') opt_dicts[opt_ndicts++] = v;
+                        else                opt_output = v;
+                        p += strlen(p) - 1;
+                        break;
+                    }
                     default:
                         fprintf(stderr, "wzip: invalid option -- '%c'\n", *p);
                         bad = 1; g_rc = 1;
                 }
                 p++;
             }
-            if (bad) continue;
+            if (bad || !nthr) continue;
+        }
+        if (nthr) {
+            char *end;
+            long v = strtol(nthr, &end, 10);
+            if (*end || end == nthr || v < 0) {
+                fprintf(stderr, "wzip: invalid number of threads '%s'\n", nthr);
+                return 1;
+            }
+            opt_threads = v > 256 ? 256 : (int)v;
             continue;
         }
 
-        /* First non-option arg */
-        file_start = i;
-        break;
+        files[nfiles++] = argv[i];
     }
 
     if (g_rc) return g_rc;
+    if ((opt_level > 19 || opt_adapt_max > 19) && !opt_ultra &&
+        !opt_decompress && !opt_test) {
+        fprintf(stderr, "wzip: levels above 19 need --ultra\n");
+        return 1;
+    }
+    if (opt_threads == 0) opt_threads = cpu_count();
+    if (opt_adapt) {
+        if (!opt_adapt_max) opt_adapt_max = opt_ultra ? 22 : 19;
+        if (opt_adapt_min > opt_adapt_max) {
+            fprintf(stderr, "wzip: --adapt: min is above max\n");
+            return 1;
+        }
+        if (opt_frame_size) {
+            fprintf(stderr, "wzip: --adapt does not apply to --seekable\n");
+            return 1;
+        }
+        if (opt_level < opt_adapt_min) opt_level = opt_adapt_min;
+        if (opt_level > opt_adapt_max) opt_level = opt_adapt_max;
+    }
+    if (opt_train)
+        return train_dict(files, nfiles);
+    if (opt_ndicts && load_dicts(opt_decompress || opt_test) != 0)
+        return 1;
 
     /* stdin / stdout pipe mode */
-    if (file_start >= argc) {
+    if (nfiles == 0) {
         if (opt_decompress || opt_test)
             decompress_stdin();
         else
@@ -664,24 +1812,34 @@ int main(int argc, char *argv[])
         return g_rc;
     }
 
-    /* Process each file argument */
-    for (i = file_start; i < argc; i++) {
-        const char *path = argv[i];
+    /* The file arguments, with -r directories expanded in place */
+    PathList list = { 0 };
+    for (i = 0; i < nfiles; i++) {
+        const char *path = files[i];
         struct stat st;
         if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
-#ifdef _WIN32
             if (opt_recursive)
-                walk_dir(path);
+                walk_dir(path, &list);
             else
-#endif
                 fprintf(stderr, "wzip: %s: is a directory (use -r)\n", path);
-            continue;
+        } else if (path_push(&list, path) != 0) {
+            fprintf(stderr, "wzip: out of memory\n");
+            return 1;
         }
-        if (opt_decompress || opt_test)
-            decompress_file(path);
-        else
-            compress_file(path);
     }
 
+    if (opt_decompress || opt_test) {
+        for (i = 0; i < list.n; i++) decompress_file(list.v[i]);
+    } else if (opt_threads > 1 && !opt_stdout && !opt_adapt && list.n > 1) {
+        compress_files(list.v, list.n);
+    } else {
+        ZSTD_CCtx *cctx = ZSTD_createCCtx();   /* NULL: one per file instead */
+        for (i = 0; i < list.n; i++)
+            g_rc |= compress_file(list.v[i], cctx, opt_threads, NULL);
+        ZSTD_freeCCtx(cctx);
+    }
+
+    for (i = 0; i < list.n; i++) free(list.v[i]);
+    free(list.v);
     return g_rc;
 }
@@ -0,0 +1,42 @@
+#pragma once
+/*
+ * basenc — block framework shared by base64 and base32
+ *
+ * A codec supplies its alphabet's decode table and two block kernels;
+ * the framework does the I/O in large blocks, line wrapping, whitespace,
+ * padding and garbage handling.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *name;       /* program name for messages */
+    int         bits;       /* bits per output character: 6 or 5 */
+    size_t      in_group;   /* bytes per encoded group: 3 or 5 */
+    size_t      out_group;  /* characters per encoded group: 4 or 8 */
+
+    /* Character -> value, 0xFF for characters outside the alphabet */
+    const unsigned char *dtab;
+
+    /*
+     * Encode n bytes to characters, padding the final partial group.
+     * Returns the number of characters written.
+     */
+    size_t (*encode)(const unsigned char *in, size_t n, char *out);
+
+    /*
+     * Decode whole groups from the start of in[0..n) until a group holds
+     * a character outside the alphabet (newline, '=', garbage). Sets
+     * *used to the characters consumed and returns the bytes written.
+     * out must have BASENC_DECODE_SLACK bytes of room past the result.
+     */
+    size_t (*decode)(const unsigned char *in, size_t n, unsigned char *out, size_t *used);
+} BaseCodec;
+
+/* SIMD kernels may store a full register past the last decoded byte */
+#define BASENC_DECODE_SLACK 32
+
+int basenc_encode(FILE *in, FILE *out, const BaseCodec *c, int wrap);
+int basenc_decode(FILE *in, FILE *out, const BaseCodec *c, bool ignore_garbage);
@@ -0,0 +1,21 @@
+#pragma once
+/*
+ * crc — CRC-32 for cksum
+ *
+ * Two bit orders of the 0x04C11DB7 polynomial:
+ *   crc_posix   MSB-first, as POSIX cksum defines it (cksum -a crc)
+ *   crc32b      LSB-first ISO-HDLC CRC of gzip/zlib/PNG (cksum -a crc32b)
+ * Both use slice-by-16 tables, or PCLMULQDQ folding when the CPU has it.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Raw register update; start from 0 and finish with crc_posix_final(),
+   which feeds in the message length and complements. */
+uint32_t crc_posix_update(uint32_t crc, const void *buf, size_t n);
+uint32_t crc_posix_final(uint32_t crc, uint64_t len);
+
+/* zlib convention: start from 0, the result is the finished CRC and can
+   be passed back in to continue. */
+uint32_t crc32b_update(uint32_t crc, const void *buf, size_t n);
@@ -0,0 +1,105 @@
+#pragma once
+/*
+ * digest — message digests shared by md5sum, the sha*sum tools and b2sum
+ *
+ * Each algorithm has a portable scalar implementation that serves as the
+ * reference. On x86-64 the compression function is picked once at run
+ * time: SHA-NI for SHA-1 and SHA-256, an AVX2 message schedule for
+ * SHA-384/512, and SSE4.1 or AVX2 rounds for BLAKE2b. SHA-224/256 also
+ * have an eight-lane AVX2 kernel for hashing many small messages at once.
+ *
+ * BLAKE2bp and BLAKE2sp are the standard BLAKE2 tree modes: the input is
+ * dealt block by block to 4 (8) BLAKE2b (BLAKE2s) leaves and a root hashes
+ * the leaf digests. On AVX2 all leaves advance together, one per lane, and
+ * digest_tree_feed() lets a caller split the leaves over threads.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    DIGEST_MD5,
+    DIGEST_SHA1,
+    DIGEST_SHA224,
+    DIGEST_SHA256,
+    DIGEST_SHA384,
+    DIGEST_SHA512,
+    DIGEST_BLAKE2B,
+    DIGEST_BLAKE2S,
+    DIGEST_BLAKE2BP,
+    DIGEST_BLAKE2SP
+} DigestAlgo;
+
+#define DIGEST_MAX_SIZE   64    /* bytes */
+#define DIGEST_MAX_BLOCK  128
+#define DIGEST_MAX_STRIPE 512   /* one block for every leaf of a tree mode */
+
+typedef union {
+    uint32_t w32[8];
+    uint64_t w64[8];
+} DigestWords;
+
+typedef struct {
+    DigestAlgo  algo;
+    size_t      size;           /* digest length in bytes */
+    size_t      block;          /* compression block size */
+    DigestWords h;
+    uint64_t    total;          /* bytes consumed so far (per leaf in tree modes) */
+    uint8_t     buf[DIGEST_MAX_STRIPE];
+    size_t      buflen;
+    size_t      keylen;         /* BLAKE2 key length; 0 = unkeyed */
+    /* Tree modes: leaf states stored word-major, leaf.w64[word][leaf], and
+       the last stripe fed, held back until more input shows it is not
+       the final block of each leaf */
+    union {
+        uint32_t w32[8][8];
+        uint64_t w64[8][4];
+    } leaf;
+    uint8_t     pend[DIGEST_MAX_STRIPE];
+    int         has_pend;
+} DigestCtx;
+
+/* Pick the kernels for this CPU. Called by digest_init; call it once
+   up front before hashing from several threads. */
+void digest_cpu_init(void);
+
+/* size is the digest length in bytes; 0 selects the algorithm's default.
+   Only the BLAKE2 family accepts other lengths (1..default). */
+void digest_init(DigestCtx *c, DigestAlgo algo, size_t size);
+/* BLAKE2 family only: keyed hashing (MAC) with a key of 1..default size
+   bytes; keylen 0 is the same as digest_init(). */
+void digest_init_key(DigestCtx *c, DigestAlgo algo, size_t size,
+                     const uint8_t *key, size_t keylen);
+void digest_update(DigestCtx *c, const void *data, size_t len);
+void digest_final(DigestCtx *c, uint8_t *out);
+
+/* Hash the rest of f into out with an initialised ctx; -1 on read error. */
+int digest_stream(FILE *f, DigestCtx *c, uint8_t *out);
+
+/*
+ * Hash n complete in-memory messages at their default digest size;
+ * out receives n digests back to back. Where digest_lanes() is above 1
+ * the messages are interleaved in SIMD lanes, which pays off for many
+ * small inputs such as source trees.
+ */
+void digest_many(DigestAlgo algo, size_t n, const uint8_t *const *msg,
+                 const size_t *len, uint8_t *out);
+int  digest_lanes(DigestAlgo algo);
+
+/*
+ * Tree modes: digest_leaves() is the leaf count (1 for other algorithms)
+ * and digest_stripe() the bytes that give every leaf one block. With
+ * nothing buffered (after whole-stripe updates), digest_tree_feed() hands
+ * n whole stripes to leaves first..first+count-1 only; calls for disjoint
+ * leaf ranges may run on different threads, and digest_tree_done(c, n)
+ * then completes the update once every leaf has been fed.
+ */
+int    digest_leaves(DigestAlgo algo);
+size_t digest_stripe(DigestAlgo algo);
+int    digest_tree_vector(DigestAlgo algo);    /* 1 if all leaves run in SIMD lanes */
+void   digest_tree_feed(DigestCtx *c, const uint8_t *p, size_t n, int first, int count);
+void   digest_tree_done(DigestCtx *c, size_t n);
+
+size_t      digest_default_size(DigestAlgo algo);
+const char *digest_tag(DigestAlgo algo);    /* "MD5", "SHA256", "BLAKE2b", "BLAKE2sp" */
@@ -0,0 +1,15 @@
+#pragma once
+/*
+ * sumtool — command-line driver shared by md5sum, sha*sum and b2sum
+ *
+ * Handles option parsing, hashing files or stdin, GNU and BSD (--tag)
+ * output, and -c verification of either format. The tool's main() only
+ * names itself and its algorithm.
+ */
+
+#include "digest.h"
+
+int sumtool_main(int argc, char **argv, const char *prog, DigestAlgo algo);
+
+/* cksum -a ALGO: argv without the -a option; tagged output by default */
+int sumtool_cksum(int argc, char **argv, DigestAlgo algo);
@@ -0,0 +1,14 @@
+#pragma once
+/*
+ * threads — a fork/join helper for the tools' worker pools
+ *
+ * Callers keep their work in a struct and have fn claim items from a
+ * shared counter (__sync_fetch_and_add), so every thread runs the same fn.
+ */
+
+#define THREADS_MAX 64    /* cap on any tool's thread count */
+
+/* Run fn(arg) on n threads, the calling one included, and return when all
+   of them have. If a thread cannot be started, the others pick up its
+   share. n is capped at THREADS_MAX; n <= 1 just calls fn(arg). */
+void run_threads(void (*fn)(void *), void *arg, int n);
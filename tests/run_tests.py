@@ -266,8 +266,9 @@ section('wc')
 
 with TempDir() as d:
     f = os.path.join(d, 'wc.txt')
-    with open(f, 'w') as fh:
-        fh.write('one two three\nfour five\n')
+    # binary so -c sees the same 24 bytes on Windows (no CRLF translation)
+    with open(f, 'wb') as fh:
+        fh.write(b'one two three\nfour five\n')
 
     out, _, code = run('wc', '-l', f)
     expect_exit('wc -l exits 0', code)
@@ -280,6 +281,46 @@ with TempDir() as d:
     # "one two three\nfour five\n" = 14 + 10 = 24 bytes
     expect_contains('wc -c byte count', out, '24')
 
+    # spans several 1 MB read blocks and the SIMD/scalar tail boundary
+    big = os.path.join(d, 'big.txt')
+    with open(big, 'wb') as fh:
+        fh.write(b'alpha beta\tgamma\r\n' * 200001 + b'tail')
+    out, _, _ = run('wc', big)
+    expect_eq('wc multi-block counts', out.split()[:3], ['200001', '600004', '3600022'])
+
+    out, _, _ = run('wc', '-l', stdin_text='a\nb\nc\n')
+    expect_eq('wc -l from stdin', out.strip(), '3')
+
+    # stdin already read past its first 6 bytes: only the rest counts
+    with open(f, 'rb') as fh:
+        fh.seek(6)
+        r = subprocess.run([exe('wc'), '-c'], stdin=fh, capture_output=True)
+    expect_eq('wc -c counts stdin from its offset', r.stdout.decode().strip(), '18')
+
+    out, _, _ = run('wc', '-L', f)
+    expect_contains('wc -L longest line', out, '13')
+
+    out, _, _ = run('wc', '-m', f)
+    expect_contains('wc -m char count', out, '24')
+
+    names = []
+    for k in range(5):
+        p = os.path.join(d, f'shard{k}.txt')
+        with open(p, 'wb') as fh:
+            fh.write(b'row\n' * (k + 1))
+        names.append(p)
+    out, _, _ = run('wc', '-l', '--parallel=3', *names)
+    lines = out.strip().splitlines()
+    expect_eq('wc --parallel keeps argument order',
+              [l.split()[0] for l in lines], ['1', '2', '3', '4', '5', '15'])
+
+    lst = os.path.join(d, 'list0')
+    with open(lst, 'wb') as fh:
+        fh.write(b'\0'.join(n.encode() for n in names[:2]) + b'\0')
+    out, _, code = run('wc', '-l', '--files0-from=' + lst)
+    expect_exit('wc --files0-from exits 0', code)
+    expect_contains('wc --files0-from total', out, '3 total')
+
 
 # ── sort ──────────────────────────────────────────────────────────────────────
 
@@ -330,6 +371,40 @@ with TempDir() as d:
     expect_contains('uniq -u only unique', out, 'cherry')
     expect_not_contains('uniq -u excludes duplicates', out, 'apple')
 
+    with open(f, 'w') as fh:
+        fh.write('x' * 10000 + 'a\n' + 'x' * 10000 + 'b\n')
+    out, _, _ = run('uniq', f)
+    expect_eq('uniq compares long lines in full', len(out.splitlines()), 2)
+
+    with open(f, 'w') as fh:
+        fh.write('1 Apple pie\n2 apple tart\n3 pear pie\n')
+    out, _, _ = run('uniq', '-c', '-i', '-f', '1', '-w', '5', f)
+    expect_eq('uniq -c -i -f -w', out.splitlines(),
+              ['      2 1 Apple pie', '      1 3 pear pie'])
+
+    out, _, _ = run('uniq', '-s2', f)
+    expect_eq('uniq -s skips characters', len(out.splitlines()), 3)
+
+    r = subprocess.run([exe('uniq'), '-z'], input=b'a\0a\0b\nc\0', capture_output=True)
+    expect_eq('uniq -z NUL-terminated records', r.stdout, b'a\0b\nc\0')
+
+    with open(f, 'w') as fh:
+        fh.write('b\na\nb\nc\na\nb\n')
+    out, _, _ = run('uniq', '--unsorted', '-c', f)
+    expect_eq('uniq --unsorted counts in first-seen order', out.splitlines(),
+              ['      3 b', '      2 a', '      1 c'])
+
+    out, _, _ = run('uniq', '--hash', '-u', f)
+    expect_eq('uniq --hash -u', out.splitlines(), ['c'])
+
+    with open(f, 'w') as fh:
+        fh.write(''.join('k%d\n' % (i % 5000) for i in range(40000)))
+    out, _, _ = run('uniq', '--unsorted', '-c', '--memory=64K', f)
+    lines = out.splitlines()
+    check('uniq --unsorted spills and merges in order',
+          len(lines) == 5000 and lines[0].split() == ['8', 'k0']
+          and lines[-1].split() == ['8', 'k4999'])
+
 
 # ── grep ──────────────────────────────────────────────────────────────────────
 
@@ -808,6 +883,30 @@ with TempDir() as d:
     expect_contains('cut -f2- includes field 2', out, 'two')
     expect_contains('cut -f2- includes field 3', out, 'three')
 
+    out, _, _ = run('cut', '-d:', '-f3,1', stdin_text='a:b:c:d\r\nnodelim\n')
+    expect_eq('cut -f3,1 in position order, CRLF stripped', out.splitlines(), ['a:c', 'nodelim'])
+
+    # longer than the old 8 KB line buffer and 4096-field cap
+    wide = ','.join(str(k) for k in range(1, 6001))
+    out, _, _ = run('cut', '-d,', '-f2,5999-', stdin_text=wide + '\n' + wide + '\n')
+    expect_eq('cut very wide line', out.splitlines(), ['2,5999,6000', '2,5999,6000'])
+
+    out, _, _ = run('cut', '-d:', '-f2', '--complement', f)
+    expect_eq('cut --complement drops one field', out.strip().splitlines(),
+              ['one:three', 'foo:baz'])
+
+    out, _, _ = run('cut', '-d:', '-f1,3', '--output-delimiter=, ', f)
+    expect_eq('cut --output-delimiter multi-byte', out.strip().splitlines(),
+              ['one, three', 'foo, baz'])
+
+    out, _, _ = run('cut', '-c1-2,4-5', '--output-delimiter=|', f)
+    expect_eq('cut -c ranges joined by --output-delimiter', out.strip().splitlines(),
+              ['on|:t', 'fo|:b'])
+
+    r = subprocess.run([exe('cut'), '-z', '-d:', '-f2'], input=b'a:b\nc\0d:e\0',
+                       capture_output=True)
+    expect_eq('cut -z NUL-terminated records', r.stdout, b'b\nc\0e\0')
+
 
 # ── tr ────────────────────────────────────────────────────────────────────────
 
@@ -833,6 +932,18 @@ expect_eq('tr -s squeeze spaces', out.strip(), 'too many spaces')
 out, _, _ = run('tr', '-d', '\n', stdin_text='line1\nline2\n')
 expect_eq('tr -d newlines', out, 'line1line2')
 
+r = subprocess.run([exe('tr'), '-d', '\\r'], input=b'a\r\nb\r\n' * 50000,
+                   capture_output=True)
+expect_eq('tr -d \\r across blocks', r.stdout, b'a\nb\n' * 50000)
+
+r = subprocess.run([exe('tr'), 'A-Z', 'a-z'], input=bytes(range(256)) * 5000,
+                   capture_output=True)
+expect_eq('tr A-Z a-z on every byte value', r.stdout,
+          bytes(range(256)).lower() * 5000)
+
+out, _, _ = run('tr', '-s', 'a-z', 'A-Z', stdin_text='aabbcc\n' * 30000)
+expect_eq('tr -s translate and squeeze', out, 'ABC\n' * 30000)
+
 
 # ── find ──────────────────────────────────────────────────────────────────────
 
@@ -997,6 +1108,15 @@ decoded, _, _ = run('base64', '-d', stdin_text=encoded.strip())
 check('base64 roundtrip', decoded.strip() == 'winix')
 out, _, _ = run('base64', '--version')
 check('base64 --version', 'base64' in out and 'Winix' in out)
+# Multi-block roundtrip of every byte value, wrapped at 76
+blob = bytes(range(256)) * 8000
+r = subprocess.run([exe('base64')], input=blob, capture_output=True)
+rows = r.stdout.split(b'\n')
+check('base64 wraps at 76 columns', len(rows[0]) == 76 and rows[-1] == b'')
+r2 = subprocess.run([exe('base64'), '-d'], input=r.stdout, capture_output=True)
+check('base64 multi-block roundtrip', r2.stdout == blob)
+r = subprocess.run([exe('base64'), '-d', '-i'], input=b'aGVs!bG8=\n', capture_output=True)
+expect_eq('base64 -d -i skips garbage', r.stdout, b'hello')
 
 section('shuf')
 out, _, _ = run('shuf', stdin_text='a\nb\nc\nd\ne\n')
@@ -1103,6 +1223,35 @@ with tempfile.TemporaryDirectory() as d:
     out, _, _ = run('sed','-e', 's/foo/bar/', '-e', 's/baz/qux/', stdin_text='foo baz\n')
     check('sed multiple -e expressions', out.strip() == 'bar qux')
 
+    out, _, _ = run('sed', '-n', '1!G;h;$p', stdin_text='1\n2\n3\n')
+    check('sed hold space reverses lines', out.strip() == '3\n2\n1')
+
+    out, _, _ = run('sed', 'x;/^$/d', stdin_text='a\nb\n')
+    check('sed hold space starts empty', out == 'a\n')
+
+    out, _, _ = run('sed', '-e', ':a', '-e', r'/\\$/N; s/\\\n//; ta',
+                    stdin_text='a \\\nb \\\nc\nd\n')
+    check('sed N/t loop joins continuation lines', out.strip() == 'a b c\nd')
+
+    out, _, _ = run('sed', '$!N;P;D', stdin_text='x\ny\nz\n')
+    check('sed N/P/D sliding window', out.strip() == 'x\ny\nz')
+
+    out, _, _ = run('sed', '/foo/{s/foo/X/;b};s/$/!/', stdin_text='foo\nbar\n')
+    check('sed block and branch to end', out.strip() == 'X\nbar!')
+
+    f1, f2 = os.path.join(d, 'f1'), os.path.join(d, 'f2')
+    with open(f1, 'w') as f: f.write('a\nb\nc\n')
+    with open(f2, 'w') as f: f.write('x\ny\n')
+    out, _, _ = run('sed', 'N', f1, f2)
+    out2, _, _ = run('sed', 'n;d', f1, f2)
+    out3, _, _ = run('sed', '-n', '$=', f1, f2)
+    check('sed n/N read files as one stream',
+          out.split() == ['a', 'b', 'c', 'x', 'y'] and out2.split() == ['a', 'c', 'y']
+          and out3.strip() == '5')
+
+    _, err, code = run('sed', 'b nowhere', stdin_text='a\n')
+    check('sed undefined label is an error', code == 1 and 'nowhere' in err)
+
     out, _, _ = run('sed', '--version')
     check('sed --version', 'sed' in out and 'Winix' in out)
 
@@ -2748,9 +2897,141 @@ try:
     out2, err2, rc2 = run('b2sum', '-l', '256', f1)
     check('b2sum -l 256 exits 0', rc2 == 0)
     check('b2sum -l 256 has 64 hex chars', len(out2.split()[0]) == 64)
+    out3, err3, rc3 = run('b2sum', '--tag', '-l', '256', f1)
+    write_file(os.path.join(d_b2, 'sums'), out3)
+    out4, err4, rc4 = run('b2sum', '-c', 'sums', cwd=d_b2)
+    check('b2sum --tag -l 256 output', out3.startswith('BLAKE2b-256 ('))
+    check('b2sum -c reads --tag lines', rc4 == 0 and 'OK' in out4)
 finally:
     shutil.rmtree(d_b2, ignore_errors=True)
 
+# ── digest kernels: multi-block input against hashlib ─────────────────────────
+import hashlib
+_dg_data = bytes(range(256)) * 4099 + b'tail'
+for _tool, _ref in (('md5sum', 'md5'), ('sha1sum', 'sha1'), ('sha224sum', 'sha224'),
+                    ('sha256sum', 'sha256'), ('sha384sum', 'sha384'),
+                    ('sha512sum', 'sha512'), ('b2sum', 'blake2b')):
+    r = subprocess.run([exe(_tool)], input=_dg_data, capture_output=True)
+    check(f'{_tool} multi-block digest',
+          r.stdout.split(b' ')[0].decode() == hashlib.new(_ref, _dg_data).hexdigest())
+
+# ── b2sum tree modes and keys ─────────────────────────────────────────────────
+def _b2_tree(data, wide):
+    """BLAKE2bp / BLAKE2sp from hashlib's tree parameters."""
+    algo, leaves, inner = (hashlib.blake2b, 4, 64) if wide else (hashlib.blake2s, 8, 32)
+    bs = 128 if wide else 64
+    mids = b''.join(
+        algo(b''.join(data[i:i + bs] for i in range(l * bs, len(data), leaves * bs)),
+             fanout=leaves, depth=2, node_offset=l, inner_size=inner,
+             last_node=(l == leaves - 1)).digest()
+        for l in range(leaves))
+    return algo(mids, fanout=leaves, depth=2, node_depth=1, inner_size=inner,
+                last_node=True).hexdigest()
+
+d_tree = tempfile.mkdtemp()
+try:
+    _tree_in = {}
+    for _n in (0, 100, 512, 513, 5000, 70001):
+        _tree_in[f't{_n}'] = bytes((_n * 5 + k * 11) & 255 for k in range(_n))
+        with open(os.path.join(d_tree, f't{_n}'), 'wb') as _f:
+            _f.write(_tree_in[f't{_n}'])
+    out, err, rc = run('b2sum', '--tree', *_tree_in, cwd=d_tree)
+    check('b2sum --tree is BLAKE2bp',
+          rc == 0 and out.splitlines() == [_b2_tree(v, True) + '  ' + k for k, v in _tree_in.items()])
+    out, err, rc = run('b2sum', '-a', 'blake2sp', *_tree_in, cwd=d_tree)
+    check('b2sum -a blake2sp',
+          rc == 0 and out.splitlines() == [_b2_tree(v, False) + '  ' + k for k, v in _tree_in.items()])
+    out, err, rc = run('b2sum', '-a', 'blake2s', 't5000', cwd=d_tree)
+    check('b2sum -a blake2s', out.split()[0] == hashlib.blake2s(_tree_in['t5000']).hexdigest())
+    out, err, rc = run('b2sum', '--key=000102030405', '-l', '256', 't513', cwd=d_tree)
+    check('b2sum --key is keyed BLAKE2b',
+          out.split()[0] == hashlib.blake2b(_tree_in['t513'], digest_size=32,
+                                            key=bytes(range(6))).hexdigest())
+    out, err, rc = run('b2sum', '-a', 'blake2sp', '--tag', '--key=aa55', 't70001', cwd=d_tree)
+    write_file(os.path.join(d_tree, 'sums'), out)
+    out2, err2, rc2 = run('b2sum', '-a', 'blake2sp', '--key=aa55', '-c', 'sums', cwd=d_tree)
+    out3, err3, rc3 = run('b2sum', '-a', 'blake2sp', '-c', 'sums', cwd=d_tree)
+    check('b2sum keyed BLAKE2sp -c', out.startswith('BLAKE2sp (') and rc2 == 0 and rc3 == 1)
+    out, err, rc = run('b2sum', '-a', 'blake2s', '-l', '512', 't0', cwd=d_tree)
+    check('b2sum -a blake2s rejects -l 512', rc == 1)
+finally:
+    shutil.rmtree(d_tree, ignore_errors=True)
+
+# ── checksum tools --parallel ─────────────────────────────────────────────────
+d_par = tempfile.mkdtemp()
+try:
+    _names = []
+    for _i in range(40):
+        _names.append(f'p{_i:02d}')
+        write_file(os.path.join(d_par, _names[-1]), 'x' * (_i * 3001), 'w')
+    _args = _names[:20] + ['missing'] + _names[20:]
+    out1, err1, rc1 = run('sha256sum', *_args, cwd=d_par)
+    out2, err2, rc2 = run('sha256sum', '--parallel=4', *_args, cwd=d_par)
+    check('sha256sum --parallel keeps argument order', out1 == out2 and len(out1.splitlines()) == 40)
+    check('sha256sum --parallel reports missing file', rc2 == 1 and 'missing' in err2)
+    write_file(os.path.join(d_par, 'sums'), out1)
+    out3, err3, rc3 = run('sha256sum', '-c', '--parallel=4', 'sums', cwd=d_par)
+    check('sha256sum -c --parallel in manifest order',
+          rc3 == 0 and out3.splitlines() == [n + ': OK' for n in _names])
+    # Small files of every padding shape (multi-buffer path where available)
+    _small = {}
+    for _n in (0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 65535, 65536, 70000):
+        _small[f's{_n}'] = bytes((_n * 7 + k) & 255 for k in range(_n))
+        with open(os.path.join(d_par, f's{_n}'), 'wb') as _f:
+            _f.write(_small[f's{_n}'])
+    for _tool, _ref in (('sha256sum', 'sha256'), ('sha224sum', 'sha224')):
+        out4, err4, rc4 = run(_tool, *_small, cwd=d_par)
+        check(f'{_tool} many small files',
+              rc4 == 0 and out4.splitlines() ==
+              [hashlib.new(_ref, v).hexdigest() + '  ' + k for k, v in _small.items()])
+finally:
+    shutil.rmtree(d_par, ignore_errors=True)
+
+# ── cksum ──────────────────────────────────────────────────────────────────────
+out, err, rc = run('cksum', stdin_text='hello\n')
+check('cksum POSIX CRC', out.strip() == '3015617425 6')
+d_ck = tempfile.mkdtemp()
+try:
+    import zlib
+    _blobs = {}
+    for _n in (0, 15, 64, 255, 256, 1000, 70001):
+        _blobs[f'c{_n}'] = bytes((_n * 13 + k * 7) & 255 for k in range(_n))
+        with open(os.path.join(d_ck, f'c{_n}'), 'wb') as _f:
+            _f.write(_blobs[f'c{_n}'])
+    out, err, rc = run('cksum', '-a', 'crc32b', *_blobs, cwd=d_ck)
+    check('cksum -a crc32b matches zlib',
+          rc == 0 and out.splitlines() ==
+          [f'{zlib.crc32(v)} {len(v)} {k}' for k, v in _blobs.items()])
+    out, err, rc = run('cksum', '--algorithm=sha256', 'c1000', cwd=d_ck)
+    check('cksum -a sha256 tagged',
+          out.strip() == 'SHA256 (c1000) = ' + hashlib.sha256(_blobs['c1000']).hexdigest())
+    write_file(os.path.join(d_ck, 'sums'), out)
+    out, err, rc = run('cksum', '-a', 'sha256', '-c', 'sums', cwd=d_ck)
+    check('cksum -a sha256 -c', rc == 0 and out.strip() == 'c1000: OK')
+    out, err, rc = run('cksum', '-a', 'md5', '--untagged', 'c64', cwd=d_ck)
+    check('cksum --untagged', out.strip() == hashlib.md5(_blobs['c64']).hexdigest() + '  c64')
+    def _sysv(v):
+        s = sum(v)
+        r = (s & 0xffff) + (s >> 16)
+        return f'{(r & 0xffff) + (r >> 16)} {(len(v) + 511) // 512}'
+    def _bsd(v):
+        s = 0
+        for b in v:
+            s = ((s >> 1) + ((s & 1) << 15) + b) & 0xffff
+        return f'{s:05d} {(len(v) + 1023) // 1024:5d}'
+    out, err, rc = run('cksum', '-a', 'sysv', *_blobs, cwd=d_ck)
+    check('cksum -a sysv matches sum -s',
+          rc == 0 and out.splitlines() == [f'{_sysv(v)} {k}' for k, v in _blobs.items()])
+    out, err, rc = run('cksum', '-a', 'bsd', *_blobs, cwd=d_ck)
+    check('cksum -a bsd matches sum -r',
+          rc == 0 and out.splitlines() == [f'{_bsd(v)} {k}' for k, v in _blobs.items()])
+    out, err, rc = run('cksum', '--untagged', 'c64', cwd=d_ck)
+    check('cksum crc takes --untagged', rc == 0 and out.strip().endswith(' 64 c64'))
+    out, err, rc = run('cksum', '-a', 'crc64', 'c64', cwd=d_ck)
+    check('cksum rejects unknown algorithm', rc == 1 and 'crc64' in err)
+finally:
+    shutil.rmtree(d_ck, ignore_errors=True)
+
 # ── base32 ─────────────────────────────────────────────────────────────────────
 out, err, rc = run('base32', stdin_text='hello\n')
 check('base32 encodes hello', rc == 0)
@@ -2760,6 +3041,11 @@ check('base32 -d decodes', rc2 == 0)
 check('base32 -d output', 'hello' in out2)
 out3, err3, rc3 = run('base32', '--version')
 check('base32 --version exits 0', rc3 == 0)
+r = subprocess.run([exe('base32'), '-w', '0'], input=bytes(range(256)) * 4000,
+                   capture_output=True)
+r2 = subprocess.run([exe('base32'), '-d'], input=r.stdout, capture_output=True)
+check('base32 -w 0 roundtrip', r.stdout.count(b'\n') == 1
+      and r2.stdout == bytes(range(256)) * 4000)
 
 # ── dd ─────────────────────────────────────────────────────────────────────────
 out, err, rc = run('dd', '--version')
@@ -3150,6 +3436,115 @@ with tempfile.TemporaryDirectory() as d:
     out, _, rc = run('winix', script_ps4)
     check('proc_sub >(cmd) feeds output', out.count('world') >= 1)
 
+# ── gzip / gunzip ─────────────────────────────────────────────────────────────
+
+with tempfile.TemporaryDirectory() as d:
+    import gzip as _gz, zlib as _zl
+    src = os.path.join(d, 'par.txt')
+    data = ''.join(f'line {i} {i * 7919 % 1000}\n' for i in range(60000)).encode()
+    with open(src, 'wb') as f:
+        f.write(data)
+
+    def _one_member(blob):
+        z = _zl.decompressobj(31)
+        return z.decompress(blob) == data and z.eof and not z.unused_data
+
+    out, err, rc = run('gzip', '-k', '-p', '3', src)
+    gz = open(src + '.gz', 'rb').read()
+    check('gzip -p 3 exits 0', rc == 0 and os.path.exists(src))
+    check('gzip -p 3 writes one gzip member', _one_member(gz))
+    os.remove(src)
+    out, err, rc = run('gunzip', src + '.gz')
+    check('gunzip restores gzip -p output', rc == 0 and open(src, 'rb').read() == data)
+
+    r = subprocess.run([exe('gzip'), '-c', '--processes=2'], input=data, capture_output=True)
+    check('gzip --processes=2 stdin pipe', r.returncode == 0 and _one_member(r.stdout))
+    empty = os.path.join(d, 'empty')
+    open(empty, 'wb').close()
+    r = subprocess.run([exe('gzip'), '-c', '-p4', empty], capture_output=True)
+    check('gzip -p empty file', r.returncode == 0 and _gz.decompress(r.stdout) == b'')
+    out, err, rc = run('gzip', '-p', '0', src)
+    check('gzip -p 0 rejected', rc == 1 and 'processes' in err)
+
+    # -l from the trailer, -t per member
+    one = os.path.join(d, 'one.gz')
+    two = os.path.join(d, 'two.gz')
+    tail = os.urandom(50000)
+    with open(one, 'wb') as f:
+        f.write(_gz.compress(data))
+    with open(two, 'wb') as f:
+        f.write(_gz.compress(data) + _gz.compress(tail))
+    out, err, rc = run('gzip', '-l', one, two)
+    rows = [l.split() for l in out.splitlines()[1:]]
+    check('gzip -l reads ISIZE', rc == 0 and rows[0][1] == str(len(data)))
+    check('gzip -l counts multi-member files',
+          len(rows) == 2 and rows[1][1] == str(len(data) + len(tail)))
+    # incompressible first member, compressible last: the sizes look plausible
+    # for one member, so only the header scan finds the second
+    noise = os.urandom(200000)
+    cat2 = os.path.join(d, 'cat2.gz')
+    fake = os.path.join(d, 'fake.gz')
+    with open(cat2, 'wb') as f:
+        f.write(_gz.compress(noise) + _gz.compress(bytes(2000000)))
+    with open(fake, 'wb') as f:
+        f.write(_gz.compress(noise + b'\x1f\x8b\x08\x00' + noise))
+    out, err, rc = run('gzip', '-l', cat2, fake)
+    rows = [l.split() for l in out.splitlines()[1:]]
+    check('gzip -l finds a compressible last member',
+          rc == 0 and rows[0][1] == '2200000' and rows[1][1] == '400004')
+    out, err, rc = run('gzip', '-tv', two)
+    check('gzip -tv reports each member',
+          rc == 0 and 'member 2: 50000 bytes' in err and 'member 1:' in err)
+    bad = bytearray(open(one, 'rb').read())
+    bad[-6] ^= 1
+    with open(one, 'wb') as f:
+        f.write(bad)
+    out, err, rc = run('gzip', '-t', one)
+    check('gzip -t detects crc error', rc == 1 and 'crc error' in err)
+
+    # pipelined gunzip: several 1 MB slots, member boundaries, trailer checks
+    big = data * 4 + tail
+    r = subprocess.run([exe('gunzip'), '-c'], capture_output=True,
+                       input=_gz.compress(data * 4) + _gz.compress(tail))
+    check('gunzip pipeline multi-member output', r.returncode == 0 and r.stdout == big)
+    r = subprocess.run([exe('gunzip'), '-c'], capture_output=True,
+                       input=_gz.compress(tail) + b'junk')
+    check('gunzip trailing garbage warns', r.returncode == 2 and r.stdout == tail)
+    r = subprocess.run([exe('gunzip'), '-c'], capture_output=True,
+                       input=_gz.compress(tail) + bytes(3000))
+    check('gunzip skips zero padding', r.returncode == 0 and r.stdout == tail
+          and r.stderr == b'')
+    r = subprocess.run([exe('gunzip'), '-c'], capture_output=True, input=bytes(bad))
+    check('gunzip reports crc error', r.returncode == 1 and b'crc error' in r.stderr)
+
+    # --rsyncable: an insertion only changes the output up to the next cut
+    text = ''.join(f'{i * 2654435761 % 4294967296:x} {i}\n' for i in range(200000)).encode()
+    r1 = subprocess.run([exe('gzip'), '-c', '--rsyncable'], input=text, capture_output=True)
+    r2 = subprocess.run([exe('gzip'), '-c', '--rsyncable', '-p', '3'],
+                        input=b'inserted\n' + text, capture_output=True)
+    a, b = r1.stdout[:-8], r2.stdout[:-8]
+    same = 0
+    while same < min(len(a), len(b)) and a[-1 - same] == b[-1 - same]:
+        same += 1
+    check('gzip --rsyncable round-trip', _gz.decompress(r1.stdout) == text)
+    check('gzip --rsyncable resynchronizes', same > len(a) * 9 // 10)
+
+    # --index and --offset/--length
+    src4 = os.path.join(d, 'big')
+    with open(src4 + '.gz', 'wb') as f:
+        f.write(_gz.compress(big))
+    out, err, rc = run('gzip', '-v', '--index', src4 + '.gz')
+    check('gzip --index writes .gzi', rc == 0 and os.path.exists(src4 + '.gz.gzi'))
+    ok = True
+    for off, ln in ((0, 10), (1500000, 5000), (len(big) - 7, 100), (2100000, 0)):
+        r = subprocess.run([exe('gzip'), '-dc', f'--offset={off}', f'--length={ln}',
+                            src4 + '.gz'], capture_output=True)
+        ok = ok and r.returncode == 0 and r.stdout == big[off:off + ln]
+    check('gzip --offset extracts from the index', ok)
+    r = subprocess.run([exe('gunzip'), '--offset=3000000'], input=_gz.compress(big),
+                       capture_output=True)
+    check('gzip --offset without an index', r.returncode == 0 and r.stdout == big[3000000:])
+
 # ── wzip / wunzip ─────────────────────────────────────────────────────────────
 
 with tempfile.TemporaryDirectory() as d:
@@ -3209,6 +3604,127 @@ with tempfile.TemporaryDirectory() as d:
     check('wunzip stdin pipe exits 0', r9.returncode == 0)
     check('wunzip stdin pipe correct output', b'Hello, wzip!' in r9.stdout)
 
+    # -T N: zstd worker threads; the frame does not depend on the count
+    text = ''.join(f'{i * 2654435761 % 4294967296:x} {i}\n' for i in range(200000)).encode()
+    outs = [_sp.run([exe('wzip'), '-c', t, '--job-size=512K'], input=text,
+                    capture_output=True) for t in ('-T1', '-T3')]
+    check('wzip -T same output for any thread count',
+          all(r.returncode == 0 for r in outs) and outs[0].stdout == outs[1].stdout)
+    r = _sp.run([exe('wunzip'), '-c'], input=outs[1].stdout, capture_output=True)
+    check('wzip -T round-trip', r.returncode == 0 and r.stdout == text)
+    out, err, rc = run('wzip', '-T', 'x', src)
+    check('wzip -T rejects a bad count', rc == 1 and 'invalid number of threads' in err)
+
+    # --long finds repeats beyond the default window; the header records it
+    blob = os.urandom(3 << 20)
+    plain = _sp.run([exe('wzip'), '-c'], input=blob * 2, capture_output=True).stdout
+    r = _sp.run([exe('wzip'), '-c', '--long=28'], input=blob * 2, capture_output=True)
+    check('wzip --long matches across the window', len(r.stdout) < len(plain) * 2 // 3)
+    r2 = _sp.run([exe('wunzip'), '-c'], input=r.stdout, capture_output=True)
+    check('wunzip uses the recorded window', r2.returncode == 0 and r2.stdout == blob * 2)
+    r2 = _sp.run([exe('wunzip'), '-c', '--memory=64M'], input=r.stdout, capture_output=True)
+    check('wunzip --memory caps the window', r2.returncode == 1 and b'--memory' in r2.stderr)
+    out, err, rc = run('wzip', '-c', '-21', src)
+    check('wzip levels above 19 need --ultra', rc == 1 and '--ultra' in err)
+
+    # --adapt: the level moves between jobs; min=max pins it
+    r = _sp.run([exe('wzip'), '-c', '-T2', '--adapt', '--job-size=512K'], input=text,
+                capture_output=True)
+    r2 = _sp.run([exe('wunzip'), '-c'], input=r.stdout, capture_output=True)
+    check('wzip --adapt round-trip', r.returncode == 0 and r2.stdout == text)
+    r = _sp.run([exe('wzip'), '-c', '-T2', '--adapt=min=1,max=1'], input=text,
+                capture_output=True)
+    r2 = _sp.run([exe('wzip'), '-c', '-T2', '-1'], input=text, capture_output=True)
+    check('wzip --adapt=min=1,max=1 is level 1', r.stdout == r2.stdout)
+    out, err, rc = run('wzip', '-c', '--adapt=max=3,min=9', src)
+    check('wzip --adapt rejects min above max', rc == 1 and 'min is above max' in err)
+
+    # --train / -D: small similar files compress far better with a dictionary
+    samples = []
+    for i in range(300):
+        sp = os.path.join(d, f'rec{i:03d}.json')
+        with open(sp, 'w') as f:
+            f.write('{\n  "id": %d,\n  "host": "node-%02d.cluster.local",\n'
+                    '  "service": "%s",\n  "latency_ms": %d,\n  "tags": ["prod", "eu-west-1"]\n}\n'
+                    % (i, i % 40, ('auth', 'billing', 'search')[i % 3], i * 7919 % 900))
+        samples.append(sp)
+    dct = os.path.join(d, 'json.dict')
+    out, err, rc = run('wzip', '--train', *samples[:250], '-o', dct)
+    check('wzip --train writes a dictionary', rc == 0 and os.path.getsize(dct) > 0)
+    plain = _sp.run([exe('wzip'), '-c', samples[280]], capture_output=True).stdout
+    r = _sp.run([exe('wzip'), '-c', '-D', dct, samples[280]], capture_output=True)
+    check('wzip -D shrinks small files', r.returncode == 0 and len(r.stdout) * 2 < len(plain))
+    r2 = _sp.run([exe('wunzip'), '-c', '-D', dct], input=r.stdout, capture_output=True)
+    check('wunzip -D round-trip',
+          r2.returncode == 0 and r2.stdout == open(samples[280], 'rb').read())
+    r2 = _sp.run([exe('wunzip'), '-c'], input=r.stdout, capture_output=True)
+    check('wunzip names the missing dictionary',
+          r2.returncode == 1 and b'needs dictionary' in r2.stderr)
+
+    # --seekable: independent frames and a trailing seek table; --range
+    seek = os.path.join(d, 'seek.wz')
+    r = _sp.run([exe('wzip'), '-c', '--seekable=64K', '-T', '3'], input=text,
+                capture_output=True)
+    with open(seek, 'wb') as f:
+        f.write(r.stdout)
+    check('wzip --seekable ends in a seek table',
+          r.returncode == 0 and r.stdout[-4:] == bytes.fromhex('b1ea928f'))
+    r2 = _sp.run([exe('wunzip'), '-c'], input=r.stdout, capture_output=True)
+    check('wzip --seekable round-trip', r2.returncode == 0 and r2.stdout == text)
+    ok = True
+    for off, ln in ((0, 10), (65530, 20), (1000000, 300000), (len(text) - 3, 50)):
+        r2 = _sp.run([exe('wunzip'), f'--range={off}:{ln}', seek], capture_output=True)
+        ok = ok and r2.returncode == 0 and r2.stdout == text[off:off + ln]
+    check('wunzip --range reads the seek table', ok)
+    r2 = _sp.run([exe('wunzip'), '--range=1000000:10'], input=outs[0].stdout,
+                 capture_output=True)
+    check('wunzip --range without a seek table',
+          r2.returncode == 0 and r2.stdout == text[1000000:1000010])
+
+    # wunzip -T: independent frames decode in parallel, output in order
+    ok = True
+    for src_wz in (open(seek, 'rb').read(), outs[0].stdout):
+        for t in ('-T1', '-T4'):
+            r2 = _sp.run([exe('wunzip'), '-c', t], input=src_wz, capture_output=True)
+            ok = ok and r2.returncode == 0 and r2.stdout == text
+    check('wunzip -T multi-frame and single-frame', ok)
+    r2 = _sp.run([exe('wunzip'), '-c', '-T4'], input=open(seek, 'rb').read()[:-5000],
+                 capture_output=True)
+    check('wunzip -T reports truncation', r2.returncode == 1)
+
+    # .wz files joined with cat: each header brings its own dictionary
+    withdict = _sp.run([exe('wzip'), '-c', '-D', dct, samples[280]], capture_output=True)
+    joined = outs[0].stdout + withdict.stdout + open(seek, 'rb').read()
+    ok = True
+    for t in ('-T1', '-T4'):
+        r2 = _sp.run([exe('wunzip'), '-c', t, '-D', dct], input=joined, capture_output=True)
+        ok = ok and r2.returncode == 0 and r2.stdout == text + open(samples[280], 'rb').read() + text
+    check('wunzip concatenated .wz files', ok)
+
+    # wzip -r -T: files compressed in parallel, messages in walk order
+    errs, wz = [], []
+    for t in ('-T1', '-T4'):
+        tree = os.path.join(d, 'tree' + t)
+        os.makedirs(os.path.join(tree, 'sub'))
+        for i in range(12):
+            with open(os.path.join(tree, 'sub' if i % 2 else '', f'f{i:02d}'), 'wb') as f:
+                f.write(text[:i * 20000 + 1])
+        with open(os.path.join(tree, 'whole'), 'wb') as f:
+            f.write(text)   # several 512K jobs
+        open(os.path.join(tree, 'sub', 'f05.wz'), 'wb').close()  # blocks f05
+        r = _sp.run([exe('wzip'), '-r', '-v', t, '--job-size=512K', tree],
+                    capture_output=True)
+        errs.append((r.returncode, r.stderr.replace(tree.encode(), b'TREE')))
+        with open(os.path.join(tree, 'whole.wz'), 'rb') as f:
+            wz.append(f.read())
+    check('wzip -r -T messages in the same order', errs[0] == errs[1] and
+          errs[1][0] == 1 and b'f05.wz: already exists' in errs[1][1])
+    check('wzip -r -T output same as -T1', wz[0] == wz[1])
+    r = _sp.run([exe('wunzip'), '-r', tree], capture_output=True)
+    with open(os.path.join(tree, 'sub', 'f11'), 'rb') as f:
+        check('wunzip -r restores files in place',
+              r.returncode == 1 and f.read() == text[:220001])
+
 # ── Summary ───────────────────────────────────────────────────────────────────
 
 total = _passed + _failed